@@ -0,0 +1,32 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace motis {
+
+// Shared pointer that can be replaced while other threads read it.
+// Readers keep the loaded version alive until they drop their copy.
+//
+// Always guarded by a mutex (held only to copy the pointer): the layout
+// must not depend on the language mode, instances are shared between C++17
+// and C++20 targets.
+template <typename T>
+struct atomic_shared_ptr {
+  void store(std::shared_ptr<T> x) {
+    auto const lock = std::lock_guard{mutex_};
+    ptr_.swap(x);
+  }
+
+  std::shared_ptr<T> load() const {
+    auto const lock = std::lock_guard{mutex_};
+    return ptr_;
+  }
+
+private:
+  std::shared_ptr<T> ptr_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace motis
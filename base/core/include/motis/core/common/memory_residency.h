@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace motis {
+
+// none: pages are loaded on first access
+// prefetch: madvise(MADV_WILLNEED) read-ahead of the whole file
+// lock: mlock, falls back to prefetch if RLIMIT_MEMLOCK is too low
+enum class residency_mode { kNone, kPrefetch, kLock };
+
+residency_mode to_residency_mode(std::string_view);
+char const* to_str(residency_mode);
+
+// Maps data files read-only to prefetch or lock their pages in the page
+// cache. Other mappings of the same files (e.g. cista::mmap) share these
+// pages. Locked pages stay resident until this object is destroyed.
+struct memory_residency {
+  explicit memory_residency(residency_mode);
+  ~memory_residency();
+
+  memory_residency(memory_residency const&) = delete;
+  memory_residency& operator=(memory_residency const&) = delete;
+  memory_residency(memory_residency&&) = delete;
+  memory_residency& operator=(memory_residency&&) = delete;
+
+  // Regular file or directory (all regular files, recursively).
+  void add(std::filesystem::path const&);
+
+  residency_mode requested_mode_;
+  residency_mode mode_;  // effective mode, differs after a lock fallback
+  std::size_t bytes_locked_{0U};
+  std::size_t bytes_prefetched_{0U};
+
+private:
+  void add_file(std::filesystem::path const&);
+
+  struct mapping {
+    void* addr_;
+    std::size_t size_;
+    bool locked_;
+  };
+  std::vector<mapping> mappings_;
+};
+
+}  // namespace motis
@@ -8,6 +8,8 @@
 
 #include "geo/latlng.h"
 
+#include "motis/core/common/atomic_shared_ptr.h"
+
 #include "motis/protocol/Station_generated.h"
 
 namespace geo {
@@ -60,4 +62,8 @@ private:
   std::unique_ptr<geo::point_rtree> rtree_;
 };
 
+// Shared data STATION_LOOKUP: a timetable reload stores a new version.
+// load() once per request, lookup_stations reference the loaded version.
+using shared_station_lookup = atomic_shared_ptr<station_lookup const>;
+
 }  // namespace motis
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "motis/core/common/memory_residency.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+#include "utl/verify.h"
+
+#include "motis/core/common/logging.h"
+
+namespace fs = std::filesystem;
+
+namespace motis {
+
+residency_mode to_residency_mode(std::string_view s) {
+  if (s == "none") {
+    return residency_mode::kNone;
+  } else if (s == "prefetch") {
+    return residency_mode::kPrefetch;
+  } else if (s == "lock") {
+    return residency_mode::kLock;
+  }
+  throw utl::fail("unknown memory residency mode {} (none|prefetch|lock)", s);
+}
+
+char const* to_str(residency_mode const m) {
+  switch (m) {
+    case residency_mode::kNone: return "none";
+    case residency_mode::kPrefetch: return "prefetch";
+    case residency_mode::kLock: return "lock";
+  }
+  return "";
+}
+
+memory_residency::memory_residency(residency_mode const mode)
+    : requested_mode_{mode}, mode_{mode} {}
+
+memory_residency::~memory_residency() {
+#ifndef _WIN32
+  for (auto const& m : mappings_) {
+    if (m.locked_) {
+      munlock(m.addr_, m.size_);
+    }
+    munmap(m.addr_, m.size_);
+  }
+#endif
+}
+
+void memory_residency::add(fs::path const& p) {
+  if (mode_ == residency_mode::kNone) {
+    return;
+  }
+
+  if (fs::is_directory(p)) {
+    for (auto const& e : fs::recursive_directory_iterator{p}) {
+      if (e.is_regular_file()) {
+        add_file(e.path());
+      }
+    }
+  } else if (fs::is_regular_file(p)) {
+    add_file(p);
+  }
+}
+
+void memory_residency::add_file(fs::path const& p) {
+#ifdef _WIN32
+  (void)p;
+  mode_ = residency_mode::kNone;
+#else
+  auto const fd = ::open(p.c_str(), O_RDONLY);
+  if (fd == -1) {
+    LOG(logging::warn) << "memory residency: cannot open " << p << ": "
+                       << std::strerror(errno);
+    return;
+  }
+
+  struct stat st {};
+  auto const size = ::fstat(fd, &st) == 0 ? static_cast<std::size_t>(st.st_size)
+                                          : std::size_t{0U};
+  if (size == 0U) {
+    ::close(fd);
+    return;
+  }
+
+  auto const addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    LOG(logging::warn) << "memory residency: cannot map " << p << ": "
+                       << std::strerror(errno);
+    return;
+  }
+
+  auto locked = false;
+  if (mode_ == residency_mode::kLock) {
+    if (::mlock(addr, size) == 0) {
+      locked = true;
+      bytes_locked_ += size;
+    } else {
+      auto const err = errno;
+      auto limit = rlimit{};
+      ::getrlimit(RLIMIT_MEMLOCK, &limit);
+      LOG(logging::warn) << "memory residency: mlock " << p << " (" << size
+                         << " bytes) failed: " << std::strerror(err)
+                         << ", RLIMIT_MEMLOCK=" << limit.rlim_cur
+                         << ", locked so far: " << bytes_locked_
+                         << " bytes, falling back to prefetch";
+      mode_ = residency_mode::kPrefetch;
+    }
+  }
+
+  if (!locked) {
+    ::madvise(addr, size, MADV_WILLNEED);
+    bytes_prefetched_ += size;
+  }
+
+  mappings_.emplace_back(mapping{addr, size, locked});
+#endif
+}
+
+}  // namespace motis
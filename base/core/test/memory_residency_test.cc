@@ -0,0 +1,83 @@
+#include "gtest/gtest.h"
+
+#ifndef _WIN32
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "motis/core/common/memory_residency.h"
+#include "motis/core/common/raii.h"
+
+namespace fs = std::filesystem;
+
+namespace motis {
+
+namespace {
+
+constexpr auto const kFileSize = std::size_t{1024U * 1024U};
+
+fs::path make_data_dir() {
+  auto const dir = fs::temp_directory_path() /
+                   ("motis_memory_residency_test_" + std::to_string(getpid()));
+  fs::create_directories(dir / "sub");
+  for (auto const& name : {"a.bin", "sub/b.bin"}) {
+    std::ofstream{dir / name, std::ios::binary}
+        << std::string(kFileSize, 'x');
+  }
+  return dir;
+}
+
+}  // namespace
+
+TEST(core_memory_residency, modes) {
+  EXPECT_EQ(residency_mode::kNone, to_residency_mode("none"));
+  EXPECT_EQ(residency_mode::kPrefetch, to_residency_mode("prefetch"));
+  EXPECT_EQ(residency_mode::kLock, to_residency_mode("lock"));
+  EXPECT_ANY_THROW(to_residency_mode("mlock"));
+}
+
+TEST(core_memory_residency, prefetch) {
+  auto const dir = make_data_dir();
+  auto const remove_dir = make_finally([&]() { fs::remove_all(dir); });
+
+  auto r = memory_residency{residency_mode::kPrefetch};
+  r.add(dir);
+  EXPECT_EQ(residency_mode::kPrefetch, r.mode_);
+  EXPECT_EQ(0U, r.bytes_locked_);
+  EXPECT_EQ(2U * kFileSize, r.bytes_prefetched_);
+}
+
+TEST(core_memory_residency, lock_fallback) {
+  auto const dir = make_data_dir();
+  auto const remove_dir = make_finally([&]() { fs::remove_all(dir); });
+
+  // Only one of the two files fits into the limit.
+  auto original = rlimit{};
+  ASSERT_EQ(0, getrlimit(RLIMIT_MEMLOCK, &original));
+  auto restricted = original;
+  restricted.rlim_cur =
+      std::min(static_cast<rlim_t>(kFileSize + kFileSize / 2U),
+               original.rlim_max);
+  ASSERT_EQ(0, setrlimit(RLIMIT_MEMLOCK, &restricted));
+  auto const restore_limit =
+      make_finally([&]() { setrlimit(RLIMIT_MEMLOCK, &original); });
+
+  auto r = memory_residency{residency_mode::kLock};
+  r.add(dir);
+  EXPECT_EQ(residency_mode::kLock, r.requested_mode_);
+  EXPECT_EQ(2U * kFileSize, r.bytes_locked_ + r.bytes_prefetched_);
+  if (geteuid() != 0) {  // root ignores RLIMIT_MEMLOCK
+    EXPECT_EQ(residency_mode::kPrefetch, r.mode_);
+    EXPECT_LE(r.bytes_locked_, kFileSize);
+    EXPECT_GE(r.bytes_prefetched_, kFileSize);
+  }
+}
+
+}  // namespace motis
+
+#endif
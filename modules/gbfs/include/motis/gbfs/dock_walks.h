@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "geo/latlng.h"
+
+#include "motis/hash_map.h"
+
+#include "motis/core/schedule/station_lookup.h"
+#include "motis/core/schedule/time.h"
+
+namespace motis::gbfs {
+
+// Walk durations (seconds) between a GBFS station (dock) and a public
+// transport station, in both directions.
+struct dock_walk {
+  double to_station_, from_station_;
+};
+
+struct dock_walks_entry {
+  geo::latlng pos_;  // dock position the walks were computed for
+  mcd::hash_map<std::string, dock_walk> walks_;  // by PT station id
+};
+
+// Precomputed at each update for all PT stations within max_duration_
+// (minutes) of a dock. Keyed by dock id.
+struct dock_walks {
+  // Same owner: the station lookup version was not swapped since.
+  bool computed_with(std::shared_ptr<station_lookup const> const& st) const {
+    return !stations_.owner_before(st) && !st.owner_before(stations_);
+  }
+
+  unsigned max_duration_{0U};
+  mcd::hash_map<std::string, dock_walks_entry> docks_;
+  std::weak_ptr<station_lookup const> stations_;
+};
+
+constexpr auto const kUnreachableWalk =
+    std::numeric_limits<duration>::max() * 60.0;
+
+// Walk durations between the docks and the PT stations followed by direct
+// positions, row-major [dock][target].
+// Forward: dock -> target. Backward: target -> dock.
+// PT station entries come from the precomputed walks. The live table
+// (OSRM many-to-many, nullptr if not requested) covers the direct
+// positions: docks x direct (forward) or direct x docks (backward).
+// Pairs without a walk get kUnreachableWalk.
+template <typename LiveTable>
+std::vector<double> dock_walk_matrix(
+    dock_walks const& walks, std::vector<std::string> const& dock_ids,
+    std::vector<std::string> const& station_ids, std::size_t const n_direct,
+    LiveTable const* live, bool const fwd) {
+  auto const n_targets = station_ids.size() + n_direct;
+  auto m = std::vector<double>(dock_ids.size() * n_targets, kUnreachableWalk);
+  for (auto d = 0U; d != dock_ids.size(); ++d) {
+    auto const row = d * n_targets;
+    if (auto const it = walks.docks_.find(dock_ids[d]);
+        it != end(walks.docks_)) {
+      for (auto s = 0U; s != station_ids.size(); ++s) {
+        if (auto const w = it->second.walks_.find(station_ids[s]);
+            w != end(it->second.walks_)) {
+          m[row + s] = fwd ? w->second.to_station_ : w->second.from_station_;
+        }
+      }
+    }
+    if (live != nullptr) {
+      for (auto j = 0U; j != n_direct; ++j) {
+        m[row + station_ids.size() + j] =
+            live->Get(fwd ? d * n_direct + j : j * dock_ids.size() + d);
+      }
+    }
+  }
+  return m;
+}
+
+}  // namespace motis::gbfs
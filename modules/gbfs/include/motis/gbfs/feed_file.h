@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include "net/http/client/request.h"
+#include "net/http/client/response.h"
+
+#include "motis/core/common/unixtime.h"
+
+namespace motis::gbfs {
+
+// Fetch state of a single GBFS file. The file is due again when its ttl
+// (counted from last_updated if available) has expired. Requests carry the
+// validators of the last response (If-None-Match / If-Modified-Since).
+struct feed_file {
+  bool due(unixtime now) const;
+
+  // Resets the state if the URL changed.
+  net::http::client::request make_request(std::string const& url);
+
+  // Returns true if the body differs from the stored version.
+  // 304 Not Modified and identical bodies count as unchanged.
+  // min_refresh: lower bound (seconds) until the file is due again.
+  bool update(net::http::client::response const&, unixtime now,
+              unixtime min_refresh = 0);
+
+  std::string url_, etag_, last_modified_, body_;
+  unixtime ttl_{0}, next_fetch_{0};
+  bool valid_{false};  // body_ holds a fetched version
+};
+
+}  // namespace motis::gbfs
@@ -10,6 +10,8 @@ namespace motis::gbfs {
 
 struct config {
   unsigned update_interval_minutes_{5U};
+  unsigned static_refresh_interval_minutes_{60U};
+  unsigned dock_walk_duration_{15U};
   std::vector<std::string> urls_;
   size_t db_size_{sizeof(void*) >= 8 ? 1024ULL * 1024 * 1024 * 1024
                                      : 256 * 1024 * 1024};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "net/http/client/request.h"
+
+#include "motis/core/schedule/station_lookup.h"
+#include "motis/module/context/motis_http_req.h"
+#include "motis/gbfs/feed_file.h"
+#include "motis/gbfs/gbfs.h"
+#include "motis/gbfs/routing.h"
+#include "motis/gbfs/snapshot_map.h"
+#include "motis/gbfs/system_status.h"
+#include "motis/gbfs/tiles_database.h"
+
+namespace motis::gbfs {
+
+// Fetch state of all files of a provider. Only accessed by the update.
+struct provider_feeds {
+  feed_file discovery_, station_info_, station_status_, free_bikes_,
+      system_info_;
+  urls urls_;
+};
+
+// Two tiles databases per provider: the next version is written to the one
+// that is not referenced by the current snapshot.
+using tiles_slots = std::array<std::shared_ptr<tiles_database>, 2U>;
+
+// Sends a GBFS file request (motis_http outside of tests).
+using fetch_fn_t =
+    std::function<module::http_future_t(net::http::client::request)>;
+
+// Fetches the feeds of a provider and publishes a new snapshot if anything
+// changed. Updates of different providers may run in parallel.
+struct provider_updater {
+  provider_updater(std::filesystem::path data_dir, config const&,
+                   std::shared_ptr<shared_station_lookup>, fetch_fn_t);
+
+  // nullptr if the provider has no snapshot (yet).
+  std::shared_ptr<provider_status const> get(std::string_view tag) const;
+
+  // config_url: entry of config.urls_ ("tag-vehicle_type|url").
+  // Throws on failure: the next update fetches all files again.
+  void update(std::string const& config_url);
+
+  snapshot_map<provider_status> providers_;
+
+private:
+  // Returns nullptr if the spare database is still in use by readers.
+  std::shared_ptr<tiles_database> get_spare_tiles(
+      std::string const& tag, provider_status const* current);
+
+  provider_feeds& get_feeds(std::string const& config_url);
+
+  config const& config_;
+  std::shared_ptr<shared_station_lookup> st_;
+  fetch_fn_t fetch_;
+  std::filesystem::path data_dir_;
+  std::mutex feeds_mutex_;
+  std::map<std::string, provider_feeds> feeds_;  // by config URL
+  std::mutex tiles_mutex_;
+  std::map<std::string, tiles_slots> tiles_slots_;
+};
+
+}  // namespace motis::gbfs
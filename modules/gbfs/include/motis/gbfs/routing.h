@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geo/point_rtree.h"
+
+#include "utl/to_vec.h"
+
+#include "motis/core/schedule/station_lookup.h"
+#include "motis/module/message.h"
+#include "motis/gbfs/dock_walks.h"
+#include "motis/gbfs/free_bike.h"
+#include "motis/gbfs/station.h"
+#include "motis/gbfs/system_information.h"
+
+namespace motis::gbfs {
+
+struct tiles_database;
+
+// Stations or free vehicles of a feed with their rtree.
+template <typename T>
+struct feed_part {
+  feed_part() = default;
+  explicit feed_part(std::vector<T> entries)
+      : entries_{std::move(entries)},
+        rtree_{geo::make_point_rtree(
+            utl::to_vec(entries_, [](auto&& x) { return x.pos_; }))} {}
+
+  std::vector<T> entries_;
+  geo::point_rtree rtree_;
+};
+
+using stations_part = feed_part<station>;
+using free_bikes_part = feed_part<free_bike>;
+
+// Shared by all snapshots without entries (no such feed).
+template <typename T>
+std::shared_ptr<feed_part<T> const> const& no_entries() {
+  static auto const empty = std::make_shared<feed_part<T> const>();
+  return empty;
+}
+
+// Immutable once published. Readers keep the snapshot (and its tiles
+// database) alive for the duration of a request. Parts that did not
+// change are shared with the previous snapshot.
+struct provider_status {
+  system_information info_;
+  std::string vehicle_type_;
+  std::shared_ptr<stations_part const> stations_{no_entries<station>()};
+  std::shared_ptr<free_bikes_part const> free_bikes_{
+      no_entries<free_bike>()};
+  std::shared_ptr<dock_walks const> dock_walks_{
+      std::make_shared<dock_walks const>()};
+  std::shared_ptr<tiles_database> tiles_;
+  bool tiles_current_{false};  // tiles_ matches stations_ and free_bikes_
+};
+
+// Walks between docks and nearby PT stations do not change between
+// updates: only docks that are new or moved are routed. A new station
+// lookup (timetable reload) invalidates all walks.
+// max_duration (minutes) 0 disables the precomputation.
+dock_walks compute_dock_walks(std::string const& tag,
+                              std::shared_ptr<station_lookup const> const& st,
+                              std::vector<station> const& stations,
+                              provider_status const* prev,
+                              unsigned max_duration);
+
+// Answers a GBFSRoutingRequest on one provider snapshot. st has to stay
+// alive until the response is built: the stations in it are referenced.
+module::msg_ptr route(provider_status const& info,
+                      std::shared_ptr<station_lookup const> const& st,
+                      module::msg_ptr const& m);
+
+}  // namespace motis::gbfs
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "motis/hash_map.h"
+
+namespace motis::gbfs {
+
+struct snapshot_diff {
+  bool empty() const {
+    return added_ == 0U && removed_ == 0U && changed_ == 0U;
+  }
+
+  std::size_t added_{0U}, removed_{0U}, changed_{0U};
+};
+
+// Matches entries (stations, free bikes) by id_. Order does not matter.
+template <typename T>
+snapshot_diff diff(std::vector<T> const& prev, std::vector<T> const& next) {
+  struct prev_entry {
+    T const* x_;
+    bool matched_;
+  };
+  auto prev_by_id = mcd::hash_map<std::string_view, prev_entry>{};
+  for (auto const& x : prev) {
+    prev_by_id.emplace(x.id_, prev_entry{&x, false});
+  }
+
+  auto d = snapshot_diff{};
+  for (auto const& x : next) {
+    if (auto const it = prev_by_id.find(x.id_); it == end(prev_by_id)) {
+      ++d.added_;
+    } else {
+      it->second.matched_ = true;
+      if (*it->second.x_ != x) {
+        ++d.changed_;
+      }
+    }
+  }
+  for (auto const& [id, e] : prev_by_id) {
+    if (!e.matched_) {
+      ++d.removed_;
+    }
+  }
+  return d;
+}
+
+}  // namespace motis::gbfs
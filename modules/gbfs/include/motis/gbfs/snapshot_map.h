@@ -0,0 +1,44 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "motis/core/common/atomic_shared_ptr.h"
+
+namespace motis::gbfs {
+
+// Immutable per-provider snapshots. Readers load the current map without
+// blocking and keep the snapshots they use alive. Writers replace a single
+// entry by publishing a new copy of the map.
+template <typename T>
+struct snapshot_map {
+  using map_t = std::map<std::string, std::shared_ptr<T const>, std::less<>>;
+
+  snapshot_map() { map_.store(std::make_shared<map_t const>()); }
+
+  std::shared_ptr<map_t const> load() const { return map_.load(); }
+
+  std::shared_ptr<T const> get(std::string_view tag) const {
+    auto const m = load();
+    auto const it = m->find(tag);
+    return it == end(*m) ? nullptr : it->second;
+  }
+
+  void set(std::string const& tag, std::shared_ptr<T const> x) {
+    auto const lock = std::lock_guard{write_mutex_};
+    auto next = std::make_shared<map_t>(*map_.load());
+    (*next)[tag] = std::move(x);
+    map_.store(std::move(next));
+  }
+
+private:
+  std::mutex write_mutex_;
+  atomic_shared_ptr<map_t const> map_;
+};
+
+}  // namespace motis::gbfs
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+#include "lmdb/lmdb.hpp"
+
+#include "geo/tile.h"
+
+#include "tiles/db/pack_file.h"
+#include "tiles/db/tile_database.h"
+#include "tiles/get_tile.h"
+
+namespace motis::gbfs {
+
+struct provider_status;
+
+struct tiles_database {
+  explicit tiles_database(std::string const& path, size_t const db_size)
+      : db_env_{tiles::make_tile_database(path.c_str(), db_size)},
+        db_handle_{db_env_},
+        render_ctx_{tiles::make_render_ctx(db_handle_)},
+        pack_handle_{path.c_str()} {}
+
+  ~tiles_database() = default;
+
+  tiles_database(tiles_database&&) = delete;
+  tiles_database(tiles_database const&) = delete;
+
+  tiles_database& operator=(tiles_database&&) = delete;
+  tiles_database& operator=(tiles_database const&) = delete;
+
+  void clear();
+
+  lmdb::env db_env_;
+  tiles::tile_db_handle db_handle_;
+  tiles::render_ctx render_ctx_;
+  tiles::pack_handle pack_handle_;
+};
+
+// Replaces the content with the stations (layer "station") and free
+// vehicles (layer "vehicle") of the snapshot. Feature ids are derived from
+// the GBFS ids: they are stable across snapshots.
+void write_tiles(tiles_database&, provider_status const&,
+                 std::string const& tag);
+
+// Deflate compressed Mapbox vector tile, nullopt if the tile is empty.
+std::optional<std::string> get_tile(tiles_database const&, geo::tile const&);
+
+}  // namespace motis::gbfs
@@ -0,0 +1,91 @@
+#include "motis/gbfs/feed_file.h"
+
+#include <algorithm>
+#include <tuple>
+#include <utility>
+
+#include "rapidjson/document.h"
+
+#include "utl/verify.h"
+
+namespace motis::gbfs {
+
+namespace {
+
+// GBFS v2 last_updated is a POSIX timestamp, v3 uses RFC 3339 strings
+// which are ignored here (ttl is then counted from the fetch).
+std::pair<unixtime, unixtime> read_ttl(std::string const& body) {
+  rapidjson::Document doc;
+  if (doc.Parse(body.data(), body.size()).HasParseError() ||
+      !doc.IsObject()) {
+    return {0, 0};  // reported by the file specific parser
+  }
+
+  auto ttl = unixtime{0};
+  if (auto const it = doc.FindMember("ttl");
+      it != doc.MemberEnd() && it->value.IsInt64()) {
+    ttl = std::max(unixtime{0}, it->value.GetInt64());
+  }
+
+  auto last_updated = unixtime{0};
+  if (auto const it = doc.FindMember("last_updated");
+      it != doc.MemberEnd() && it->value.IsInt64()) {
+    last_updated = it->value.GetInt64();
+  }
+
+  return {ttl, last_updated};
+}
+
+std::string get_header(net::http::client::response const& res,
+                       char const* key) {
+  auto const it = res.headers.find(key);
+  return it == end(res.headers) ? std::string{} : it->second;
+}
+
+}  // namespace
+
+bool feed_file::due(unixtime const now) const {
+  return !valid_ || now >= next_fetch_;
+}
+
+net::http::client::request feed_file::make_request(std::string const& url) {
+  if (url != url_) {
+    *this = feed_file{};
+    url_ = url;
+  }
+
+  auto req = net::http::client::request{url};
+  if (valid_ && !etag_.empty()) {
+    req.headers.emplace("If-None-Match", etag_);
+  }
+  if (valid_ && !last_modified_.empty()) {
+    req.headers.emplace("If-Modified-Since", last_modified_);
+  }
+  return req;
+}
+
+bool feed_file::update(net::http::client::response const& res,
+                       unixtime const now, unixtime const min_refresh) {
+  auto changed = false;
+  auto last_updated = unixtime{0};
+  if (res.status_code == 304U) {
+    utl::verify(valid_, "GBFS {}: not modified, but no version stored", url_);
+  } else {
+    utl::verify(res.status_code == 200U, "GBFS {}: HTTP status {}", url_,
+                res.status_code);
+    etag_ = get_header(res, "etag");
+    last_modified_ = get_header(res, "last-modified");
+    changed = !valid_ || res.body != body_;
+    if (changed) {
+      std::tie(ttl_, last_updated) = read_ttl(res.body);
+      body_ = res.body;
+      valid_ = true;
+    }
+  }
+
+  auto const expires = last_updated != 0 ? last_updated + ttl_ : now + ttl_;
+  next_fetch_ = std::max(expires, now + min_refresh);
+  return changed;
+}
+
+}  // namespace motis::gbfs
@@ -0,0 +1,239 @@
+#include "motis/gbfs/provider_updater.h"
+
+#include <chrono>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "utl/to_vec.h"
+#include "utl/verify.h"
+
+#include "motis/core/common/logging.h"
+#include "motis/core/common/raii.h"
+#include "motis/gbfs/free_bike.h"
+#include "motis/gbfs/snapshot_diff.h"
+#include "motis/gbfs/station.h"
+#include "motis/gbfs/system_information.h"
+
+namespace fs = std::filesystem;
+using namespace motis::logging;
+using namespace motis::module;
+
+namespace motis::gbfs {
+
+namespace {
+
+// Keeps the part of the previous snapshot if the parsed entries are the
+// same: no rtree rebuild, tiles and dock walks stay valid.
+template <typename T>
+std::shared_ptr<feed_part<T> const> next_part(
+    std::string const& tag, char const* name, provider_status const* prev,
+    std::shared_ptr<feed_part<T> const> provider_status::*part,
+    std::vector<T> entries) {
+  if (prev != nullptr) {
+    auto const& prev_part = prev->*part;
+    auto const d = diff(prev_part->entries_, entries);
+    l(logging::debug, "GBFS {} {}: {} added, {} removed, {} changed", tag,
+      name, d.added_, d.removed_, d.changed_);
+    if (d.empty() && prev_part->entries_.size() == entries.size()) {
+      return prev_part;
+    }
+  }
+  return std::make_shared<feed_part<T> const>(std::move(entries));
+}
+
+}  // namespace
+
+provider_updater::provider_updater(fs::path data_dir, config const& c,
+                                   std::shared_ptr<shared_station_lookup> st,
+                                   fetch_fn_t fetch)
+    : config_{c},
+      st_{std::move(st)},
+      fetch_{std::move(fetch)},
+      data_dir_{std::move(data_dir)} {}
+
+std::shared_ptr<provider_status const> provider_updater::get(
+    std::string_view tag) const {
+  return providers_.get(tag);
+}
+
+std::shared_ptr<tiles_database> provider_updater::get_spare_tiles(
+    std::string const& tag, provider_status const* current) {
+  auto const lock = std::scoped_lock{tiles_mutex_};
+  auto& slots = tiles_slots_[tag];
+  for (auto i = 0U; i != slots.size(); ++i) {
+    auto& db = slots[i];
+    if (current != nullptr && db == current->tiles_) {
+      continue;
+    }
+    if (db == nullptr) {
+      fs::create_directories(data_dir_);
+      db = std::make_shared<tiles_database>(
+          (data_dir_ / (tag + (i == 0U ? "tiles.mdb" : "tiles-1.mdb")))
+              .string(),
+          config_.db_size_);
+    }
+    return db.use_count() == 1 ? db : nullptr;
+  }
+  return nullptr;
+}
+
+provider_feeds& provider_updater::get_feeds(std::string const& config_url) {
+  auto const lock = std::scoped_lock{feeds_mutex_};
+  return feeds_[config_url];
+}
+
+void provider_updater::update(std::string const& config_url) {
+  auto url = config_url;
+  auto tag = std::string{"default"};
+  auto vehicle_type = std::string{"bike"};
+  auto const tag_pos = url.find('|');
+  if (tag_pos != std::string::npos) {
+    tag = url.substr(0, tag_pos);
+
+    auto const vehicle_type_delimiter = tag.find('-');
+    if (vehicle_type_delimiter != std::string::npos) {
+      vehicle_type = tag.substr(vehicle_type_delimiter + 1);
+      tag = tag.substr(0, vehicle_type_delimiter);
+    }
+
+    url = url.substr(tag_pos + 1);
+  }
+
+  // Without a published snapshot, the next update fetches everything.
+  auto& feeds = get_feeds(config_url);
+  auto published = false;
+  MOTIS_FINALLY([&]() {
+    if (!published) {
+      feeds = provider_feeds{};
+    }
+  });
+
+  auto const now = std::chrono::duration_cast<std::chrono::seconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+  auto const static_refresh =
+      static_cast<unixtime>(config_.static_refresh_interval_minutes_) * 60;
+
+  auto urls_changed = false;
+  if (feeds.discovery_.due(now)) {
+    urls_changed = feeds.discovery_.update(
+        fetch_(feeds.discovery_.make_request(url))->val(), now,
+        static_refresh);
+    if (urls_changed) {
+      auto const s = read_system_status(feeds.discovery_.body_);
+      if (s.empty()) {
+        l(warn, "no feeds from {}", url);
+        return;
+      }
+      feeds.urls_ = s.front();
+    }
+  }
+
+  auto const& urls = feeds.urls_;
+  auto const fetch = [&](feed_file& f,
+                         std::optional<std::string> const& file_url) {
+    return file_url.has_value() && f.due(now)
+               ? fetch_(f.make_request(*file_url))
+               : http_future_t{};
+  };
+  auto const update = [&](feed_file& f, http_future_t const& fut,
+                          unixtime const min_refresh) {
+    return fut != nullptr && f.update(fut->val(), now, min_refresh);
+  };
+
+  auto const f_station_info =
+      fetch(feeds.station_info_, urls.station_info_url_);
+  auto const f_station_status =
+      fetch(feeds.station_status_, urls.station_status_url_);
+  auto const f_free_bikes = fetch(feeds.free_bikes_, urls.free_bike_url_);
+  auto const f_system_info =
+      fetch(feeds.system_info_, urls.system_information_url_);
+
+  // Evaluate all updates: each one stores the new version.
+  auto const station_info_updated =
+      update(feeds.station_info_, f_station_info, static_refresh);
+  auto const station_status_updated =
+      update(feeds.station_status_, f_station_status, 0);
+  auto const free_bikes_updated = update(feeds.free_bikes_, f_free_bikes, 0);
+  auto const system_info_updated =
+      update(feeds.system_info_, f_system_info, static_refresh);
+
+  auto const prev = providers_.get(tag);
+  auto const st = st_->load();
+  auto const dock_walks_outdated = urls.station_info_url_.has_value() &&
+                                   prev != nullptr &&
+                                   !prev->dock_walks_->computed_with(st);
+  auto const rebuild =
+      prev == nullptr || prev->vehicle_type_ != vehicle_type || urls_changed;
+  auto const stations_changed =
+      rebuild || station_info_updated || station_status_updated;
+  auto const free_bikes_changed = rebuild || free_bikes_updated;
+  auto const system_info_changed = rebuild || system_info_updated;
+  if (!stations_changed && !free_bikes_changed && !system_info_changed &&
+      !dock_walks_outdated && prev->tiles_current_) {
+    l(logging::debug, "GBFS {}: feeds unchanged", tag);
+    published = true;
+    return;
+  }
+
+  auto next = std::make_shared<provider_status>();
+  auto& info = *next;
+  info.vehicle_type_ = vehicle_type;
+  if (urls.station_info_url_.has_value()) {
+    if (stations_changed) {
+      auto stations =
+          utl::to_vec(parse_stations(tag, feeds.station_info_.body_,
+                                     feeds.station_status_.body_),
+                      [](auto const& el) { return el.second; });
+      info.stations_ = next_part(tag, "stations", prev.get(),
+                                 &provider_status::stations_,
+                                 std::move(stations));
+    } else {
+      info.stations_ = prev->stations_;
+    }
+    info.dock_walks_ =
+        prev != nullptr && info.stations_ == prev->stations_ &&
+                !dock_walks_outdated
+            ? prev->dock_walks_
+            : std::make_shared<dock_walks const>(compute_dock_walks(
+                  tag, st, info.stations_->entries_, prev.get(),
+                  config_.dock_walk_duration_));
+  }
+  if (urls.free_bike_url_.has_value()) {
+    info.free_bikes_ =
+        free_bikes_changed
+            ? next_part(tag, "free vehicles", prev.get(),
+                        &provider_status::free_bikes_,
+                        parse_free_bikes(tag, feeds.free_bikes_.body_))
+            : prev->free_bikes_;
+  }
+  if (urls.system_information_url_.has_value()) {
+    info.info_ = system_info_changed
+                     ? read_system_information(feeds.system_info_.body_)
+                     : prev->info_;
+  }
+
+  auto const tiles_changed = rebuild || !prev->tiles_current_ ||
+                             info.stations_ != prev->stations_ ||
+                             info.free_bikes_ != prev->free_bikes_;
+  if (!tiles_changed) {
+    l(logging::debug, "GBFS {}: tiles unchanged", tag);
+    info.tiles_ = prev->tiles_;
+    info.tiles_current_ = true;
+  } else if (auto db = get_spare_tiles(tag, prev.get()); db != nullptr) {
+    write_tiles(*db, info, tag);
+    info.tiles_ = std::move(db);
+    info.tiles_current_ = true;
+  } else {
+    l(logging::warn, "GBFS {}: tiles database still in use, tiles outdated",
+      tag);
+    info.tiles_ = prev->tiles_;
+    info.tiles_current_ = false;
+  }
+
+  providers_.set(tag, std::move(next));
+  published = true;
+}
+
+}  // namespace motis::gbfs
@@ -0,0 +1,608 @@
+#include "motis/gbfs/routing.h"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <ostream>
+#include <variant>
+
+#include "utl/concat.h"
+#include "utl/enumerate.h"
+#include "utl/erase_duplicates.h"
+#include "utl/overloaded.h"
+#include "utl/pipes.h"
+#include "utl/to_vec.h"
+#include "utl/verify.h"
+
+#include "motis/core/common/logging.h"
+#include "motis/core/conv/position_conv.h"
+#include "motis/module/context/motis_call.h"
+#include "motis/module/context/motis_parallel_for.h"
+
+namespace fbs = flatbuffers;
+using namespace motis::logging;
+using namespace motis::module;
+
+namespace motis::gbfs {
+
+namespace {
+
+constexpr auto const bike_ready_time = 3;
+
+// Dock walks are precomputed for all PT stations within this distance
+// (m/s * duration limit). Faster than any walk the router returns, so no
+// pair that is reachable within the limit is left out.
+constexpr auto const dock_walk_radius_speed = 2.0;
+
+struct journey {
+  struct invalid {};
+  struct s {  // station bound
+    friend std::ostream& operator<<(std::ostream& out, s const& x) {
+      return out << "(STATION_BIKE: first_walk_duration="
+                 << x.first_walk_duration_
+                 << ", bike_duration=" << x.bike_duration_
+                 << ", second_walk_duration=" << x.second_walk_duration_ << ")";
+    }
+    duration first_walk_duration_{0};
+    duration bike_duration_{0};
+    duration second_walk_duration_{0};
+    uint32_t sx_, sp_, p_;
+  };
+  struct b {  // free-float
+    friend std::ostream& operator<<(std::ostream& out, b const& x) {
+      return out << "(FREE_FLOAT: first_walk_duration=" << x.walk_duration_
+                 << ", bike_duration=" << x.bike_duration_ << ")";
+    }
+    duration walk_duration_{0};
+    duration bike_duration_{0};
+    uint32_t b_, p_;
+  };
+
+  bool valid() const { return !std::holds_alternative<invalid>(info_); }
+
+  uint16_t total_duration_{std::numeric_limits<uint16_t>::max()};
+  std::variant<invalid, s, b> info_{invalid{}};
+};
+
+msg_ptr make_one_to_many(std::string const& profile, geo::latlng const& one,
+                         std::vector<geo::latlng> const& many,
+                         SearchDir direction) {
+  auto const fbs_pos = to_fbs(one);
+  message_creator mc;
+  mc.create_and_finish(MsgContent_OSRMOneToManyRequest,
+                       osrm::CreateOSRMOneToManyRequest(
+                           mc, mc.CreateString(profile), direction, &fbs_pos,
+                           mc.CreateVectorOfStructs(utl::to_vec(
+                               many, [](auto&& p) { return to_fbs(p); })))
+                           .Union(),
+                       "/osrm/one_to_many");
+  return make_msg(mc);
+}
+
+msg_ptr make_table_request(std::string const& profile,
+                           std::vector<geo::latlng> const& from,
+                           std::vector<geo::latlng> const& to) {
+  message_creator mc;
+  mc.create_and_finish(MsgContent_OSRMManyToManyRequest,
+                       osrm::CreateOSRMManyToManyRequest(
+                           mc, mc.CreateString(profile),
+                           mc.CreateVectorOfStructs(utl::to_vec(
+                               from, [](auto&& p) { return to_fbs(p); })),
+                           mc.CreateVectorOfStructs(utl::to_vec(
+                               to, [](auto&& p) { return to_fbs(p); })))
+                           .Union(),
+                       "/osrm/table");
+  return make_msg(mc);
+}
+
+msg_ptr empty_response(SearchDir const dir) {
+  message_creator fbb;
+  fbb.create_and_finish(
+      MsgContent_GBFSRoutingResponse,
+      CreateGBFSRoutingResponse(
+          fbb, dir,
+          fbb.CreateVector(std::vector<flatbuffers::Offset<RouteInfo>>{}))
+          .Union());
+  return make_msg(fbb);
+}
+
+}  // namespace
+
+dock_walks compute_dock_walks(
+    std::string const& tag, std::shared_ptr<station_lookup const> const& st,
+    std::vector<station> const& stations, provider_status const* prev,
+    unsigned const max_duration) {
+  using osrm::OSRMOneToManyResponse;
+
+  auto walks = dock_walks{.max_duration_ = max_duration, .stations_ = st};
+  if (walks.max_duration_ == 0U) {
+    return walks;
+  }
+
+  auto const reuse = prev != nullptr &&
+                     prev->dock_walks_->max_duration_ == walks.max_duration_ &&
+                     prev->dock_walks_->computed_with(st);
+  auto todo = std::vector<std::size_t>{};
+  for (auto const [i, s] : utl::enumerate(stations)) {
+    if (reuse) {
+      if (auto const it = prev->dock_walks_->docks_.find(s.id_);
+          it != end(prev->dock_walks_->docks_) && it->second.pos_ == s.pos_) {
+        walks.docks_.emplace(s.id_, it->second);
+        continue;
+      }
+    }
+    todo.emplace_back(i);
+  }
+
+  auto const radius = walks.max_duration_ * 60.0 * dock_walk_radius_speed;
+  auto computed = std::vector<dock_walks_entry>(todo.size());
+  auto todo_idx = std::vector<std::size_t>(todo.size());
+  std::iota(begin(todo_idx), end(todo_idx), 0U);
+  motis_parallel_for(todo_idx, [&](std::size_t const i) {
+    auto const& dock = stations[todo[i]];
+    auto& e = computed[i];
+    e.pos_ = dock.pos_;
+
+    auto const pt = st->in_radius(dock.pos_, radius);
+    if (pt.empty()) {
+      return;
+    }
+    auto const pt_pos =
+        utl::to_vec(pt, [](auto const& el) { return el.first.pos(); });
+    auto const f_to = motis_call(
+        make_one_to_many("foot", dock.pos_, pt_pos, SearchDir_Forward));
+    auto const f_from = motis_call(
+        make_one_to_many("foot", dock.pos_, pt_pos, SearchDir_Backward));
+    auto const to = motis_content(OSRMOneToManyResponse, f_to->val());
+    auto const from = motis_content(OSRMOneToManyResponse, f_from->val());
+    for (auto j = 0U; j != pt.size(); ++j) {
+      e.walks_.emplace(pt[j].first.id(),
+                       dock_walk{to->costs()->Get(j)->duration(),
+                                 from->costs()->Get(j)->duration()});
+    }
+  });
+
+  for (auto const [i, station_idx] : utl::enumerate(todo)) {
+    walks.docks_.emplace(stations[station_idx].id_, std::move(computed[i]));
+  }
+  l(logging::debug, "GBFS {}: dock walks computed for {} of {} stations",
+    tag, todo.size(), stations.size());
+  return walks;
+}
+
+msg_ptr route(provider_status const& info,
+              std::shared_ptr<station_lookup const> const& st,
+              msg_ptr const& m) {
+  using osrm::OSRMManyToManyResponse;
+  using osrm::OSRMOneToManyResponse;
+
+  constexpr auto const max_walk_speed = 1.1;  // m/s 4km/h
+  constexpr auto const max_bike_speed = 7.0;  // m/s 25km/h
+  constexpr auto const max_car_speed = 27.8;  // m/s 100km/h
+
+  auto const req = motis_content(GBFSRoutingRequest, m);
+
+  auto const& stations = info.stations_->entries_;
+  auto const& stations_rtree = info.stations_->rtree_;
+  auto const& free_bikes = info.free_bikes_->entries_;
+  auto const& free_bikes_rtree = info.free_bikes_->rtree_;
+  auto const& vehicle_type = info.vehicle_type_;
+  utl::verify(vehicle_type == "car" || vehicle_type == "bike",
+              "unsupported vehicle type {}", vehicle_type);
+
+  auto const max_walk_duration = req->max_foot_duration();
+  auto const max_bike_duration = req->max_bike_duration();
+  auto const max_walk_dist = max_walk_duration * 60 * max_walk_speed;
+  auto const max_bike_dist =
+      req->max_bike_duration() * 60 *
+      (vehicle_type == "bike" ? max_bike_speed : max_car_speed);
+  auto const max_total_dist = max_walk_dist + max_bike_dist;
+
+  auto const x = from_fbs(req->x());
+
+  auto const p = st->in_radius(x, max_total_dist);
+  auto const direct_pos = utl::to_vec(
+      *req->direct(), [](Position const* pos) { return from_fbs(pos); });
+  auto p_pos =
+      utl::to_vec(p, [&](std::pair<lookup_station, double> const& el) {
+        return el.first.pos();
+      });
+  utl::concat(p_pos, direct_pos);
+  if (p_pos.empty() && req->direct()->size() == 0U) {
+    l(logging::debug, "no stations found in {}km radius around {}",
+      max_total_dist / 1000.0, x);
+    return empty_response(req->dir());
+  }
+
+  auto const sx = stations_rtree.in_radius(x, max_walk_dist);
+  auto sp = std::vector<size_t>{};
+  for (auto const& pt_station_pos : p_pos) {
+    utl::concat(sp, stations_rtree.in_radius(pt_station_pos, max_walk_dist));
+  }
+  auto b = std::vector<size_t>{};
+  if (req->dir() == SearchDir_Forward) {
+    b = free_bikes_rtree.in_radius(x, max_walk_dist);
+  } else {
+    for (auto const& pos : p_pos) {
+      auto const closest = free_bikes_rtree.nearest(pos, 1U);
+      if (!closest.empty()) {
+        b.emplace_back(closest.at(0).second);
+      }
+    }
+  }
+
+  if (b.empty() && (sp.empty() || sx.empty())) {
+    l(logging::debug,
+      "no free bikes found, no stations found (max_bike_dist={}), "
+      "(max_walk_dist={})",
+      max_walk_dist, max_bike_dist);
+    return empty_response(req->dir());
+  }
+
+  auto const sx_pos =
+      utl::to_vec(sx, [&](auto const idx) { return stations.at(idx).pos_; });
+
+  utl::erase_duplicates(b);
+  auto const b_pos =
+      utl::to_vec(b, [&](auto const idx) { return free_bikes.at(idx).pos_; });
+
+  utl::erase_duplicates(sp);
+  auto const sp_pos =
+      utl::to_vec(sp, [&](auto const idx) { return stations.at(idx).pos_; });
+
+  // Dock <-> PT station walks are precomputed, only walks to and from
+  // direct positions are routed per request.
+  auto const precomputed_dock_walks =
+      info.dock_walks_->max_duration_ != 0U &&
+      max_walk_duration <= info.dock_walks_->max_duration_ &&
+      info.dock_walks_->computed_with(st);
+  auto const dock_walk_targets = precomputed_dock_walks ? direct_pos : p_pos;
+  auto const get_dock_walks = [&](future const& f) {
+    auto const dock_ids =
+        utl::to_vec(sp, [&](auto const idx) { return stations.at(idx).id_; });
+    auto const station_ids =
+        precomputed_dock_walks
+            ? utl::to_vec(p, [](auto const& el) { return el.first.id(); })
+            : std::vector<std::string>{};
+    return dock_walk_matrix(
+        *info.dock_walks_, dock_ids, station_ids, dock_walk_targets.size(),
+        f ? motis_content(OSRMManyToManyResponse, f->val())->costs()
+          : nullptr,
+        req->dir() == SearchDir_Forward);
+  };
+
+  auto p_best_journeys = std::vector<journey>{};
+  p_best_journeys.resize(p_pos.size());
+
+  auto d_best_journeys = std::vector<journey>{};
+  d_best_journeys.resize(req->direct()->size());
+
+  if (req->dir() == SearchDir_Forward) {
+    // REQUESTS
+    // free-float FWD: x --walk--> [b] --bike--> [p]
+    auto const f_x_to_b_walks =
+        b.empty() ? future{}
+                  : motis_call(make_one_to_many("foot", x, b_pos,
+                                                SearchDir_Forward));
+    auto const f_b_to_p_rides =
+        b.empty()
+            ? future{}
+            : motis_call(make_table_request(vehicle_type, b_pos, p_pos));
+
+    // REQUESTS
+    // station FWD: x --walk--> [sx] --bike--> [sp] --walk--> [p]
+    auto const f_x_to_sx_walks =
+        (sx.empty() || sp.empty())
+            ? future{}
+            : motis_call(
+                  make_one_to_many("foot", x, sx_pos, SearchDir_Forward));
+    auto const f_sx_to_sp_rides =
+        (sx.empty() || sp.empty())
+            ? future{}
+            : motis_call(make_table_request(vehicle_type, sx_pos, sp_pos));
+    auto const f_sp_to_p_walks =
+        (sx.empty() || sp.empty() || dock_walk_targets.empty())
+            ? future{}
+            : motis_call(
+                  make_table_request("foot", sp_pos, dock_walk_targets));
+
+    // BUILD JOURNEYS
+    // free-float FWD: x --walk--> [b] --bike--> [p]
+    if (f_b_to_p_rides) {
+      auto const b_to_p_table =
+          motis_content(OSRMManyToManyResponse, f_b_to_p_rides->val())
+              ->costs();
+      auto const x_to_b_costs =
+          motis_content(OSRMOneToManyResponse, f_x_to_b_walks->val())
+              ->costs();
+
+      for (auto const& [b_vec_idx, x_to_b_res] :
+           utl::enumerate(*x_to_b_costs)) {
+        auto const x_to_b_walk_duration =
+            static_cast<duration>(std::ceil(x_to_b_res->duration() / 60.0));
+        if (x_to_b_walk_duration > max_walk_duration) {
+          continue;
+        }
+
+        for (auto const& [p_vec_idx, _] : utl::enumerate(p_pos)) {
+          auto const b_to_p_duration = static_cast<duration>(std::ceil(
+              b_to_p_table->Get(b_vec_idx * p_pos.size() + p_vec_idx) /
+              60.0));
+          if (b_to_p_duration > max_bike_duration) {
+            continue;
+          }
+
+          auto const total_duration =
+              bike_ready_time + x_to_b_walk_duration + b_to_p_duration;
+          if (auto& best = p_best_journeys[p_vec_idx];
+              best.total_duration_ > total_duration) {
+            best.total_duration_ = total_duration;
+            best.info_ = journey::b{x_to_b_walk_duration, b_to_p_duration,
+                                    static_cast<uint32_t>(b_vec_idx),
+                                    static_cast<uint32_t>(p_vec_idx)};
+          }
+        }
+      }
+    }
+
+    // BUILD JOURNEYS
+    // station FWD: x --walk--> [sx] --bike--> [sp] --walk--> [p]
+    if (f_sx_to_sp_rides) {
+      auto const sx_to_sp_table =
+          motis_content(OSRMManyToManyResponse, f_sx_to_sp_rides->val())
+              ->costs();
+      auto const sp_to_p_table = get_dock_walks(f_sp_to_p_walks);
+      for (auto const [sx_vec_idx, x_to_sx_res] : utl::enumerate(
+               *motis_content(OSRMOneToManyResponse, f_x_to_sx_walks->val())
+                    ->costs())) {
+        auto const x_to_sx_walk_duration =
+            static_cast<duration>(std::ceil(x_to_sx_res->duration() / 60.0));
+        if (x_to_sx_walk_duration > max_walk_duration) {
+          continue;
+        }
+
+        for (auto const& [sp_vec_idx, sp_id] : utl::enumerate(sp)) {
+          auto const sx_to_sp_duration = static_cast<duration>(std::ceil(
+              sx_to_sp_table->Get(sx_vec_idx * sp.size() + sp_vec_idx) /
+              60.0));
+          if (sx_to_sp_duration > max_bike_duration) {
+            continue;
+          }
+
+          for (auto const& [p_vec_idx, _] : utl::enumerate(p_pos)) {
+            auto const sp_to_p_walk_duration = static_cast<duration>(
+                std::ceil(sp_to_p_table[sp_vec_idx * p_pos.size() +
+                                        p_vec_idx] /
+                          60.0));
+            if (sp_to_p_walk_duration > max_walk_duration ||
+                x_to_sx_walk_duration + sp_to_p_walk_duration >
+                    max_walk_duration) {
+              continue;
+            }
+
+            auto const total_duration =
+                bike_ready_time + x_to_sx_walk_duration + sx_to_sp_duration +
+                sp_to_p_walk_duration;
+            if (auto& best = p_best_journeys[p_vec_idx];
+                best.total_duration_ > total_duration) {
+              best.total_duration_ = total_duration;
+              best.info_ = journey::s{x_to_sx_walk_duration,
+                                      sx_to_sp_duration,
+                                      sp_to_p_walk_duration,
+                                      static_cast<uint32_t>(sx_vec_idx),
+                                      static_cast<uint32_t>(sp_vec_idx),
+                                      static_cast<uint32_t>(p_vec_idx)};
+            }
+          }
+        }
+      }
+    }
+  } else {
+    // REQUESTS
+    // free-float BWD: [p] --walk--> [b] --bike--> x
+    auto const f_p_to_b_walks =
+        b_pos.empty() ? future{}
+                      : motis_call(make_table_request("foot", p_pos, b_pos));
+    auto const f_b_to_x_rides =
+        b_pos.empty() ? future{}
+                      : motis_call(make_one_to_many(vehicle_type, x, b_pos,
+                                                    SearchDir_Backward));
+
+    // REQUESTS
+    // station BWD: [p] --walk--> [sp] --bike--> [sx] --walk--> x
+    auto const f_p_to_sp_walks =
+        (sp_pos.empty() || sx_pos.empty() || dock_walk_targets.empty())
+            ? future{}
+            : motis_call(
+                  make_table_request("foot", dock_walk_targets, sp_pos));
+    auto const f_sp_to_sx_rides =
+        (sp_pos.empty() || sx_pos.empty())
+            ? future{}
+            : motis_call(make_table_request(vehicle_type, sp_pos, sx_pos));
+    auto const f_sx_to_x_walks =
+        (sp_pos.empty() || sx_pos.empty())
+            ? future{}
+            : motis_call(
+                  make_one_to_many("foot", x, sx_pos, SearchDir_Backward));
+
+    // BUILD JOURNEYS
+    // free-float BWD: [p] --walk--> [b] --bike--> x
+    if (f_p_to_b_walks) {
+      auto const p_to_b_table =
+          motis_content(OSRMManyToManyResponse, f_p_to_b_walks->val())
+              ->costs();
+      for (auto const& [b_vec_idx, b_to_x_res] : utl::enumerate(
+               *motis_content(OSRMOneToManyResponse, f_b_to_x_rides->val())
+                    ->costs())) {
+        auto const b_to_x_bike_duration =
+            static_cast<duration>(std::ceil(b_to_x_res->duration() / 60.0));
+        if (b_to_x_bike_duration > max_bike_duration) {
+          continue;
+        }
+
+        for (auto const& [p_vec_idx, p_id] : utl::enumerate(p)) {
+          auto const p_to_b_walk_duration = static_cast<duration>(std::ceil(
+              p_to_b_table->Get(p_vec_idx * b.size() + b_vec_idx) / 60.0));
+          if (p_to_b_walk_duration > max_walk_duration) {
+            continue;
+          }
+
+          auto const total_duration =
+              p_to_b_walk_duration + b_to_x_bike_duration;
+          if (auto& best = p_best_journeys[p_vec_idx];
+              best.total_duration_ > total_duration) {
+            best.total_duration_ = total_duration;
+            best.info_ =
+                journey::b{p_to_b_walk_duration, b_to_x_bike_duration,
+                           static_cast<uint32_t>(b_vec_idx),
+                           static_cast<uint32_t>(p_vec_idx)};
+          }
+        }
+      }
+    }
+
+    // BUILD JOURNEYS
+    // station BWD: [p] --walk--> [sp] --bike--> [sx] --walk--> x
+    if (f_p_to_b_walks && f_sp_to_sx_rides) {
+      auto const p_to_sp_table = get_dock_walks(f_p_to_sp_walks);
+      auto const sp_to_sx_table =
+          motis_content(OSRMManyToManyResponse, f_sp_to_sx_rides->val())
+              ->costs();
+      for (auto const [sx_vec_idx, sx_to_x_res] : utl::enumerate(
+               *motis_content(OSRMOneToManyResponse, f_sx_to_x_walks->val())
+                    ->costs())) {
+        auto const sx_to_x_walk_duration =
+            static_cast<duration>(std::ceil(sx_to_x_res->duration() / 60.0));
+        if (sx_to_x_walk_duration > max_walk_duration) {
+          continue;
+        }
+
+        for (auto const& [sp_vec_idx, sp_id] : utl::enumerate(sp)) {
+          if (stations.at(sp.at(sp_vec_idx)).bikes_available_ == 0) {
+            continue;
+          }
+
+          auto const sp_to_sx_duration = static_cast<duration>(std::ceil(
+              sp_to_sx_table->Get(sp_vec_idx * sx.size() + sx_vec_idx) /
+              60.0));
+
+          if (sp_to_sx_duration > max_bike_duration) {
+            continue;
+          }
+
+          for (auto const& [p_vec_idx, p_id] : utl::enumerate(p)) {
+            auto const p_to_sp_walk_duration =
+                static_cast<duration>(std::ceil(
+                    p_to_sp_table[sp_vec_idx * p_pos.size() + p_vec_idx] /
+                    60.0));
+            if (p_to_sp_walk_duration > max_walk_duration ||
+                p_to_sp_walk_duration + sx_to_x_walk_duration >
+                    max_walk_duration) {
+              continue;
+            }
+
+            auto const total_duration =
+                bike_ready_time + p_to_sp_walk_duration + sp_to_sx_duration +
+                sx_to_x_walk_duration;
+            if (auto& best = p_best_journeys[p_vec_idx];
+                best.total_duration_ > total_duration) {
+              best.total_duration_ = total_duration;
+              best.info_ = journey::s{p_to_sp_walk_duration,
+                                      sp_to_sx_duration,
+                                      sx_to_x_walk_duration,
+                                      static_cast<uint32_t>(sx_vec_idx),
+                                      static_cast<uint32_t>(sp_vec_idx),
+                                      static_cast<uint32_t>(p_vec_idx)};
+            }
+          }
+        }
+      }
+    }
+  }
+
+  message_creator fbb;
+  auto const routes =
+      utl::all(p_best_journeys)  //
+      | utl::remove_if([](journey const& j) { return !j.valid(); })  //
+      |
+      utl::transform([&](journey const& j) {
+        return std::visit(
+            utl::overloaded{
+                [&](journey::invalid const&) -> fbs::Offset<RouteInfo> {
+                  throw std::runtime_error{"unreachable"};
+                },
+
+                [&](journey::b const& free_bike_info) {
+                  auto const& free_bike =
+                      free_bikes.at(b.at(free_bike_info.b_));
+                  auto const pos = to_fbs(free_bike.pos_);
+                  return CreateRouteInfo(
+                      fbb, fbb.CreateString(vehicle_type),
+                      free_bike_info.p_ < p.size() ? P_Station : P_Direct,
+                      free_bike_info.p_ < p.size()
+                          ? p.at(free_bike_info.p_).first.to_fbs(fbb).Union()
+                          : CreateDirect(
+                                fbb, req->direct()->Get(free_bike_info.p_ -
+                                                        p.size()))
+                                .Union(),
+                      BikeRoute_FreeBikeRoute,
+                      CreateFreeBikeRoute(
+                          fbb, fbb.CreateString(free_bike.id_), &pos,
+                          free_bike_info.walk_duration_ + bike_ready_time,
+                          free_bike_info.bike_duration_)
+                          .Union(),
+                      j.total_duration_);
+                },
+
+                [&](journey::s const& station_bike_info) {
+                  auto const& sx_bike_station =
+                      stations.at(sx.at(station_bike_info.sx_));
+                  auto const& sp_bike_station =
+                      stations.at(sp.at(station_bike_info.sp_));
+                  auto const sx_pos = to_fbs(sx_bike_station.pos_);
+                  auto const sp_pos = to_fbs(sp_bike_station.pos_);
+                  auto const sx_gbfs_station = CreateGBFSStation(
+                      fbb, fbb.CreateString(sx_bike_station.id_),
+                      fbb.CreateString(sx_bike_station.name_), &sx_pos);
+                  auto const sp_gbfs_station = CreateGBFSStation(
+                      fbb, fbb.CreateString(sp_bike_station.id_),
+                      fbb.CreateString(sp_bike_station.name_), &sp_pos);
+                  return CreateRouteInfo(
+                      fbb, fbb.CreateString(vehicle_type),
+                      station_bike_info.p_ < p.size() ? P_Station : P_Direct,
+                      station_bike_info.p_ < p.size()
+                          ? p.at(station_bike_info.p_)
+                                .first.to_fbs(fbb)
+                                .Union()
+                          : CreateDirect(
+                                fbb, req->direct()->Get(station_bike_info.p_ -
+                                                        p.size()))
+                                .Union(),
+                      BikeRoute_StationBikeRoute,
+                      CreateStationBikeRoute(
+                          fbb,
+                          req->dir() == SearchDir_Forward ? sx_gbfs_station
+                                                          : sp_gbfs_station,
+                          req->dir() == SearchDir_Forward ? sp_gbfs_station
+                                                          : sx_gbfs_station,
+                          station_bike_info.first_walk_duration_ +
+                              bike_ready_time,
+                          station_bike_info.bike_duration_,
+                          station_bike_info.second_walk_duration_)
+                          .Union(),
+                      j.total_duration_);
+                },
+            },
+            j.info_);
+      })  //
+      | utl::vec();
+
+  fbb.create_and_finish(
+      MsgContent_GBFSRoutingResponse,
+      CreateGBFSRoutingResponse(fbb, req->dir(), fbb.CreateVector(routes))
+          .Union());
+
+  return make_msg(fbb);
+}
+
+}  // namespace motis::gbfs
@@ -0,0 +1,83 @@
+#include "motis/gbfs/tiles_database.h"
+
+#include "cista/hash.h"
+
+#include "tiles/db/clear_database.h"
+#include "tiles/db/feature_inserter_mt.h"
+#include "tiles/feature/feature.h"
+#include "tiles/fixed/convert.h"
+#include "tiles/perf_counter.h"
+
+#include "motis/gbfs/routing.h"
+
+namespace motis::gbfs {
+
+constexpr auto const kMinZoomLevel = 10;
+
+void tiles_database::clear() {
+  lmdb::txn txn{db_handle_.env_};
+  tiles::clear_database(db_handle_, txn);
+  txn.commit();
+
+  pack_handle_.resize(0);
+}
+
+void write_tiles(tiles_database& db, provider_status const& info,
+                 std::string const& tag) {
+  db.clear();
+
+  tiles::layer_names_builder layer_names;
+  auto const free_bike_layer_id = layer_names.get_layer_idx("vehicle");
+  auto const station_bike_layer_id = layer_names.get_layer_idx("station");
+
+  {  // the inserter flushes the features when it goes out of scope
+    auto feature_inserter = tiles::feature_inserter_mt{
+        tiles::dbi_handle{db.db_handle_, db.db_handle_.features_dbi_opener()},
+        db.pack_handle_};
+
+    for (auto const& nfo : info.free_bikes_->entries_) {
+      tiles::feature f;
+      f.id_ = cista::hash(nfo.id_);
+      f.layer_ = free_bike_layer_id;
+      f.zoom_levels_ = {kMinZoomLevel, tiles::kMaxZoomLevel};
+      f.meta_.emplace_back("type", tiles::encode_string(info.vehicle_type_));
+      f.meta_.emplace_back("tag", tiles::encode_string(tag));
+      f.meta_.emplace_back("id", tiles::encode_string(nfo.id_));
+      f.geometry_ = tiles::fixed_point{
+          {tiles::latlng_to_fixed({nfo.pos_.lat_, nfo.pos_.lng_})}};
+      feature_inserter.insert(f);
+    }
+
+    for (auto const& nfo : info.stations_->entries_) {
+      tiles::feature f;
+      f.id_ = cista::hash(nfo.id_);
+      f.layer_ = station_bike_layer_id;
+      f.zoom_levels_ = {kMinZoomLevel, tiles::kMaxZoomLevel};
+      f.meta_.emplace_back("type", tiles::encode_string(info.vehicle_type_));
+      f.meta_.emplace_back("tag", tiles::encode_string(tag));
+      f.meta_.emplace_back("name", tiles::encode_string(nfo.name_));
+      f.meta_.emplace_back("id", tiles::encode_string(nfo.id_));
+      f.meta_.emplace_back("vehicles_available",
+                           tiles::encode_integer(nfo.bikes_available_));
+      f.geometry_ = tiles::fixed_point{
+          {tiles::latlng_to_fixed({nfo.pos_.lat_, nfo.pos_.lng_})}};
+      feature_inserter.insert(f);
+    }
+  }
+
+  {
+    auto txn = db.db_handle_.make_txn();
+    layer_names.store(db.db_handle_, txn);
+    txn.commit();
+  }
+
+  db.render_ctx_ = tiles::make_render_ctx(db.db_handle_);
+}
+
+std::optional<std::string> get_tile(tiles_database const& db,
+                                    geo::tile const& t) {
+  tiles::null_perf_counter pc;
+  return tiles::get_tile(db.db_handle_, db.pack_handle_, db.render_ctx_, t, pc);
+}
+
+}  // namespace motis::gbfs
@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+
+#include "motis/gbfs/dock_walks.h"
+
+using namespace motis::gbfs;
+
+namespace {
+
+struct live_table {
+  double Get(std::size_t const i) const { return costs_.at(i); }
+  std::vector<double> costs_;
+};
+
+dock_walks make_walks() {
+  auto walks = dock_walks{.max_duration_ = 15U};
+  auto& a = walks.docks_["a"];
+  a.pos_ = {48.1, 9.1};
+  a.walks_.emplace("s1", dock_walk{60.0, 70.0});
+  a.walks_.emplace("s2", dock_walk{120.0, 130.0});
+  auto& b = walks.docks_["b"];
+  b.pos_ = {48.2, 9.2};
+  b.walks_.emplace("s2", dock_walk{180.0, 190.0});
+  return walks;
+}
+
+}  // namespace
+
+TEST(gbfs, dock_walk_matrix_precomputed) {
+  auto const walks = make_walks();
+  auto const docks = std::vector<std::string>{"a", "b", "unknown"};
+  auto const stations = std::vector<std::string>{"s1", "s2"};
+
+  // docks x direct: a->d0, a->d1, b->d0, b->d1, unknown->d0, unknown->d1
+  auto const fwd_live = live_table{{1.0, 2.0, 3.0, 4.0, 5.0, 6.0}};
+  EXPECT_EQ((std::vector<double>{60.0, 120.0, 1.0, 2.0,  //
+                                 kUnreachableWalk, 180.0, 3.0, 4.0,  //
+                                 kUnreachableWalk, kUnreachableWalk, 5.0,
+                                 6.0}),
+            dock_walk_matrix(walks, docks, stations, 2U, &fwd_live, true));
+
+  // direct x docks: d0->a, d0->b, d0->unknown, d1->a, d1->b, d1->unknown
+  auto const bwd_live = live_table{{1.0, 2.0, 3.0, 4.0, 5.0, 6.0}};
+  EXPECT_EQ((std::vector<double>{70.0, 130.0, 1.0, 4.0,  //
+                                 kUnreachableWalk, 190.0, 2.0, 5.0,  //
+                                 kUnreachableWalk, kUnreachableWalk, 3.0,
+                                 6.0}),
+            dock_walk_matrix(walks, docks, stations, 2U, &bwd_live, false));
+}
+
+TEST(gbfs, dock_walk_matrix_no_live_table) {
+  auto const walks = make_walks();
+  auto const docks = std::vector<std::string>{"b", "a"};
+  auto const stations = std::vector<std::string>{"s2", "s1"};
+  EXPECT_EQ((std::vector<double>{180.0, kUnreachableWalk, 120.0, 60.0}),
+            dock_walk_matrix(walks, docks, stations, 0U,
+                             static_cast<live_table const*>(nullptr), true));
+}
+
+TEST(gbfs, dock_walk_matrix_live_only) {
+  auto const docks = std::vector<std::string>{"a", "b"};
+  auto const live = live_table{{1.0, 2.0, 3.0, 4.0, 5.0, 6.0}};
+
+  // Without precomputed walks all targets come from the live table.
+  EXPECT_EQ((std::vector<double>{1.0, 2.0, 3.0, 4.0, 5.0, 6.0}),
+            dock_walk_matrix(dock_walks{}, docks, {}, 3U, &live, true));
+  EXPECT_EQ((std::vector<double>{1.0, 3.0, 5.0, 2.0, 4.0, 6.0}),
+            dock_walk_matrix(dock_walks{}, docks, {}, 3U, &live, false));
+}
@@ -0,0 +1,194 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+
+#include "motis/core/common/raii.h"
+#include "motis/gbfs/feed_file.h"
+
+namespace fs = std::filesystem;
+using namespace motis;
+using namespace motis::gbfs;
+
+namespace {
+
+std::string make_feed(unixtime const last_updated, unixtime const ttl,
+                      std::string const& data) {
+  return R"({"last_updated":)" + std::to_string(last_updated) +
+         R"(,"ttl":)" + std::to_string(ttl) + R"(,"data":)" + data + "}";
+}
+
+// Stand-in for a GBFS server: serves the files of a local directory.
+// With validators, ETag is derived from the content and Last-Modified
+// from the file's modification time.
+struct local_feed_dir {
+  local_feed_dir()
+      : dir_{fs::temp_directory_path() /
+             ("motis_gbfs_feed_file_test_" + std::to_string(getpid()))} {
+    fs::create_directories(dir_);
+  }
+
+  void write(std::string const& name, std::string const& content) const {
+    std::ofstream{dir_ / name, std::ios::binary} << content;
+  }
+
+  net::http::client::response serve(
+      std::string const& name, net::http::client::request const& req) {
+    auto res = net::http::client::response{};
+    auto const path = dir_ / name;
+    if (!fs::is_regular_file(path)) {
+      res.status_code = 404U;
+      return res;
+    }
+
+    auto ss = std::stringstream{};
+    ss << std::ifstream{path, std::ios::binary}.rdbuf();
+    auto const body = ss.str();
+    auto const etag =
+        '"' + std::to_string(std::hash<std::string>{}(body)) + '"';
+    auto const last_modified = std::to_string(
+        fs::last_write_time(path).time_since_epoch().count());
+
+    if (validators_) {
+      auto const header = [&](char const* key) -> std::string const* {
+        auto const it = req.headers.find(key);
+        return it == end(req.headers) ? nullptr : &it->second;
+      };
+      auto const none_match = header("If-None-Match");
+      auto const modified_since = header("If-Modified-Since");
+      if (none_match != nullptr
+              ? *none_match == etag
+              : modified_since != nullptr && *modified_since == last_modified) {
+        res.status_code = 304U;
+        ++not_modified_;
+        return res;
+      }
+      res.headers.emplace("etag", etag);
+      res.headers.emplace("last-modified", last_modified);
+    }
+
+    res.status_code = 200U;
+    res.body = body;
+    return res;
+  }
+
+  bool fetch(feed_file& f, std::string const& name, unixtime const now,
+             unixtime const min_refresh = 0) {
+    auto const req = f.make_request((dir_ / name).generic_string());
+    return f.update(serve(name, req), now, min_refresh);
+  }
+
+  fs::path dir_;
+  bool validators_{true};
+  unsigned not_modified_{0U};
+};
+
+}  // namespace
+
+TEST(gbfs, feed_file_conditional) {
+  auto server = local_feed_dir{};
+  auto const remove_dir = make_finally([&]() { fs::remove_all(server.dir_); });
+
+  auto f = feed_file{};
+  EXPECT_TRUE(f.due(0));
+
+  auto const v1 = make_feed(1000, 60, R"({"stations":[]})");
+  server.write("station_status.json", v1);
+  EXPECT_TRUE(server.fetch(f, "station_status.json", 1010));
+  EXPECT_EQ(v1, f.body_);
+  EXPECT_EQ(60, f.ttl_);
+  EXPECT_EQ(1060, f.next_fetch_);  // last_updated + ttl
+  EXPECT_FALSE(f.due(1059));
+  EXPECT_TRUE(f.due(1060));
+
+  // Unchanged: 304 Not Modified, ttl counted from the fetch.
+  EXPECT_FALSE(server.fetch(f, "station_status.json", 1060));
+  EXPECT_EQ(1U, server.not_modified_);
+  EXPECT_EQ(v1, f.body_);
+  EXPECT_EQ(1120, f.next_fetch_);
+
+  // Changed.
+  auto const v2 = make_feed(1100, 60, R"({"stations":[{"station_id":"a"}]})");
+  server.write("station_status.json", v2);
+  EXPECT_TRUE(server.fetch(f, "station_status.json", 1120));
+  EXPECT_EQ(1U, server.not_modified_);
+  EXPECT_EQ(v2, f.body_);
+  EXPECT_EQ(1160, f.next_fetch_);
+
+  // Feed is stale (last_updated + ttl already passed): due again.
+  auto const v3 = make_feed(1000, 60, R"({"stations":[]})");
+  server.write("station_status.json", v3);
+  EXPECT_TRUE(server.fetch(f, "station_status.json", 1200));
+  EXPECT_TRUE(f.due(1200));
+}
+
+TEST(gbfs, feed_file_without_validators) {
+  auto server = local_feed_dir{};
+  auto const remove_dir = make_finally([&]() { fs::remove_all(server.dir_); });
+  server.validators_ = false;
+
+  auto f = feed_file{};
+  auto const v1 = make_feed(1000, 0, R"({"bikes":[]})");
+  server.write("free_bike_status.json", v1);
+  EXPECT_TRUE(server.fetch(f, "free_bike_status.json", 1000));
+  EXPECT_TRUE(f.etag_.empty());
+  EXPECT_TRUE(f.due(1000));  // ttl 0
+
+  // Identical body counts as unchanged.
+  EXPECT_FALSE(server.fetch(f, "free_bike_status.json", 1300));
+  EXPECT_EQ(0U, server.not_modified_);
+
+  server.write("free_bike_status.json", make_feed(1300, 0, R"({"bikes":[1]})"));
+  EXPECT_TRUE(server.fetch(f, "free_bike_status.json", 1600));
+}
+
+TEST(gbfs, feed_file_static_refresh) {
+  auto server = local_feed_dir{};
+  auto const remove_dir = make_finally([&]() { fs::remove_all(server.dir_); });
+
+  auto f = feed_file{};
+  server.write("station_information.json",
+               make_feed(1000, 0, R"({"stations":[]})"));
+  EXPECT_TRUE(server.fetch(f, "station_information.json", 1000, 3600));
+  EXPECT_EQ(4600, f.next_fetch_);
+  EXPECT_FALSE(f.due(4599));
+
+  EXPECT_FALSE(server.fetch(f, "station_information.json", 4600, 3600));
+  EXPECT_EQ(8200, f.next_fetch_);
+}
+
+TEST(gbfs, feed_file_url_change) {
+  auto server = local_feed_dir{};
+  auto const remove_dir = make_finally([&]() { fs::remove_all(server.dir_); });
+
+  auto f = feed_file{};
+  auto const feed = make_feed(1000, 60, R"({"stations":[]})");
+  server.write("a.json", feed);
+  server.write("b.json", feed);
+  EXPECT_TRUE(server.fetch(f, "a.json", 1000));
+
+  // New URL: fetched unconditionally, even with identical content.
+  auto const req = f.make_request((server.dir_ / "b.json").generic_string());
+  EXPECT_FALSE(f.valid_);
+  EXPECT_TRUE(req.headers.empty());
+  EXPECT_TRUE(f.update(server.serve("b.json", req), 1000));
+  EXPECT_EQ(0U, server.not_modified_);
+}
+
+TEST(gbfs, feed_file_errors) {
+  auto server = local_feed_dir{};
+  auto const remove_dir = make_finally([&]() { fs::remove_all(server.dir_); });
+
+  auto f = feed_file{};
+  EXPECT_ANY_THROW(server.fetch(f, "missing.json", 1000));
+  EXPECT_FALSE(f.valid_);
+
+  auto not_modified = net::http::client::response{};
+  not_modified.status_code = 304U;
+  EXPECT_ANY_THROW(f.update(not_modified, 1000));
+}
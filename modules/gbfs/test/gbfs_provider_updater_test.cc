@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "motis/core/schedule/station_lookup.h"
+#include "motis/test/motis_instance_test.h"
+
+#include "motis/gbfs/gbfs.h"
+#include "motis/gbfs/provider_updater.h"
+
+#include "./local_feeds.h"
+
+namespace fs = std::filesystem;
+using namespace motis;
+using namespace motis::gbfs;
+
+namespace {
+
+constexpr auto const kConfigUrl = "t|http://gbfs.test/gbfs.json";
+
+fs::path test_dir() {
+  return fs::temp_directory_path() /
+         ("motis_gbfs_provider_updater_test_" + std::to_string(getpid()));
+}
+
+local_feeds make_feeds() {
+  return {.docks_ = {{"s0", {49.8728, 8.6512}, 2U},
+                     {"s1", {49.8750, 8.6550}, 0U}},
+          .bikes_ = {{"b0", {49.8740, 8.6520}}, {"b1", {49.8710, 8.6560}}},
+          .last_updated_ = 1};
+}
+
+std::int64_t now() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+struct gbfs_provider_updater_test : public motis::test::motis_instance_test {
+  gbfs_provider_updater_test() {
+    fs::create_directories(test_dir() / "feeds");
+    config_.static_refresh_interval_minutes_ = 0U;
+    config_.dock_walk_duration_ = 0U;
+    config_.db_size_ = 64U * 1024U * 1024U;
+    updater_ = std::make_unique<provider_updater>(
+        test_dir() / "data", config_, std::make_shared<shared_station_lookup>(),
+        [&, serve = serve_from(test_dir() / "feeds")](
+            net::http::client::request req) {
+          ++fetches_;
+          return serve(std::move(req));
+        });
+  }
+
+  ~gbfs_provider_updater_test() override { fs::remove_all(test_dir()); }
+
+  // Returns the number of files fetched.
+  std::size_t update(local_feeds const& f) {
+    write_feeds(test_dir() / "feeds", f);
+    return update();
+  }
+
+  std::size_t update() {
+    fetches_ = 0U;
+    run([&]() { updater_->update(kConfigUrl); });
+    return fetches_;
+  }
+
+  motis::gbfs::config config_;
+  std::unique_ptr<provider_updater> updater_;
+  std::atomic_size_t fetches_{0U};
+};
+
+TEST_F(gbfs_provider_updater_test, unchanged_files_are_not_parsed) {
+  EXPECT_EQ(5U, update(make_feeds()));
+  auto const first = updater_->get("t");
+  ASSERT_NE(nullptr, first);
+  EXPECT_EQ(2U, first->stations_->entries_.size());
+  EXPECT_EQ(2U, first->free_bikes_->entries_.size());
+  EXPECT_EQ("Test", first->info_.name_);
+
+  // Same bodies (ttl 0: fetched again): the snapshot stays published.
+  EXPECT_EQ(5U, update(make_feeds()));
+  EXPECT_EQ(first, updater_->get("t"));
+}
+
+TEST_F(gbfs_provider_updater_test, unchanged_parts_are_shared) {
+  update(make_feeds());
+  auto const first = updater_->get("t");
+
+  // Only free_bike_status changes.
+  auto moved = make_feeds();
+  moved.bikes_[1].pos_ = {49.8715, 8.6565};
+  update(moved);
+  auto const second = updater_->get("t");
+  ASSERT_NE(first, second);
+  EXPECT_EQ(first->stations_, second->stations_);
+  EXPECT_EQ(first->dock_walks_, second->dock_walks_);
+  EXPECT_NE(first->free_bikes_, second->free_bikes_);
+  EXPECT_NE(first->tiles_, second->tiles_);
+  EXPECT_TRUE(second->tiles_current_);
+
+  // All files changed (last_updated), the content did not: everything is
+  // parsed again, but all parts and the tiles database are kept.
+  moved.last_updated_ = 2;
+  update(moved);
+  auto const third = updater_->get("t");
+  ASSERT_NE(second, third);
+  EXPECT_EQ(second->stations_, third->stations_);
+  EXPECT_EQ(second->free_bikes_, third->free_bikes_);
+  EXPECT_EQ(second->dock_walks_, third->dock_walks_);
+  EXPECT_EQ(second->tiles_, third->tiles_);
+
+  // A station status change replaces only the stations part.
+  moved.docks_[0].bikes_ = 5U;
+  update(moved);
+  auto const fourth = updater_->get("t");
+  EXPECT_NE(third->stations_, fourth->stations_);
+  EXPECT_EQ(third->free_bikes_, fourth->free_bikes_);
+  auto const& stations = fourth->stations_->entries_;
+  auto const s0 = std::find_if(begin(stations), end(stations),
+                               [](station const& s) { return s.id_ == "ts0"; });
+  ASSERT_NE(end(stations), s0);
+  EXPECT_EQ(5U, s0->bikes_available_);
+}
+
+TEST_F(gbfs_provider_updater_test, failed_update_fetches_everything_again) {
+  // Files are not due again for an hour after a successful update.
+  auto feeds = make_feeds();
+  feeds.last_updated_ = now();
+  feeds.ttl_ = 3600;
+
+  // Station without position: parsing fails after the file was stored.
+  write_feeds(test_dir() / "feeds", feeds);
+  write_file(test_dir() / "feeds" / "station_information.json",
+             R"({"last_updated": )" + std::to_string(feeds.last_updated_) +
+                 R"(, "ttl": 3600, "data": {"stations": [{"station_id": "s0",)"
+                 R"( "name": "Dock s0"}]}})");
+  EXPECT_ANY_THROW(run([&]() { updater_->update(kConfigUrl); }));
+  EXPECT_EQ(nullptr, updater_->get("t"));
+
+  // Without the reset, station_information would not be due and the broken
+  // version would be parsed again.
+  EXPECT_EQ(5U, update(feeds));
+  auto const recovered = updater_->get("t");
+  ASSERT_NE(nullptr, recovered);
+  EXPECT_EQ(2U, recovered->stations_->entries_.size());
+
+  // Nothing due: no request, no new snapshot.
+  EXPECT_EQ(0U, update());
+  EXPECT_EQ(recovered, updater_->get("t"));
+}
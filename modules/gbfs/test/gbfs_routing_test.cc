@@ -0,0 +1,408 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "geo/latlng.h"
+
+#include "utl/to_vec.h"
+#include "utl/verify.h"
+
+#include "motis/core/conv/position_conv.h"
+#include "motis/core/schedule/station_lookup.h"
+#include "motis/module/context/motis_call.h"
+#include "motis/module/message.h"
+#include "motis/test/motis_instance_test.h"
+
+#include "motis/gbfs/provider_updater.h"
+#include "motis/gbfs/routing.h"
+
+#include "./local_feeds.h"
+
+namespace fs = std::filesystem;
+namespace mm = motis::module;
+using namespace motis;
+using namespace motis::gbfs;
+using motis::osrm::OSRMManyToManyRequest;
+using motis::osrm::OSRMOneToManyRequest;
+
+namespace {
+
+constexpr auto const kDockWalkDuration = 15U;  // minutes
+constexpr auto const kMaxBikeDuration = 15U;  // minutes
+geo::latlng const kCenter{49.8728, 8.6512};
+
+double speed(std::string_view const profile) {  // m/s
+  return profile == "foot" ? 1.2 : profile == "bike" ? 4.0 : 10.0;
+}
+
+// Straight line at constant speed. Symmetric: a walk precomputed from the
+// dock has to match the one routed towards the dock to the last bit.
+double travel_time(geo::latlng a, geo::latlng b,
+                   std::string_view const profile) {
+  if (std::tie(b.lat_, b.lng_) < std::tie(a.lat_, a.lng_)) {
+    std::swap(a, b);
+  }
+  return geo::distance(a, b) / speed(profile);
+}
+
+geo::latlng offset(double const lat, double const lng) {
+  return {kCenter.lat_ + lat, kCenter.lng_ + lng};
+}
+
+// PT stations "p0" ... "p8" on a 3x3 grid around the center.
+struct test_station_lookup : public station_lookup {
+  explicit test_station_lookup(std::vector<geo::latlng> const& pos)
+      : station_lookup{pos}, pos_{pos} {
+    for (auto i = 0U; i != pos_.size(); ++i) {
+      ids_.emplace_back("p" + std::to_string(i));
+    }
+  }
+
+  lookup_station get(std::size_t const idx) const override {
+    return {"", ids_.at(idx), ids_.at(idx), pos_.at(idx)};
+  }
+
+  lookup_station get(std::string_view const id) const override {
+    auto const it = std::find(begin(ids_), end(ids_), id);
+    return it == end(ids_)
+               ? lookup_station::invalid()
+               : get(static_cast<std::size_t>(std::distance(begin(ids_), it)));
+  }
+
+  std::vector<geo::latlng> pos_;
+  std::vector<std::string> ids_;
+};
+
+std::vector<geo::latlng> pt_positions() {
+  auto pos = std::vector<geo::latlng>{};
+  for (auto i = 0U; i != 9U; ++i) {
+    auto const row = static_cast<int>(i / 3U) - 1;
+    auto const col = static_cast<int>(i % 3U) - 1;
+    pos.emplace_back(offset(0.006 * row, 0.008 * col));
+  }
+  return pos;
+}
+
+// Docks at the center and next to the corner PT stations. "d4" is empty.
+std::vector<station> make_stations() {
+  auto const pt = pt_positions();
+  auto stations = std::vector<station>{};
+  auto const add = [&](geo::latlng const& pos, unsigned const bikes) {
+    auto const id = "d" + std::to_string(stations.size());
+    stations.push_back(station{
+        .id_ = id, .name_ = id, .pos_ = pos, .bikes_available_ = bikes});
+  };
+  add(offset(0.0003, 0.0), 2U);
+  add({pt[0].lat_ + 0.0004, pt[0].lng_}, 1U);
+  add({pt[2].lat_ + 0.0004, pt[2].lng_}, 3U);
+  add({pt[6].lat_ - 0.0004, pt[6].lng_}, 2U);
+  add({pt[8].lat_ - 0.0004, pt[8].lng_}, 0U);
+  return stations;
+}
+
+std::vector<free_bike> make_free_bikes() {
+  auto const bike = [](std::string id, geo::latlng const& pos) {
+    return free_bike{.id_ = std::move(id), .pos_ = pos, .type_ = "bike"};
+  };
+  return {bike("b0", offset(0.0, 0.006)), bike("b1", offset(0.004, -0.004)),
+          bike("b2", offset(-0.02, 0.0))};
+}
+
+std::vector<geo::latlng> direct_positions() {
+  return {offset(0.003, 0.003), offset(-0.003, -0.005)};
+}
+
+provider_status make_status() {
+  auto s = provider_status{};
+  s.vehicle_type_ = "bike";
+  s.stations_ = std::make_shared<stations_part const>(make_stations());
+  s.free_bikes_ = std::make_shared<free_bikes_part const>(make_free_bikes());
+  return s;
+}
+
+mm::msg_ptr make_request(SearchDir const dir, unsigned const max_foot) {
+  auto const x = to_fbs(kCenter);
+  mm::message_creator mc;
+  mc.create_and_finish(
+      MsgContent_GBFSRoutingRequest,
+      CreateGBFSRoutingRequest(
+          mc, dir, &x,
+          mc.CreateVectorOfStructs(utl::to_vec(
+              direct_positions(), [](auto&& p) { return to_fbs(p); })),
+          mc.CreateString("test"), max_foot, kMaxBikeDuration)
+          .Union(),
+      "/gbfs/route");
+  return make_msg(mc);
+}
+
+std::vector<std::string> summarize(mm::msg_ptr const& msg) {
+  auto const res = motis_content(GBFSRoutingResponse, msg);
+  return utl::to_vec(*res->routes(), [](RouteInfo const* r) {
+    auto s = r->p_type() == P_Station
+                 ? r->p_as_Station()->id()->str()
+                 : "direct(" + std::to_string(r->p_as_Direct()->pos()->lat()) +
+                       "," + std::to_string(r->p_as_Direct()->pos()->lng()) +
+                       ")";
+    if (r->route_type() == BikeRoute_FreeBikeRoute) {
+      auto const b = r->route_as_FreeBikeRoute();
+      s += " free " + b->bike_id()->str() +
+           " walk=" + std::to_string(b->walk_duration()) +
+           " bike=" + std::to_string(b->bike_duration());
+    } else {
+      auto const b = r->route_as_StationBikeRoute();
+      s += " station " + b->from()->id()->str() + "->" +
+           b->to()->id()->str() +
+           " walk=" + std::to_string(b->first_walk_duration()) +
+           " bike=" + std::to_string(b->bike_duration()) +
+           " walk=" + std::to_string(b->second_walk_duration());
+    }
+    return s + " total=" + std::to_string(r->total_duration());
+  });
+}
+
+// Feed directory versions of make_stations() and make_free_bikes().
+local_feeds feeds_v1(int const last_updated) {
+  auto f = local_feeds{.last_updated_ = last_updated};
+  for (auto const& s : make_stations()) {
+    f.docks_.push_back({s.id_, s.pos_, s.bikes_available_});
+  }
+  for (auto const& b : make_free_bikes()) {
+    f.bikes_.push_back({b.id_, b.pos_});
+  }
+  return f;
+}
+
+// d1 removed, d0 empty, b1 moved.
+local_feeds feeds_v2(int const last_updated) {
+  auto f = feeds_v1(last_updated);
+  f.docks_.erase(begin(f.docks_) + 1);
+  f.docks_[0].bikes_ = 0U;
+  f.bikes_[1].pos_ = offset(-0.004, 0.004);
+  return f;
+}
+
+fs::path feed_dir() {
+  return fs::temp_directory_path() /
+         ("motis_gbfs_routing_test_" + std::to_string(getpid()));
+}
+
+std::size_t count(std::vector<std::string> const& routes,
+                  std::string_view const type) {
+  return static_cast<std::size_t>(
+      std::count_if(begin(routes), end(routes), [&](std::string const& r) {
+        return r.find(type) != std::string::npos;
+      }));
+}
+
+}  // namespace
+
+struct gbfs_routing_test : public motis::test::motis_instance_test {
+  struct result {
+    std::vector<std::string> routes_;
+    std::size_t foot_table_cells_;
+  };
+
+  // Stand-ins for /osrm/one_to_many and /osrm/table. Counts the walks
+  // requested from the many-to-many router.
+  gbfs_routing_test()
+      : st_{std::make_shared<test_station_lookup>(pt_positions())} {
+    instance_->register_op(
+        "/osrm/one_to_many",
+        [](mm::msg_ptr const& msg) {
+          auto const req = motis_content(OSRMOneToManyRequest, msg);
+          auto const one = from_fbs(req->one());
+          auto const costs = utl::to_vec(*req->many(), [&](auto&& p) {
+            auto const to = from_fbs(p);
+            return osrm::Cost{travel_time(one, to, req->profile()->view()),
+                              geo::distance(one, to)};
+          });
+          mm::message_creator mc;
+          mc.create_and_finish(
+              MsgContent_OSRMOneToManyResponse,
+              osrm::CreateOSRMOneToManyResponse(
+                  mc, mc.CreateVectorOfStructs(costs))
+                  .Union());
+          return make_msg(mc);
+        },
+        {});
+    instance_->register_op(
+        "/osrm/table",
+        [&](mm::msg_ptr const& msg) {
+          auto const req = motis_content(OSRMManyToManyRequest, msg);
+          auto costs = std::vector<double>{};
+          for (auto const* from : *req->from()) {
+            for (auto const* to : *req->to()) {
+              costs.emplace_back(travel_time(from_fbs(from), from_fbs(to),
+                                             req->profile()->view()));
+            }
+          }
+          if (req->profile()->view() == "foot") {
+            foot_table_cells_ += costs.size();
+          }
+          mm::message_creator mc;
+          mc.create_and_finish(
+              MsgContent_OSRMManyToManyResponse,
+              osrm::CreateOSRMManyToManyResponse(mc, mc.CreateVector(costs))
+                  .Union());
+          return make_msg(mc);
+        },
+        {});
+
+    live_ = make_status();
+    precomputed_ = make_status();
+    run([&]() {
+      precomputed_.dock_walks_ =
+          std::make_shared<dock_walks const>(compute_dock_walks(
+              "test", st_, precomputed_.stations_->entries_, nullptr,
+              kDockWalkDuration));
+    });
+  }
+
+  result route(provider_status const& info,
+               std::shared_ptr<station_lookup const> const& st,
+               SearchDir const dir, unsigned const max_foot) {
+    auto const req = make_request(dir, max_foot);
+    foot_table_cells_ = 0U;
+    auto res = mm::msg_ptr{};
+    run([&]() { res = motis::gbfs::route(info, st, req); });
+    return {summarize(res), foot_table_cells_.load()};
+  }
+
+  std::shared_ptr<station_lookup const> st_;
+  provider_status live_, precomputed_;
+  std::atomic_size_t foot_table_cells_{0U};
+};
+
+TEST_F(gbfs_routing_test, precomputed_dock_walks_match_live) {
+  ASSERT_EQ(make_stations().size(), precomputed_.dock_walks_->docks_.size());
+
+  for (auto const dir : {SearchDir_Forward, SearchDir_Backward}) {
+    auto const live = route(live_, st_, dir, kDockWalkDuration);
+    auto const precomputed = route(precomputed_, st_, dir, kDockWalkDuration);
+    ASSERT_FALSE(live.routes_.empty());
+    EXPECT_EQ(live.routes_, precomputed.routes_);
+
+    // Only walks to and from the direct positions are routed.
+    EXPECT_LT(precomputed.foot_table_cells_, live.foot_table_cells_);
+
+    if (dir == SearchDir_Forward) {
+      EXPECT_NE(0U, count(live.routes_, " free "));
+      EXPECT_NE(0U, count(live.routes_, " station "));
+      EXPECT_NE(0U, count(live.routes_, "direct("));
+    }
+  }
+}
+
+TEST_F(gbfs_routing_test, precomputed_dock_walks_fallback) {
+  for (auto const dir : {SearchDir_Forward, SearchDir_Backward}) {
+    // Walks longer than the precomputed ones: all walks are routed.
+    auto const live = route(live_, st_, dir, kDockWalkDuration + 5U);
+    auto const longer = route(precomputed_, st_, dir, kDockWalkDuration + 5U);
+    ASSERT_FALSE(live.routes_.empty());
+    EXPECT_EQ(live.routes_, longer.routes_);
+    EXPECT_EQ(live.foot_table_cells_, longer.foot_table_cells_);
+
+    // Station lookup swapped (timetable reload) since the precomputation.
+    auto const reloaded =
+        std::make_shared<test_station_lookup const>(pt_positions());
+    auto const ref = route(live_, reloaded, dir, kDockWalkDuration);
+    auto const outdated = route(precomputed_, reloaded, dir, kDockWalkDuration);
+    EXPECT_EQ(ref.routes_, outdated.routes_);
+    EXPECT_EQ(ref.foot_table_cells_, outdated.foot_table_cells_);
+  }
+}
+
+// /gbfs/route as registered by the module, reading the snapshot published
+// by a provider updater that reads its feeds from a local directory.
+struct gbfs_route_during_update_test : public gbfs_routing_test {
+  static constexpr auto const kConfigUrl = "test|http://gbfs.test/gbfs.json";
+
+  gbfs_route_during_update_test() {
+    fs::create_directories(feed_dir() / "feeds");
+    config_.static_refresh_interval_minutes_ = 0U;
+    config_.dock_walk_duration_ = kDockWalkDuration;
+    config_.db_size_ = 64U * 1024U * 1024U;
+    shared_st_->store(st_);
+    updater_ = std::make_unique<provider_updater>(
+        feed_dir() / "data", config_, shared_st_,
+        serve_from(feed_dir() / "feeds"));
+    instance_->register_op(
+        "/gbfs/route",
+        [&](mm::msg_ptr const& m) {
+          auto const req = motis_content(GBFSRoutingRequest, m);
+          auto const info = updater_->get(req->provider()->view());
+          utl::verify(info != nullptr, "provider not found");
+          return motis::gbfs::route(*info, shared_st_->load(), m);
+        },
+        {});
+  }
+
+  ~gbfs_route_during_update_test() override { fs::remove_all(feed_dir()); }
+
+  void update(local_feeds const& f) {
+    write_feeds(feed_dir() / "feeds", f);
+    run([&]() { updater_->update(kConfigUrl); });
+  }
+
+  motis::gbfs::config config_;
+  std::shared_ptr<shared_station_lookup> shared_st_{
+      std::make_shared<shared_station_lookup>()};
+  std::unique_ptr<provider_updater> updater_;
+};
+
+TEST_F(gbfs_route_during_update_test, requests_see_complete_snapshots) {
+  constexpr auto const kUpdates = 20;
+  constexpr auto const kRequestsPerUpdate = 8U;
+
+  update(feeds_v2(1));
+  auto const expected_v2 =
+      summarize(call(make_request(SearchDir_Forward, kDockWalkDuration)));
+  update(feeds_v1(2));
+  auto const expected_v1 =
+      summarize(call(make_request(SearchDir_Forward, kDockWalkDuration)));
+  ASSERT_FALSE(expected_v1.empty());
+  ASSERT_NE(expected_v1, expected_v2);
+
+  // Requests run while the updater swaps between both versions.
+  auto results = std::vector<std::vector<std::string>>{};
+  run([&]() {
+    auto futures = std::vector<mm::future>{};
+    for (auto i = 0; i != kUpdates; ++i) {
+      for (auto j = 0U; j != kRequestsPerUpdate; ++j) {
+        futures.emplace_back(
+            motis_call(make_request(SearchDir_Forward, kDockWalkDuration)));
+      }
+      auto const last_updated = 3 + i;
+      write_feeds(feed_dir() / "feeds", i % 2 == 0 ? feeds_v2(last_updated)
+                                                   : feeds_v1(last_updated));
+      updater_->update(kConfigUrl);
+    }
+    for (auto const& f : futures) {
+      results.emplace_back(summarize(f->val()));
+    }
+  });
+
+  ASSERT_EQ(kUpdates * kRequestsPerUpdate, results.size());
+  for (auto const& r : results) {
+    EXPECT_TRUE(r == expected_v1 || r == expected_v2);
+  }
+
+  // Last update published v1 (with precomputed dock walks).
+  auto const last = updater_->get("test");
+  ASSERT_NE(nullptr, last);
+  EXPECT_EQ(make_stations().size(), last->dock_walks_->docks_.size());
+  EXPECT_EQ(expected_v1, summarize(call(make_request(SearchDir_Forward,
+                                                    kDockWalkDuration))));
+}
@@ -0,0 +1,60 @@
+#include "gtest/gtest.h"
+
+#include "motis/gbfs/free_bike.h"
+#include "motis/gbfs/snapshot_diff.h"
+#include "motis/gbfs/station.h"
+
+using namespace motis::gbfs;
+
+TEST(gbfs, snapshot_diff_free_bikes) {
+  auto const prev = std::vector<free_bike>{
+      {.id_ = "a", .pos_ = {48.1, 9.1}, .type_ = "bike"},
+      {.id_ = "b", .pos_ = {48.2, 9.2}, .type_ = "bike"},
+      {.id_ = "c", .pos_ = {48.3, 9.3}, .type_ = "bike"}};
+
+  auto const reversed = std::vector<free_bike>{prev.rbegin(), prev.rend()};
+  EXPECT_TRUE(diff(prev, reversed).empty());
+
+  auto next = prev;
+  next.erase(begin(next));  // a removed
+  next.at(0).pos_ = {48.25, 9.25};  // b moved
+  next.push_back({.id_ = "d", .pos_ = {48.4, 9.4}, .type_ = "bike"});
+
+  auto const d = diff(prev, next);
+  EXPECT_FALSE(d.empty());
+  EXPECT_EQ(1U, d.added_);
+  EXPECT_EQ(1U, d.removed_);
+  EXPECT_EQ(1U, d.changed_);
+}
+
+TEST(gbfs, snapshot_diff_stations) {
+  auto const prev = std::vector<station>{
+      {.id_ = "s1", .name_ = "A", .pos_ = {48.1, 9.1}, .bikes_available_ = 3},
+      {.id_ = "s2", .name_ = "B", .pos_ = {48.2, 9.2}, .bikes_available_ = 0}};
+
+  EXPECT_TRUE(diff(prev, prev).empty());
+  EXPECT_EQ(2U, diff(std::vector<station>{}, prev).added_);
+  EXPECT_EQ(2U, diff(prev, std::vector<station>{}).removed_);
+
+  auto next = prev;
+  next.at(1).bikes_available_ = 1;
+  auto const d = diff(prev, next);
+  EXPECT_EQ(0U, d.added_);
+  EXPECT_EQ(0U, d.removed_);
+  EXPECT_EQ(1U, d.changed_);
+}
+
+TEST(gbfs, snapshot_diff_duplicate_ids) {
+  auto const prev = std::vector<free_bike>{
+      {.id_ = "a", .pos_ = {48.1, 9.1}, .type_ = "bike"},
+      {.id_ = "b", .pos_ = {48.2, 9.2}, .type_ = "bike"}};
+  auto const next = std::vector<free_bike>{
+      {.id_ = "a", .pos_ = {48.1, 9.1}, .type_ = "bike"},
+      {.id_ = "a", .pos_ = {48.1, 9.1}, .type_ = "bike"},
+      {.id_ = "a", .pos_ = {48.1, 9.1}, .type_ = "bike"}};
+
+  auto const d = diff(prev, next);
+  EXPECT_EQ(0U, d.added_);
+  EXPECT_EQ(1U, d.removed_);
+  EXPECT_EQ(0U, d.changed_);
+}
@@ -0,0 +1,87 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "motis/gbfs/snapshot_map.h"
+
+using namespace motis::gbfs;
+
+namespace {
+
+struct provider {
+  explicit provider(int const version)
+      : version_{version}, data_(1000U, version) {}
+  int version_;
+  std::vector<int> data_;
+};
+
+}  // namespace
+
+TEST(gbfs, snapshot_map_basic) {
+  auto m = snapshot_map<provider>{};
+  EXPECT_EQ(nullptr, m.get("a"));
+
+  m.set("a", std::make_shared<provider>(1));
+  m.set("b", std::make_shared<provider>(2));
+  auto const a1 = m.get("a");
+  ASSERT_NE(nullptr, a1);
+  EXPECT_EQ(1, a1->version_);
+  EXPECT_EQ(2U, m.load()->size());
+
+  m.set("a", std::make_shared<provider>(3));
+  EXPECT_EQ(3, m.get("a")->version_);
+  EXPECT_EQ(2, m.get("b")->version_);
+  EXPECT_EQ(1, a1->version_);  // old snapshot stays valid
+}
+
+TEST(gbfs, snapshot_map_concurrent_updates) {
+  constexpr auto const kVersions = 2000;
+
+  auto m = snapshot_map<provider>{};
+  m.set("a", std::make_shared<provider>(0));
+
+  auto done = std::atomic_bool{false};
+  auto inconsistent = std::atomic_int{0};
+  auto readers = std::vector<std::thread>{};
+  for (auto i = 0; i != 4; ++i) {
+    readers.emplace_back([&]() {
+      auto last = 0;
+      while (!done) {
+        auto const p = m.get("a");
+        auto const& d = p->data_;
+        if (p->version_ < last ||
+            std::any_of(begin(d), end(d),
+                        [&](int const x) { return x != p->version_; })) {
+          ++inconsistent;
+        }
+        last = p->version_;
+      }
+    });
+  }
+
+  auto writers = std::vector<std::thread>{};
+  writers.emplace_back([&]() {
+    for (auto v = 1; v <= kVersions; ++v) {
+      m.set("a", std::make_shared<provider>(v));
+    }
+  });
+  writers.emplace_back([&]() {  // other providers are updated concurrently
+    for (auto v = 1; v <= kVersions; ++v) {
+      m.set("b", std::make_shared<provider>(v));
+    }
+  });
+  for (auto& w : writers) {
+    w.join();
+  }
+  done = true;
+  for (auto& r : readers) {
+    r.join();
+  }
+
+  EXPECT_EQ(0, inconsistent);
+  EXPECT_EQ(kVersions, m.get("a")->version_);
+  EXPECT_EQ(kVersions, m.get("b")->version_);
+}
@@ -0,0 +1,208 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "geo/latlng.h"
+#include "geo/tile.h"
+
+#include "motis/core/schedule/station_lookup.h"
+#include "motis/test/motis_instance_test.h"
+
+#include "motis/gbfs/gbfs.h"
+#include "motis/gbfs/provider_updater.h"
+#include "motis/gbfs/tiles_database.h"
+
+#include "./local_feeds.h"
+
+namespace fs = std::filesystem;
+using namespace motis;
+using namespace motis::gbfs;
+
+namespace {
+
+constexpr auto const kConfigUrl = "t|http://gbfs.test/gbfs.json";
+
+fs::path test_dir() {
+  return fs::temp_directory_path() /
+         ("motis_gbfs_tiles_test_" + std::to_string(getpid()));
+}
+
+local_feeds snapshot_a() {
+  return {.docks_ = {{"s0", {49.8728, 8.6512}, 2U},
+                     {"s1", {49.8750, 8.6550}, 0U},
+                     {"s2", {49.8700, 8.6480}, 5U}},
+          .bikes_ = {{"b0", {49.8740, 8.6520}}, {"b1", {49.8710, 8.6560}}},
+          .last_updated_ = 1};
+}
+
+// Station changed, added and removed. Bike moved and added.
+local_feeds snapshot_b() {
+  return {.docks_ = {{"s0", {49.8728, 8.6512}, 1U},
+                     {"s2", {49.8700, 8.6480}, 5U},
+                     {"s3", {49.8690, 8.6600}, 3U}},
+          .bikes_ = {{"b0", {49.8745, 8.6530}},
+                     {"b1", {49.8710, 8.6560}},
+                     {"b2", {49.8760, 8.6470}}},
+          .last_updated_ = 2};
+}
+
+// Same content as B, new last_updated: the tiles database is reused.
+local_feeds snapshot_c() {
+  auto c = snapshot_b();
+  c.last_updated_ = 3;
+  return c;
+}
+
+geo::tile tile_at(geo::latlng const& pos, std::uint32_t const z) {
+  auto const n = std::pow(2.0, z);
+  auto const lat = pos.lat_ * std::numbers::pi / 180.0;
+  auto const x = (pos.lng_ + 180.0) / 360.0 * n;
+  auto const y =
+      (1.0 - std::log(std::tan(lat) + 1.0 / std::cos(lat)) / std::numbers::pi) /
+      2.0 * n;
+  return geo::tile{static_cast<std::uint32_t>(x),
+                   static_cast<std::uint32_t>(y), z};
+}
+
+// Tiles with at least one position of A or B at zoom levels 10 to 18.
+std::vector<geo::tile> test_tiles() {
+  auto positions = std::vector<geo::latlng>{};
+  for (auto const& f : {snapshot_a(), snapshot_b()}) {
+    for (auto const& d : f.docks_) {
+      positions.emplace_back(d.pos_);
+    }
+    for (auto const& b : f.bikes_) {
+      positions.emplace_back(b.pos_);
+    }
+  }
+
+  auto tiles = std::set<std::tuple<std::uint32_t, std::uint32_t,
+                                   std::uint32_t>>{};
+  for (auto z = 10U; z <= 18U; z += 2U) {
+    for (auto const& pos : positions) {
+      auto const t = tile_at(pos, z);
+      tiles.emplace(t.x_, t.y_, t.z_);
+    }
+  }
+
+  auto result = std::vector<geo::tile>{};
+  for (auto const& [x, y, z] : tiles) {
+    result.emplace_back(geo::tile{x, y, z});
+  }
+  return result;
+}
+
+}  // namespace
+
+struct gbfs_tiles_test : public motis::test::motis_instance_test {
+  gbfs_tiles_test() {
+    fs::create_directories(test_dir() / "feeds");
+    config_.static_refresh_interval_minutes_ = 0U;
+    config_.dock_walk_duration_ = 0U;
+    config_.db_size_ = 64U * 1024U * 1024U;
+    config_.urls_ = {kConfigUrl};
+  }
+
+  ~gbfs_tiles_test() override { fs::remove_all(test_dir()); }
+
+  std::unique_ptr<provider_updater> make_updater(std::string const& name) {
+    return std::make_unique<provider_updater>(
+        test_dir() / name, config_, st_, serve_from(test_dir() / "feeds"));
+  }
+
+  void update(provider_updater& u, local_feeds const& f) {
+    write_feeds(test_dir() / "feeds", f);
+    run([&]() { u.update(kConfigUrl); });
+  }
+
+  // Full rebuild: a new updater with its own databases.
+  std::shared_ptr<provider_status const> rebuild(std::string const& name,
+                                                 local_feeds const& f) {
+    fresh_.emplace_back(make_updater(name));
+    update(*fresh_.back(), f);
+    return fresh_.back()->get("t");
+  }
+
+  static std::vector<std::optional<std::string>> render(
+      provider_status const& s) {
+    auto tiles = std::vector<std::optional<std::string>>{};
+    for (auto const& t : test_tiles()) {
+      tiles.emplace_back(get_tile(*s.tiles_, t));
+    }
+    return tiles;
+  }
+
+  motis::gbfs::config config_;
+  std::shared_ptr<shared_station_lookup> st_{
+      std::make_shared<shared_station_lookup>()};
+  std::vector<std::unique_ptr<provider_updater>> fresh_;
+};
+
+TEST_F(gbfs_tiles_test, incremental_update_matches_rebuild) {
+  auto const incremental = make_updater("incremental");
+
+  update(*incremental, snapshot_a());
+  auto const a = incremental->get("t");
+  ASSERT_NE(nullptr, a);
+  ASSERT_NE(nullptr, a->tiles_);
+  EXPECT_TRUE(a->tiles_current_);
+
+  update(*incremental, snapshot_b());
+  auto const b = incremental->get("t");
+  ASSERT_NE(a, b);
+  EXPECT_TRUE(b->tiles_current_);
+  EXPECT_NE(a->tiles_, b->tiles_);  // written to the spare slot
+  EXPECT_EQ(render(*rebuild("rebuild_b", snapshot_b())), render(*b));
+
+  auto const rendered_b = render(*b);
+  EXPECT_TRUE(std::any_of(
+      begin(rendered_b), end(rendered_b),
+      [](std::optional<std::string> const& t) { return t.has_value(); }));
+  EXPECT_NE(render(*a), rendered_b);
+
+  update(*incremental, snapshot_c());
+  auto const c = incremental->get("t");
+  ASSERT_NE(b, c);
+  EXPECT_TRUE(c->tiles_current_);
+  EXPECT_EQ(b->tiles_, c->tiles_);  // nothing to write
+  EXPECT_EQ(render(*rebuild("rebuild_c", snapshot_c())), render(*c));
+}
+
+TEST_F(gbfs_tiles_test, both_slots_in_use) {
+  auto const incremental = make_updater("incremental");
+
+  update(*incremental, snapshot_a());
+  auto a = incremental->get("t");
+  update(*incremental, snapshot_b());
+  auto const b = incremental->get("t");
+
+  // A reader still holds A: its database can not be overwritten.
+  auto next = snapshot_a();
+  next.last_updated_ = 4;
+  update(*incremental, next);
+  auto const outdated = incremental->get("t");
+  EXPECT_FALSE(outdated->tiles_current_);
+  EXPECT_EQ(b->tiles_, outdated->tiles_);
+
+  // Once A is released, the next update catches up.
+  auto const a_tiles = render(*a);
+  a.reset();
+  next.last_updated_ = 5;
+  update(*incremental, next);
+  auto const current = incremental->get("t");
+  EXPECT_TRUE(current->tiles_current_);
+  EXPECT_EQ(a_tiles, render(*current));
+}
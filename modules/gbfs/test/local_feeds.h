@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geo/latlng.h"
+
+#include "motis/module/context/motis_http_req.h"
+#include "motis/gbfs/provider_updater.h"
+
+namespace motis::gbfs {
+
+// Content of a local feed directory: one language, all files at
+// http://gbfs.test/<file>.json. With ttl 0, files are due on every update.
+struct local_feeds {
+  struct dock {
+    std::string id_;
+    geo::latlng pos_;
+    unsigned bikes_;
+  };
+
+  struct bike {
+    std::string id_;
+    geo::latlng pos_;
+  };
+
+  std::vector<dock> docks_;
+  std::vector<bike> bikes_;
+  std::int64_t last_updated_{0};
+  std::int64_t ttl_{0};
+};
+
+inline void write_file(std::filesystem::path const& p,
+                       std::string const& content) {
+  auto out = std::ofstream{p, std::ios_base::binary | std::ios_base::trunc};
+  out << content;
+}
+
+inline std::string read_file(std::filesystem::path const& p) {
+  auto in = std::ifstream{p, std::ios_base::binary};
+  return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
+
+inline void write_feeds(std::filesystem::path const& dir,
+                        local_feeds const& f) {
+  auto const wrap = [&](std::string const& data) {
+    return R"({"last_updated": )" + std::to_string(f.last_updated_) +
+           R"(, "ttl": )" + std::to_string(f.ttl_) + R"(, "data": )" + data +
+           "}";
+  };
+  auto const to_json = [](double const x) {  // lat/lon have to be doubles
+    auto s = std::to_string(x);
+    return s.find('.') == std::string::npos ? s + ".0" : s;
+  };
+  auto const feed = [](char const* name) {
+    return std::string{R"({"name": ")"} + name +
+           R"(", "url": "http://gbfs.test/)" + name + R"(.json"})";
+  };
+
+  write_file(dir / "gbfs.json",
+             wrap(R"({"en": {"feeds": [)" + feed("system_information") + "," +
+                  feed("station_information") + "," + feed("station_status") +
+                  "," + feed("free_bike_status") + "]}}"));
+  write_file(dir / "system_information.json",
+             wrap(R"({"name": "Test", "operator": "op"})"));
+
+  auto info = std::string{};
+  auto status = std::string{};
+  for (auto const& d : f.docks_) {
+    info += std::string{info.empty() ? "" : ","} + R"({"station_id": ")" +
+            d.id_ + R"(", "name": "Dock )" + d.id_ + R"(", "lat": )" +
+            to_json(d.pos_.lat_) + R"(, "lon": )" + to_json(d.pos_.lng_) +
+            "}";
+    status += std::string{status.empty() ? "" : ","} +
+              R"({"station_id": ")" + d.id_ +
+              R"(", "num_bikes_available": )" + std::to_string(d.bikes_) +
+              "}";
+  }
+  write_file(dir / "station_information.json",
+             wrap(R"({"stations": [)" + info + "]}"));
+  write_file(dir / "station_status.json",
+             wrap(R"({"stations": [)" + status + "]}"));
+
+  auto bikes = std::string{};
+  for (auto const& b : f.bikes_) {
+    bikes += std::string{bikes.empty() ? "" : ","} + R"({"bike_id": ")" +
+             b.id_ + R"(", "lat": )" + to_json(b.pos_.lat_) + R"(, "lon": )" +
+             to_json(b.pos_.lng_) + "}";
+  }
+  write_file(dir / "free_bike_status.json",
+             wrap(R"({"bikes": [)" + bikes + "]}"));
+}
+
+// Stand-in for motis_http: serves the file named like the last path
+// segment of the URL from the directory.
+inline fetch_fn_t serve_from(std::filesystem::path dir) {
+  return [dir = std::move(dir)](net::http::client::request req) {
+    auto const url = req.address.str();
+    auto res = net::http::client::response{};
+    res.status_code = 200U;
+    res.body = read_file(dir / url.substr(url.rfind('/') + 1U));
+    auto f = std::make_shared<
+        ctx::future<module::ctx_data, net::http::client::response>>(
+        ctx::op_id{});
+    f->set(std::move(res));
+    return f;
+  };
+}
+
+}  // namespace motis::gbfs
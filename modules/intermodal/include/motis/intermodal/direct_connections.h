@@ -29,10 +29,14 @@ struct direct_connection {
   int mumo_id_{0};
 };
 
+// Street routing (ppr, osrm) only, does not depend on the mumo edges.
 std::vector<direct_connection> get_direct_connections(
     query_start const& q_start, query_dest const& q_dest,
-    IntermodalRoutingRequest const* req, ppr_profiles const& profiles,
-    std::vector<mumo_edge const*> const& edge_mapping);
+    IntermodalRoutingRequest const* req, ppr_profiles const& profiles);
+
+// Adds mumo edges from start to destination (e.g. GBFS).
+void add_direct_edges(std::vector<direct_connection>& direct,
+                      std::vector<mumo_edge const*> const& edge_mapping);
 
 std::size_t remove_dominated_journeys(
     std::vector<journey>& journeys,
@@ -75,6 +75,8 @@ struct mumo_edge {
   uint16_t accessibility_;
   mumo_type type_;
   int id_;
+  int location_idx_{-1};  // from the geo station lookup, -1 = use station ID
+  std::uint64_t location_fingerprint_{0U};
   std::optional<car_parking_edge> car_parking_;
   std::optional<gbfs_edge> gbfs_;
 };
@@ -97,6 +99,11 @@ void remove_intersection(std::vector<mumo_edge>& starts,
                          geo::latlng const& query_start,
                          geo::latlng const& query_destination, SearchDir);
 
+// Timetable fingerprint shared by all edges with a location index, 0 if none
+// or if they disagree (the router then resolves station IDs).
+std::uint64_t get_location_fingerprint(std::vector<mumo_edge> const& starts,
+                                       std::vector<mumo_edge> const& dests);
+
 std::vector<flatbuffers::Offset<routing::AdditionalEdgeWrapper>> write_edges(
     flatbuffers::FlatBufferBuilder& fbb,  //
     std::vector<mumo_edge> const& starts,
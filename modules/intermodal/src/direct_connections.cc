@@ -178,8 +178,7 @@ msg_ptr make_direct_osrm_request(geo::latlng const& start,
 
 std::vector<direct_connection> get_direct_connections(
     query_start const& q_start, query_dest const& q_dest,
-    IntermodalRoutingRequest const* req, ppr_profiles const& profiles,
-    std::vector<mumo_edge const*> const& edge_mapping) {
+    IntermodalRoutingRequest const* req, ppr_profiles const& profiles) {
   auto direct = std::vector<direct_connection>{};
   auto const beeline = distance(q_start.pos_, q_dest.pos_);
 
@@ -250,13 +249,16 @@ std::vector<direct_connection> get_direct_connections(
 
   ctx::await_all(futures);
 
+  return direct;
+}
+
+void add_direct_edges(std::vector<direct_connection>& direct,
+                      std::vector<mumo_edge const*> const& edge_mapping) {
   for (auto const& [i, e] : utl::enumerate(edge_mapping)) {
     if (e->from_ == STATION_START && e->to_ == STATION_END) {
       direct.emplace_back(e->type_, e->duration_, e->accessibility_, i);
     }
   }
-
-  return direct;
 }
 
 std::size_t remove_dominated_journeys(
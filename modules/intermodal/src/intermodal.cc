@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 
@@ -285,9 +286,9 @@ msg_ptr postprocess_response(msg_ptr const& response_msg,
                              query_dest const& q_dest,
                              IntermodalRoutingRequest const* req,
                              std::vector<mumo_edge const*> const& edge_mapping,
+                             std::vector<direct_connection> const& direct,
                              statistics& stats, bool const revise,
-                             std::vector<stats_category> const& mumo_stats,
-                             ppr_profiles const& profiles) {
+                             std::vector<stats_category> const& mumo_stats) {
   auto const dir = req->search_dir();
   auto routing_response =
       response_msg ? motis_content(RoutingResponse, response_msg) : nullptr;
@@ -295,15 +296,9 @@ msg_ptr postprocess_response(msg_ptr const& response_msg,
                       ? std::vector<journey>{}
                       : message_to_journeys(routing_response);
 
-  MOTIS_START_TIMING(direct_connection_timing);
-  auto const direct =
-      get_direct_connections(q_start, q_dest, req, profiles, edge_mapping);
   stats.dominated_by_direct_connection_ =
       remove_dominated_journeys(journeys, direct);
   add_direct_connections(journeys, direct, q_start, q_dest, req);
-  MOTIS_STOP_TIMING(direct_connection_timing);
-  stats.direct_connection_duration_ =
-      static_cast<uint64_t>(MOTIS_TIMING_MS(direct_connection_timing));
 
   message_creator mc;
   for (auto& journey : journeys) {
@@ -431,7 +426,10 @@ msg_ptr postprocess_response(msg_ptr const& response_msg,
           mc.CreateVector(connections), interval_begin, interval_end,
           mc.CreateVector(utl::to_vec(
               direct,
-              [&mc](direct_connection const& c) { return to_fbs(mc, c); })))
+              [&mc](direct_connection const& c) { return to_fbs(mc, c); })),
+          (routing_response == nullptr || routing_response->cursor() == nullptr)
+              ? 0
+              : mc.CreateString(routing_response->cursor()))
           .Union());
   return make_msg(mc);
 }
@@ -468,6 +466,19 @@ msg_ptr intermodal::route(msg_ptr const& msg) {
 
   std::vector<ctx::future_ptr<ctx_data, void>> futures;
 
+  // Direct connections (street routing) do not depend on the mumo edges:
+  // computed in parallel to the edges and the public transport search.
+  // The job owns its inputs, it may outlive a failed routing call.
+  auto const direct_result = std::make_shared<std::vector<direct_connection>>();
+  MOTIS_START_TIMING(direct_connection_timing);
+  std::vector<ctx::future_ptr<ctx_data, void>> direct_futures;
+  direct_futures.emplace_back(
+      spawn_job_void([this, msg, start, dest, direct_result]() {
+        *direct_result = get_direct_connections(
+            start, dest, motis_content(IntermodalRoutingRequest, msg),
+            ppr_profiles_);
+      }));
+
   using namespace std::placeholders;
   if (req->search_dir() == SearchDir_Forward) {
     if (start.is_intermodal_) {
@@ -541,7 +552,9 @@ msg_ptr intermodal::route(msg_ptr const& msg) {
                 ? 0
                 : mc.CreateVector(req->allowed_claszes()->Data(),
                                   req->allowed_claszes()->size()),
-            req->max_transfers())
+            req->max_transfers(),
+            req->cursor() == nullptr ? 0 : mc.CreateString(req->cursor()), 0,
+            get_location_fingerprint(deps, arrs))
             .Union(),
         router);
 
@@ -553,8 +566,15 @@ msg_ptr intermodal::route(msg_ptr const& msg) {
         static_cast<uint64_t>(MOTIS_TIMING_MS(routing_timing));
   }
 
+  ctx::await_all(direct_futures);
+  auto& direct = *direct_result;
+  add_direct_edges(direct, edge_mapping);
+  MOTIS_STOP_TIMING(direct_connection_timing);
+  stats.direct_connection_duration_ =
+      static_cast<uint64_t>(MOTIS_TIMING_MS(direct_connection_timing));
+
   return postprocess_response(routing_resp, start, dest, req, edge_mapping,
-                              stats, revise_, mumo_stats, ppr_profiles_);
+                              direct, stats, revise_, mumo_stats);
 }
 
 }  // namespace motis::intermodal
@@ -1,12 +1,19 @@
 #include "motis/intermodal/mumo_edge.h"
 
 #include <algorithm>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "utl/erase_if.h"
+#include "utl/helpers/algorithm.h"
+#include "utl/to_vec.h"
 
 #include "motis/core/common/constants.h"
+#include "motis/core/common/timing.h"
 #include "motis/core/conv/position_conv.h"
 #include "motis/module/context/motis_call.h"
+#include "motis/module/context/motis_spawn.h"
 #include "motis/module/message.h"
 
 #include "motis/intermodal/error.h"
@@ -60,11 +67,11 @@ msg_ptr make_geo_request(latlng const& pos, double radius) {
 }
 
 msg_ptr make_osrm_request(latlng const& pos,
-                          Vector<Offset<Station>> const* stations,
+                          std::vector<Station const*> const& stations,
                           std::string const& profile, SearchDir direction) {
   Position const fbs_position{pos.lat_, pos.lng_};
   std::vector<Position> many;
-  for (auto const* station : *stations) {
+  for (auto const* station : stations) {
     many.push_back(*station->pos());
   }
 
@@ -78,31 +85,31 @@ msg_ptr make_osrm_request(latlng const& pos,
   return make_msg(mc);
 }
 
-void osrm_edges(latlng const& pos, int max_dur, int max_dist,
-                mumo_type const type, SearchDir direction,
+void osrm_edges(latlng const& pos, std::vector<Station const*> const& stations,
+                int max_dur, mumo_type const type, SearchDir direction,
                 appender_fun const& appender) {
-  auto const geo_msg = motis_call(make_geo_request(pos, max_dist))->val();
-  auto const geo_resp = motis_content(LookupGeoStationResponse, geo_msg);
-  auto const stations = geo_resp->stations();
+  if (stations.empty()) {
+    return;
+  }
 
   auto const osrm_msg =
       motis_call(make_osrm_request(pos, stations, to_string(type), direction))
           ->val();
   auto const osrm_resp = motis_content(OSRMOneToManyResponse, osrm_msg);
 
-  for (auto i = 0UL; i < stations->size(); ++i) {
+  for (auto i = 0UL; i < stations.size(); ++i) {
     auto const dur = osrm_resp->costs()->Get(i)->duration();
     if (dur > max_dur) {
       continue;
     }
 
-    appender(stations->Get(i)->id()->str(), from_fbs(stations->Get(i)->pos()),
-             dur / 60, 0, type, 0);
+    appender(stations[i]->id()->str(), from_fbs(stations[i]->pos()), dur / 60,
+             0, type, 0);
   }
 }
 
 msg_ptr make_ppr_request(latlng const& pos,
-                         Vector<Offset<Station>> const* stations,
+                         std::vector<Station const*> const& stations,
                          SearchOptions const* search_options, SearchDir dir) {
   assert(search_options != nullptr);
   Position const fbs_position{pos.lat_, pos.lng_};
@@ -113,7 +120,7 @@ msg_ptr make_ppr_request(latlng const& pos,
       CreateFootRoutingRequest(
           mc, &fbs_position,
           mc.CreateVectorOfStructs(utl::to_vec(
-              *stations, [](auto&& station) { return *station->pos(); })),
+              stations, [](auto&& station) { return *station->pos(); })),
           motis_copy_table(SearchOptions, mc, search_options), dir, false,
           false, false)
           .Union(),
@@ -121,18 +128,12 @@ msg_ptr make_ppr_request(latlng const& pos,
   return make_msg(mc);
 }
 
-void ppr_edges(latlng const& pos, SearchOptions const* search_options,
-               SearchDir direction, appender_fun const& appender,
-               ppr_profiles const& profiles) {
-  auto const max_dur = search_options->duration_limit();
-  if (max_dur == 0) {
+void ppr_edges(latlng const& pos, std::vector<Station const*> const& stations,
+               SearchOptions const* search_options, SearchDir direction,
+               appender_fun const& appender) {
+  if (search_options->duration_limit() == 0) {
     return;
   }
-  auto const max_dist =
-      max_dur * profiles.get_walking_speed(search_options->profile()->str());
-  auto const geo_msg = motis_call(make_geo_request(pos, max_dist))->val();
-  auto const geo_resp = motis_content(LookupGeoStationResponse, geo_msg);
-  auto const stations = geo_resp->stations();
 
   auto const ppr_msg =
       motis_call(make_ppr_request(pos, stations, search_options, direction))
@@ -140,11 +141,11 @@ void ppr_edges(latlng const& pos, SearchOptions const* search_options,
   auto const ppr_resp = motis_content(FootRoutingResponse, ppr_msg);
 
   auto const routes = ppr_resp->routes();
-  assert(routes->size() <= stations->size());
+  assert(routes->size() <= stations.size());
   for (auto i = 0U; i < routes->size(); ++i) {
     auto const dest_routes = routes->Get(i);
-    auto const dest_id = stations->Get(i)->id()->str();
-    auto const dest_pos = from_fbs(stations->Get(i)->pos());
+    auto const dest_id = stations[i]->id()->str();
+    auto const dest_pos = from_fbs(stations[i]->pos());
     for (auto const& route : *dest_routes->routes()) {
       appender(dest_id, dest_pos, route->duration(), route->accessibility(),
                mumo_type::FOOT, 0);
@@ -254,67 +255,208 @@ void gbfs_edges(appender_fun const& appender, SearchDir const dir,
   }
 }
 
+char const* mode_name(Mode const m) {
+  switch (m) {
+    case Mode_Foot: return "foot";
+    case Mode_Bike: return "bike";
+    case Mode_Car: return "car";
+    case Mode_FootPPR: return "foot_ppr";
+    case Mode_CarParking: return "car_parking";
+    case Mode_GBFS: return "gbfs";
+    default: return "unknown";
+  }
+}
+
+// Radius for the geo station lookup, 0 = mode does not use it.
+double geo_radius(ModeWrapper const* wrapper, ppr_profiles const& profiles) {
+  switch (wrapper->mode_type()) {
+    case Mode_Foot: {
+      auto const max_dur =
+          reinterpret_cast<Foot const*>(wrapper->mode())->max_duration();
+      return static_cast<int>(max_dur * WALK_SPEED);
+    }
+
+    case Mode_Bike: {
+      auto const max_dur =
+          reinterpret_cast<Bike const*>(wrapper->mode())->max_duration();
+      return static_cast<int>(max_dur * BIKE_SPEED);
+    }
+
+    case Mode_Car: {
+      auto const max_dur =
+          reinterpret_cast<Car const*>(wrapper->mode())->max_duration();
+      return static_cast<int>(max_dur * CAR_SPEED);
+    }
+
+    case Mode_FootPPR: {
+      auto const options =
+          reinterpret_cast<FootPPR const*>(wrapper->mode())->search_options();
+      return options->duration_limit() *
+             profiles.get_walking_speed(options->profile()->str());
+    }
+
+    default: return 0.0;
+  }
+}
+
+void make_mode_edges(ModeWrapper const* wrapper, latlng const& pos,
+                     latlng const& direct_target, SearchDir const search_dir,
+                     std::vector<Station const*> const& stations,
+                     appender_fun const& appender,
+                     mumo_stats_appender_fun const& mumo_stats_appender,
+                     std::string const& mumo_stats_prefix) {
+  switch (wrapper->mode_type()) {
+    case Mode_Foot: {
+      auto const max_dur =
+          reinterpret_cast<Foot const*>(wrapper->mode())->max_duration();
+      osrm_edges(pos, stations, max_dur, mumo_type::FOOT, search_dir,
+                 appender);
+      break;
+    }
+
+    case Mode_Bike: {
+      auto const max_dur =
+          reinterpret_cast<Bike const*>(wrapper->mode())->max_duration();
+      osrm_edges(pos, stations, max_dur, mumo_type::BIKE, search_dir,
+                 appender);
+      break;
+    }
+
+    case Mode_Car: {
+      auto const max_dur =
+          reinterpret_cast<Car const*>(wrapper->mode())->max_duration();
+      osrm_edges(pos, stations, max_dur, mumo_type::CAR, search_dir, appender);
+      break;
+    }
+
+    case Mode_FootPPR: {
+      auto const options =
+          reinterpret_cast<FootPPR const*>(wrapper->mode())->search_options();
+      ppr_edges(pos, stations, options, search_dir, appender);
+      break;
+    }
+
+    case Mode_CarParking: {
+      auto const cp = reinterpret_cast<CarParking const*>(wrapper->mode());
+      car_parking_edges(pos, cp->max_car_duration(), cp->ppr_search_options(),
+                        search_dir, appender, mumo_stats_appender,
+                        mumo_stats_prefix);
+      break;
+    }
+
+    case Mode_GBFS: {
+      auto const gbfs = reinterpret_cast<GBFS const*>(wrapper->mode());
+      gbfs_edges(appender, search_dir, pos, direct_target,
+                 gbfs->provider()->str(), gbfs->max_walk_duration() / 60.0,
+                 gbfs->max_vehicle_duration() / 60.0);
+      break;
+    }
+
+    default: throw std::system_error(error::unknown_mode);
+  }
+}
+
 void make_edges(Vector<Offset<ModeWrapper>> const* modes, latlng const& pos,
                 latlng const& direct_target, SearchDir const search_dir,
                 appender_fun const& appender,
                 mumo_stats_appender_fun const& mumo_stats_appender,
                 std::string const& mumo_stats_prefix,
                 ppr_profiles const& profiles) {
-  for (auto const& wrapper : *modes) {
-    switch (wrapper->mode_type()) {
-      case Mode_Foot: {
-        auto const max_dur =
-            reinterpret_cast<Foot const*>(wrapper->mode())->max_duration();
-        auto const max_dist = max_dur * WALK_SPEED;
-        osrm_edges(pos, max_dur, max_dist, mumo_type::FOOT, search_dir,
-                   appender);
-        break;
-      }
+  auto timings = stats_category{mumo_stats_prefix + "modes"};
 
-      case Mode_Bike: {
-        auto const max_dur =
-            reinterpret_cast<Bike const*>(wrapper->mode())->max_duration();
-        auto const max_dist = max_dur * BIKE_SPEED;
-        osrm_edges(pos, max_dur, max_dist, mumo_type::BIKE, search_dir,
-                   appender);
-        break;
-      }
-
-      case Mode_Car: {
-        auto const max_dur =
-            reinterpret_cast<Car const*>(wrapper->mode())->max_duration();
-        auto const max_dist = max_dur * CAR_SPEED;
-        osrm_edges(pos, max_dur, max_dist, mumo_type::CAR, search_dir,
-                   appender);
-        break;
-      }
-
-      case Mode_FootPPR: {
-        auto const options =
-            reinterpret_cast<FootPPR const*>(wrapper->mode())->search_options();
-        ppr_edges(pos, options, search_dir, appender, profiles);
-        break;
+  // One geo station lookup with the largest radius, filtered per mode.
+  auto max_radius = 0.0;
+  for (auto const& wrapper : *modes) {
+    max_radius = std::max(max_radius, geo_radius(wrapper, profiles));
+  }
+  auto geo_msg = msg_ptr{};
+  auto geo_stations = std::vector<Station const*>{};
+  auto location_idx = std::unordered_map<std::string_view, std::uint32_t>{};
+  auto location_fingerprint = std::uint64_t{0U};
+  if (max_radius > 0.0) {
+    MOTIS_START_TIMING(geo_lookup_timing);
+    geo_msg = motis_call(make_geo_request(pos, max_radius))->val();
+    auto const res = motis_content(LookupGeoStationResponse, geo_msg);
+    for (auto const* s : *res->stations()) {
+      geo_stations.emplace_back(s);
+    }
+    if (res->location_fingerprint() != 0U && res->location_idx() != nullptr &&
+        res->location_idx()->size() == res->stations()->size()) {
+      location_fingerprint = res->location_fingerprint();
+      for (auto i = 0U; i != res->stations()->size(); ++i) {
+        location_idx.emplace(res->stations()->Get(i)->id()->view(),
+                             res->location_idx()->Get(i));
       }
+    }
+    MOTIS_STOP_TIMING(geo_lookup_timing);
+    timings.entries_.emplace_back(
+        "geo_lookup_duration",
+        static_cast<uint64_t>(MOTIS_TIMING_MS(geo_lookup_timing)));
+  }
 
-      case Mode_CarParking: {
-        auto const cp = reinterpret_cast<CarParking const*>(wrapper->mode());
-        car_parking_edges(pos, cp->max_car_duration(), cp->ppr_search_options(),
-                          search_dir, appender, mumo_stats_appender,
-                          mumo_stats_prefix);
-        break;
+  // Modes run in parallel. Each collects its edges separately, they are
+  // handed to the appender afterwards in the order of the request.
+  struct mode_result {
+    std::vector<mumo_edge> edges_;
+    uint64_t duration_{};
+  };
+  auto results = std::vector<mode_result>(modes->size());
+  auto futures = std::vector<ctx::future_ptr<ctx_data, void>>{};
+  for (auto i = 0U; i != modes->size(); ++i) {
+    futures.emplace_back(spawn_job_void([&, i]() {
+      MOTIS_START_TIMING(mode_timing);
+      auto const wrapper = modes->Get(i);
+      auto const radius = geo_radius(wrapper, profiles);
+      auto stations = std::vector<Station const*>{};
+      for (auto const* s : geo_stations) {
+        if (distance(pos, from_fbs(s->pos())) <= radius) {
+          stations.emplace_back(s);
+        }
       }
 
-      case Mode_GBFS: {
-        auto const gbfs = reinterpret_cast<GBFS const*>(wrapper->mode());
-        gbfs_edges(appender, search_dir, pos, direct_target,
-                   gbfs->provider()->str(), gbfs->max_walk_duration() / 60.0,
-                   gbfs->max_vehicle_duration() / 60.0);
-        break;
+      auto& r = results[i];
+      make_mode_edges(
+          wrapper, pos, direct_target, search_dir, stations,
+          [&](std::string const& station_id, latlng const& station_pos,
+              duration const d, uint16_t const accessibility,
+              mumo_type const type, int const id) -> mumo_edge& {
+            return r.edges_.emplace_back(station_id, station_id, station_pos,
+                                         station_pos, d, accessibility, type,
+                                         id);
+          },
+          mumo_stats_appender, mumo_stats_prefix);
+      MOTIS_STOP_TIMING(mode_timing);
+      r.duration_ = static_cast<uint64_t>(MOTIS_TIMING_MS(mode_timing));
+    }));
+  }
+  ctx::await_all(futures);
+
+  for (auto i = 0U; i != modes->size(); ++i) {
+    auto& r = results[i];
+    for (auto& buffered : r.edges_) {
+      auto& e = appender(buffered.to_, buffered.to_pos_, buffered.duration_,
+                         buffered.accessibility_, buffered.type_,
+                         buffered.id_);
+      e.car_parking_ = std::move(buffered.car_parking_);
+      e.gbfs_ = std::move(buffered.gbfs_);
+      if (auto const it = location_idx.find(buffered.to_);
+          it != end(location_idx)) {
+        e.location_idx_ = static_cast<int>(it->second);
+        e.location_fingerprint_ = location_fingerprint;
       }
+    }
 
-      default: throw std::system_error(error::unknown_mode);
+    auto const key =
+        std::string{mode_name(modes->Get(i)->mode_type())} + "_duration";
+    auto const it = utl::find_if(
+        timings.entries_, [&](stats_entry const& s) { return s.key_ == key; });
+    if (it == end(timings.entries_)) {
+      timings.entries_.emplace_back(key, r.duration_);
+    } else {
+      it->value_ = std::max(it->value_, r.duration_);
     }
   }
+  mumo_stats_appender(std::move(timings));
 }
 
 void make_starts(IntermodalRoutingRequest const* req, latlng const& pos,
@@ -341,41 +483,65 @@ void remove_intersection(std::vector<mumo_edge>& starts,
   if (starts.empty() || destinations.empty()) {
     return;
   }
-  if (dir == SearchDir_Forward) {
-    utl::erase_if(starts, [&](auto const& start) {
-      return std::find_if(begin(destinations), end(destinations),
-                          [&](auto const& dest) {
-                            return start.to_ == dest.from_;
-                          }) != end(destinations) &&
-             distance(start.to_pos_, query_destination) <
-                 distance(start.to_pos_, query_start);
-    });
-    utl::erase_if(destinations, [&](auto const& dest) {
-      return std::find_if(begin(starts), end(starts),
-                          [&](auto const& start) {
-                            return start.to_ == dest.from_;
-                          }) != end(starts) &&
-             distance(dest.from_pos_, query_start) <
-                 distance(dest.from_pos_, query_destination);
-    });
-  } else {
-    utl::erase_if(starts, [&](auto const& start) {
-      return std::find_if(begin(destinations), end(destinations),
-                          [&](auto const& dest) {
-                            return start.from_ == dest.to_;
-                          }) != end(destinations) &&
-             distance(start.from_pos_, query_destination) <
-                 distance(start.from_pos_, query_start);
-    });
-    utl::erase_if(destinations, [&](auto const& dest) {
-      return std::find_if(begin(starts), end(starts),
-                          [&](auto const& start) {
-                            return start.from_ == dest.to_;
-                          }) != end(starts) &&
-             distance(dest.to_pos_, query_start) <
-                 distance(dest.to_pos_, query_destination);
-    });
+
+  // Station IDs at the public transport side of the edges.
+  auto const start_station = [&](mumo_edge const& e) -> std::string const& {
+    return dir == SearchDir_Forward ? e.to_ : e.from_;
+  };
+  auto const start_pos = [&](mumo_edge const& e) -> latlng const& {
+    return dir == SearchDir_Forward ? e.to_pos_ : e.from_pos_;
+  };
+  auto const dest_station = [&](mumo_edge const& e) -> std::string const& {
+    return dir == SearchDir_Forward ? e.from_ : e.to_;
+  };
+  auto const dest_pos = [&](mumo_edge const& e) -> latlng const& {
+    return dir == SearchDir_Forward ? e.from_pos_ : e.to_pos_;
+  };
+
+  // Distances are only computed for stations reachable from both sides.
+  auto stations = std::unordered_set<std::string_view>{};
+  stations.reserve(destinations.size());
+  for (auto const& dest : destinations) {
+    stations.emplace(dest_station(dest));
+  }
+  utl::erase_if(starts, [&](mumo_edge const& start) {
+    if (stations.find(start_station(start)) == end(stations)) {
+      return false;
+    }
+    auto const& pos = start_pos(start);
+    return distance(pos, query_destination) < distance(pos, query_start);
+  });
+
+  // Second pass matches against the remaining start edges.
+  stations.clear();
+  stations.reserve(starts.size());
+  for (auto const& start : starts) {
+    stations.emplace(start_station(start));
+  }
+  utl::erase_if(destinations, [&](mumo_edge const& dest) {
+    if (stations.find(dest_station(dest)) == end(stations)) {
+      return false;
+    }
+    auto const& pos = dest_pos(dest);
+    return distance(pos, query_start) < distance(pos, query_destination);
+  });
+}
+
+std::uint64_t get_location_fingerprint(std::vector<mumo_edge> const& starts,
+                                       std::vector<mumo_edge> const& dests) {
+  auto fingerprint = std::uint64_t{0U};
+  for (auto const* edges : {&starts, &dests}) {
+    for (auto const& e : *edges) {
+      if (e.location_idx_ == -1) {
+        continue;
+      } else if (fingerprint == 0U) {
+        fingerprint = e.location_fingerprint_;
+      } else if (fingerprint != e.location_fingerprint_) {
+        return 0U;
+      }
+    }
   }
+  return fingerprint;
 }
 
 std::vector<Offset<AdditionalEdgeWrapper>> write_edges(
@@ -392,7 +558,7 @@ std::vector<Offset<AdditionalEdgeWrapper>> write_edges(
         fbb, AdditionalEdge_MumoEdge,
         CreateMumoEdge(fbb, fbb.CreateString(edge.from_),
                        fbb.CreateString(edge.to_), edge.duration_, 0,
-                       edge.accessibility_, edge_id)
+                       edge.accessibility_, edge_id, edge.location_idx_)
             .Union()));
   }
 
@@ -403,7 +569,7 @@ std::vector<Offset<AdditionalEdgeWrapper>> write_edges(
         fbb, AdditionalEdge_MumoEdge,
         CreateMumoEdge(fbb, fbb.CreateString(edge.from_),
                        fbb.CreateString(edge.to_), edge.duration_, 0,
-                       edge.accessibility_, edge_id)
+                       edge.accessibility_, edge_id, edge.location_idx_)
             .Union()));
   }
 
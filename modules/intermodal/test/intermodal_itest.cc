@@ -1,23 +1,32 @@
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <sstream>
 #include <string>
+#include <tuple>
 
 #include "fmt/format.h"
 
 #include "flatbuffers/flatbuffers.h"
 #include "flatbuffers/idl.h"
 
+#include "utl/to_vec.h"
+
 #include "geo/latlng.h"
 
 #include "motis/core/common/constants.h"
 #include "motis/core/journey/journey.h"
 #include "motis/core/journey/message_to_journeys.h"
 #include "motis/core/journey/print_journey.h"
+#include "motis/module/context/motis_call.h"
 #include "motis/module/message.h"
 #include "motis/test/motis_instance_test.h"
 
+#include "motis/intermodal/mumo_edge.h"
+
 using namespace geo;
 using namespace flatbuffers;
+using namespace motis::lookup;
 using namespace motis::osrm;
 using namespace motis::test;
 using namespace motis::module;
@@ -264,4 +273,198 @@ TEST_F(intermodal_itest, not_so_intermodal) {
   }
 }
 
+TEST_F(intermodal_itest, slow_direct_connection) {
+  //  Heidelberg Hbf -> Bensheim ( departure: 2015-11-24 13:30:00 )
+  //  Car is slow (mocked with walking speed): direct connection ~5.5h.
+  auto res = call(make_msg(R"({
+      "destination": {
+        "type": "Module",
+        "target": "/intermodal"
+      },
+      "content_type": "IntermodalRoutingRequest",
+      "content": {
+        "start_type": "IntermodalOntripStart",
+        "start": {
+          "position": { "lat": 49.4047178, "lng": 8.6768716},
+          "departure_time": 1448368200
+        },
+        "start_modes": [{
+          "mode_type": "Foot",
+          "mode": { "max_duration": 600 }
+        },{
+          "mode_type": "Car",
+          "mode": { "max_duration": 36000 }
+        }],
+        "destination_type": "InputPosition",
+        "destination": { "lat": 49.6801332, "lng": 8.6200666},
+        "destination_modes":  [{
+          "mode_type": "Foot",
+          "mode": { "max_duration": 600 }
+        }],
+        "search_type": "Default",
+        "router": "/nigiri"
+      }
+    })"));
+  auto content = motis_content(RoutingResponse, res);
+
+  ASSERT_EQ(1U, content->direct_connections()->size());
+  auto const direct = content->direct_connections()->Get(0);
+  EXPECT_STREQ("car", direct->mumo_type()->c_str());
+
+  auto const journeys = message_to_journeys(content);
+  auto pt_journeys = 0U;
+  for (auto const& j : journeys) {
+    if (j.stops_.size() == 2U) {
+      continue;  // direct connection
+    }
+    ++pt_journeys;
+    EXPECT_LE(j.duration_, direct->duration());
+  }
+  EXPECT_NE(0U, pt_journeys);
+
+  // All public transport journeys are faster than the direct connection:
+  // none of them is removed as dominated.
+  auto const stats = content->statistics()->LookupByKey("intermodal");
+  ASSERT_NE(nullptr, stats);
+  auto const dominated =
+      stats->entries()->LookupByKey("dominated_by_direct_connection");
+  ASSERT_NE(nullptr, dominated);
+  EXPECT_EQ(0U, dominated->value());
+}
+
+TEST_F(intermodal_itest, parallel_modes) {
+  auto edges = std::vector<std::string>{};
+  auto stats = std::vector<stats_category>{};
+  instance_->register_op(
+      "/intermodal_test/starts",
+      [&](msg_ptr const& msg) {
+        auto const req = motis_content(IntermodalRoutingRequest, msg);
+        auto const pos = latlng{49.4047178, 8.6768716};
+        auto const target = latlng{49.6801332, 8.6200666};
+        auto const profiles = ppr_profiles{};
+        auto buf = std::vector<mumo_edge>{};
+        make_starts(
+            req, pos, target,
+            [&](std::string const& id, latlng const& station_pos,
+                duration const d, uint16_t const accessibility,
+                mumo_type const type, int const edge_id) -> mumo_edge& {
+              return buf.emplace_back(STATION_START, id, pos, station_pos, d,
+                                      accessibility, type, edge_id);
+            },
+            [&](stats_category&& s) { stats.emplace_back(std::move(s)); },
+            profiles);
+        for (auto const& e : buf) {
+          std::stringstream ss;
+          ss << e;
+          edges.emplace_back(ss.str());
+        }
+        return make_success_msg();
+      },
+      {});
+
+  auto const get_edges = [&](std::string_view modes) {
+    edges.clear();
+    stats.clear();
+    call(make_msg(fmt::format(R"({{
+      "destination": {{
+        "type": "Module",
+        "target": "/intermodal_test/starts"
+      }},
+      "content_type": "IntermodalRoutingRequest",
+      "content": {{
+        "start_type": "IntermodalOntripStart",
+        "start": {{
+          "position": {{ "lat": 49.4047178, "lng": 8.6768716}},
+          "departure_time": 1448368200
+        }},
+        "start_modes": [{}],
+        "destination_type": "InputPosition",
+        "destination": {{ "lat": 49.6801332, "lng": 8.6200666}},
+        "destination_modes": [],
+        "search_type": "Default"
+      }}
+    }})",
+                              modes)));
+    std::sort(begin(edges), end(edges));
+    return edges;
+  };
+
+  auto const foot =
+      R"({ "mode_type": "Foot", "mode": { "max_duration": 900 } })";
+  auto const bike =
+      R"({ "mode_type": "Bike", "mode": { "max_duration": 600 } })";
+  auto const car = R"({ "mode_type": "Car", "mode": { "max_duration": 300 } })";
+
+  // Baseline: the sequential algorithm, one geo station lookup at the
+  // radius of each mode followed by its OSRM call.
+  auto const baseline = [&](int const max_dur, double const speed,
+                            mumo_type const type) {
+    auto const pos = latlng{49.4047178, 8.6768716};
+    auto const fbs_pos = Position{pos.lat_, pos.lng_};
+    auto result = std::vector<std::string>{};
+    run([&]() {
+      message_creator geo_mc;
+      geo_mc.create_and_finish(
+          MsgContent_LookupGeoStationRequest,
+          CreateLookupGeoStationRequest(
+              geo_mc, &fbs_pos, 0, static_cast<int>(max_dur * speed))
+              .Union(),
+          "/lookup/geo_station");
+      auto const geo_msg = motis_call(make_msg(geo_mc))->val();
+      auto const stations =
+          motis_content(LookupGeoStationResponse, geo_msg)->stations();
+
+      message_creator osrm_mc;
+      osrm_mc.create_and_finish(
+          MsgContent_OSRMOneToManyRequest,
+          CreateOSRMOneToManyRequest(
+              osrm_mc, osrm_mc.CreateString(to_string(type)),
+              SearchDir_Forward, &fbs_pos,
+              osrm_mc.CreateVectorOfStructs(utl::to_vec(
+                  *stations, [](Station const* s) { return *s->pos(); })))
+              .Union(),
+          "/osrm/one_to_many");
+      auto const osrm_msg = motis_call(make_msg(osrm_mc))->val();
+      auto const costs =
+          motis_content(OSRMOneToManyResponse, osrm_msg)->costs();
+
+      for (auto i = 0U; i != stations->size(); ++i) {
+        auto const dur = costs->Get(i)->duration();
+        if (dur > max_dur) {
+          continue;
+        }
+        auto const s = stations->Get(i);
+        std::stringstream ss;
+        ss << mumo_edge{STATION_START,
+                        s->id()->str(),
+                        pos,
+                        {s->pos()->lat(), s->pos()->lng()},
+                        static_cast<duration>(dur / 60),
+                        0,
+                        type,
+                        0};
+        result.emplace_back(ss.str());
+      }
+    });
+    std::sort(begin(result), end(result));
+    return result;
+  };
+
+  auto expected = std::vector<std::string>{};
+  for (auto const& [mode, max_dur, speed, type] :
+       {std::tuple{foot, 900, WALK_SPEED, mumo_type::FOOT},
+        std::tuple{bike, 600, BIKE_SPEED, mumo_type::BIKE},
+        std::tuple{car, 300, CAR_SPEED, mumo_type::CAR}}) {
+    auto const single = baseline(max_dur, speed, type);
+    ASSERT_FALSE(single.empty());
+    EXPECT_EQ(single, get_edges(mode));
+    expected.insert(end(expected), begin(single), end(single));
+  }
+  std::sort(begin(expected), end(expected));
+
+  EXPECT_EQ(expected, get_edges(fmt::format("{},{},{}", foot, bike, car)));
+  ASSERT_EQ(1U, stats.size());
+  EXPECT_EQ("intermodal.start.modes", stats.front().key_);
+}
+
 }  // namespace motis::intermodal
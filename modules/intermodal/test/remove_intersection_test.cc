@@ -0,0 +1,161 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "utl/erase_if.h"
+#include "utl/to_vec.h"
+
+#include "motis/core/common/constants.h"
+
+#include "motis/intermodal/mumo_edge.h"
+
+using namespace motis;
+using namespace motis::intermodal;
+
+namespace {
+
+// Previous implementation: linear scan over the other side for every edge.
+void remove_intersection_reference(std::vector<mumo_edge>& starts,
+                                   std::vector<mumo_edge>& destinations,
+                                   geo::latlng const& query_start,
+                                   geo::latlng const& query_destination,
+                                   SearchDir const dir) {
+  if (starts.empty() || destinations.empty()) {
+    return;
+  }
+  if (dir == SearchDir_Forward) {
+    utl::erase_if(starts, [&](auto const& start) {
+      return std::find_if(begin(destinations), end(destinations),
+                          [&](auto const& dest) {
+                            return start.to_ == dest.from_;
+                          }) != end(destinations) &&
+             distance(start.to_pos_, query_destination) <
+                 distance(start.to_pos_, query_start);
+    });
+    utl::erase_if(destinations, [&](auto const& dest) {
+      return std::find_if(begin(starts), end(starts),
+                          [&](auto const& start) {
+                            return start.to_ == dest.from_;
+                          }) != end(starts) &&
+             distance(dest.from_pos_, query_start) <
+                 distance(dest.from_pos_, query_destination);
+    });
+  } else {
+    utl::erase_if(starts, [&](auto const& start) {
+      return std::find_if(begin(destinations), end(destinations),
+                          [&](auto const& dest) {
+                            return start.from_ == dest.to_;
+                          }) != end(destinations) &&
+             distance(start.from_pos_, query_destination) <
+                 distance(start.from_pos_, query_start);
+    });
+    utl::erase_if(destinations, [&](auto const& dest) {
+      return std::find_if(begin(starts), end(starts),
+                          [&](auto const& start) {
+                            return start.from_ == dest.to_;
+                          }) != end(starts) &&
+             distance(dest.to_pos_, query_start) <
+                 distance(dest.to_pos_, query_destination);
+    });
+  }
+}
+
+struct random_edges {
+  random_edges(unsigned const seed, std::size_t const n_stations,
+               std::size_t const n_starts, std::size_t const n_dests,
+               SearchDir const dir)
+      : rng_{seed} {
+    auto coord = std::uniform_real_distribution<double>{49.0, 50.0};
+    auto const random_pos = [&]() {
+      return geo::latlng{coord(rng_), coord(rng_) - 41.0};
+    };
+    query_start_ = random_pos();
+    query_dest_ = random_pos();
+
+    auto stations = std::vector<std::pair<std::string, geo::latlng>>{};
+    for (auto i = 0U; i != n_stations; ++i) {
+      stations.emplace_back("station_" + std::to_string(i), random_pos());
+    }
+
+    auto station = std::uniform_int_distribution<std::size_t>{
+        0U, stations.size() - 1U};
+    auto const make_edge = [&](bool const is_start, int const id) {
+      auto const& [s, pos] = stations[station(rng_)];
+      auto const& [q, q_pos] = is_start
+                                   ? std::pair{STATION_START, query_start_}
+                                   : std::pair{STATION_END, query_dest_};
+      auto const from_query = (is_start == (dir == SearchDir_Forward));
+      return from_query
+                 ? mumo_edge{q, s, q_pos, pos, 10, 0, mumo_type::FOOT, id}
+                 : mumo_edge{s, q, pos, q_pos, 10, 0, mumo_type::FOOT, id};
+    };
+    for (auto i = 0U; i != n_starts; ++i) {
+      starts_.emplace_back(make_edge(true, static_cast<int>(i)));
+    }
+    for (auto i = 0U; i != n_dests; ++i) {
+      dests_.emplace_back(make_edge(false, static_cast<int>(i)));
+    }
+  }
+
+  std::mt19937 rng_;
+  geo::latlng query_start_, query_dest_;
+  std::vector<mumo_edge> starts_, dests_;
+};
+
+std::vector<int> ids(std::vector<mumo_edge> const& edges) {
+  return utl::to_vec(edges, [](mumo_edge const& e) { return e.id_; });
+}
+
+}  // namespace
+
+TEST(intermodal, remove_intersection_randomized) {
+  for (auto const dir : {SearchDir_Forward, SearchDir_Backward}) {
+    for (auto seed = 0U; seed != 200U; ++seed) {
+      SCOPED_TRACE(seed);
+      auto e = random_edges{seed, 1U + seed % 50U, seed % 30U, seed % 40U, dir};
+
+      auto expected_starts = e.starts_;
+      auto expected_dests = e.dests_;
+      remove_intersection_reference(expected_starts, expected_dests,
+                                    e.query_start_, e.query_dest_, dir);
+
+      remove_intersection(e.starts_, e.dests_, e.query_start_, e.query_dest_,
+                          dir);
+
+      EXPECT_EQ(ids(expected_starts), ids(e.starts_));
+      EXPECT_EQ(ids(expected_dests), ids(e.dests_));
+    }
+  }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(intermodal, DISABLED_remove_intersection_benchmark) {
+  auto const timed = [](auto&& fn) {
+    auto const start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+
+  auto e = random_edges{42U, 20'000U, 10'000U, 10'000U, SearchDir_Forward};
+  auto reference = e;
+
+  auto const hash_ms = timed([&]() {
+    remove_intersection(e.starts_, e.dests_, e.query_start_, e.query_dest_,
+                        SearchDir_Forward);
+  });
+  auto const reference_ms = timed([&]() {
+    remove_intersection_reference(reference.starts_, reference.dests_,
+                                  reference.query_start_,
+                                  reference.query_dest_, SearchDir_Forward);
+  });
+
+  std::cout << "remove_intersection 10k x 10k: " << hash_ms
+            << "ms (reference: " << reference_ms << "ms)\n";
+  EXPECT_EQ(ids(reference.starts_), ids(e.starts_));
+  EXPECT_EQ(ids(reference.dests_), ids(e.dests_));
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #include "geo/point_rtree.h"
 
 #include "motis/core/schedule/station_lookup.h"
@@ -12,7 +14,10 @@ struct timetable;
 
 namespace motis::nigiri {
 
+// location_fingerprint: returned with the location indices of the stations
+// (= nigiri location_idx_t), accepted by route() for MumoEdge.location_idx.
 motis::module::msg_ptr geo_station_lookup(station_lookup const&,
+                                          std::uint64_t location_fingerprint,
                                           motis::module::msg_ptr const&);
 
 motis::module::msg_ptr station_location(tag_lookup const& tags,
@@ -23,8 +23,14 @@ struct nigiri : public motis::module::module {
   bool import_successful() const override { return import_successful_; }
 
 private:
+  struct timetable_data;
+
+  std::shared_ptr<timetable_data> load_timetable() const;
+  void reload();
+
   void register_gtfsrt_timer(motis::module::dispatcher&);
-  void update_gtfsrt();
+  void apply_gtfsrt_paths(timetable_data&) const;
+  void update_gtfsrt(timetable_data&) const;
 
   bool import_successful_{false};
 
@@ -47,6 +53,10 @@ private:
   unsigned gtfsrt_update_interval_sec_{60U};
   bool gtfsrt_incremental_{false};
   bool debug_{false};
+  unsigned routing_max_states_{0U};
+  std::size_t routing_max_state_mb_{0U};
+  std::size_t routing_cursor_cache_size_{1024U};
+  bool reload_{false};
 };
 
 }  // namespace motis::nigiri
@@ -12,10 +12,19 @@ struct rt_timetable;
 namespace motis::nigiri {
 
 struct tag_lookup;
+struct routing_state_pool;
+struct routing_cursor_cache;
 
+// pool=nullptr: use the (unbounded) default pool
+// cursors=nullptr: no pagination cursors
+// rt_version: changes with every RT update, invalidates cursors
+// location_fingerprint: MumoEdge.location_idx values are only used if the
+//   request has the same fingerprint, otherwise station IDs are resolved
 motis::module::msg_ptr route(
     tag_lookup const&, ::nigiri::timetable const&,
     ::nigiri::rt_timetable const*, motis::module::msg_ptr const&,
-    ::nigiri::profile_idx_t const prf_idx = ::nigiri::profile_idx_t{0U});
+    ::nigiri::profile_idx_t const prf_idx = ::nigiri::profile_idx_t{0U},
+    routing_state_pool* pool = nullptr, routing_cursor_cache* cursors = nullptr,
+    std::uint64_t rt_version = 0U, std::uint64_t location_fingerprint = 0U);
 
 }  // namespace motis::nigiri
\ No newline at end of file
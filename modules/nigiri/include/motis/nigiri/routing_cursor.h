@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "nigiri/routing/journey.h"
+#include "nigiri/types.h"
+
+namespace motis::nigiri {
+
+// Keeps the results of previous searches for "earlier/later" pagination.
+// The cursor handed to clients references an entry and carries the query
+// fingerprint + RT version it was created for. Entries are evicted FIFO.
+struct routing_cursor_cache {
+  struct entry {
+    std::uint64_t fingerprint_{0U};
+    std::uint64_t rt_version_{0U};
+    ::nigiri::interval<::nigiri::unixtime_t> interval_;
+    std::vector<::nigiri::routing::journey> journeys_;
+  };
+
+  explicit routing_cursor_cache(std::size_t max_entries);
+
+  std::string add(entry);
+
+  // Returns std::nullopt if the cursor is unknown, evicted or does not match
+  // the given query fingerprint and RT version.
+  std::optional<entry> get(std::string_view cursor,
+                           std::uint64_t fingerprint,
+                           std::uint64_t rt_version) const;
+
+private:
+  std::size_t max_entries_;
+  mutable std::mutex mutex_;
+  std::uint64_t next_id_{0U};
+  std::deque<std::uint64_t> order_;
+  std::unordered_map<std::uint64_t, entry> entries_;
+};
+
+}  // namespace motis::nigiri
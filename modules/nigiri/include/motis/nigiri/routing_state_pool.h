@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "nigiri/routing/raptor/raptor_state.h"
+#include "nigiri/routing/search.h"
+
+namespace motis::nigiri {
+
+// Bounded pool of routing states (search_state + raptor_state).
+// - max_states: maximum number of pooled states, 0=unlimited
+// - max_bytes: high-water mark, states above are trimmed on release, 0=off
+struct routing_state_pool {
+  struct states {
+    std::size_t size_in_bytes() const;
+
+    ::nigiri::routing::search_state search_state_;
+    ::nigiri::routing::raptor_state raptor_state_;
+  };
+
+  struct stats {
+    std::uint64_t max_states_{0U};
+    std::uint64_t max_bytes_{0U};
+    std::uint64_t created_{0U};
+    std::uint64_t in_use_{0U};
+    std::uint64_t peak_in_use_{0U};
+    std::uint64_t acquired_{0U};
+    std::uint64_t temporary_{0U};
+    std::uint64_t trimmed_{0U};
+    std::uint64_t idle_bytes_{0U};
+  };
+
+  struct handle {
+    handle(routing_state_pool&, std::unique_ptr<states>, bool pooled);
+    ~handle();
+
+    handle(handle const&) = delete;
+    handle& operator=(handle const&) = delete;
+    handle(handle&&) = delete;
+    handle& operator=(handle&&) = delete;
+
+    states* operator->() const { return states_.get(); }
+    states& operator*() const { return *states_; }
+
+  private:
+    routing_state_pool& pool_;
+    std::unique_ptr<states> states_;
+    bool pooled_;
+  };
+
+  explicit routing_state_pool(unsigned max_states = 0U,
+                              std::size_t max_bytes = 0U);
+
+  routing_state_pool(routing_state_pool const&) = delete;
+  routing_state_pool& operator=(routing_state_pool const&) = delete;
+  routing_state_pool(routing_state_pool&&) = delete;
+  routing_state_pool& operator=(routing_state_pool&&) = delete;
+  ~routing_state_pool() = default;
+
+  // Never blocks (called on ctx worker threads): if max_states states are
+  // in use, the search gets a temporary state that is freed on release.
+  handle acquire();
+
+  stats get_stats() const;
+
+private:
+  void release(std::unique_ptr<states>, bool pooled);
+
+  unsigned max_states_;
+  std::size_t max_bytes_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<states>> idle_;
+  stats stats_;
+};
+
+}  // namespace motis::nigiri
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "nigiri/timetable.h"
+
+#include "motis/core/common/atomic_shared_ptr.h"
+#include "motis/core/schedule/station_lookup.h"
+#include "motis/nigiri/tag_lookup.h"
+
+namespace motis::nigiri {
+
+// Timetable, tags and station lookup of one loaded timetable version.
+struct timetable_version {
+  ::nigiri::timetable const* tt_{nullptr};
+  tag_lookup const* tags_{nullptr};
+  station_lookup const* station_lookup_{nullptr};  // nullptr: lookup=false
+};
+
+// Shared data NIGIRI_TIMETABLE: a timetable reload stores a new version.
+// load() once per request and take all parts from it, parts of different
+// versions do not fit together (location and source indices).
+using shared_timetable = atomic_shared_ptr<timetable_version const>;
+
+}  // namespace motis::nigiri
@@ -11,20 +11,28 @@ namespace mm = motis::module;
 
 namespace motis::nigiri {
 
-motis::module::msg_ptr geo_station_lookup(station_lookup const& index,
-                                          motis::module::msg_ptr const& msg) {
+motis::module::msg_ptr geo_station_lookup(
+    station_lookup const& index, std::uint64_t const location_fingerprint,
+    motis::module::msg_ptr const& msg) {
   using motis::lookup::CreateLookupGeoStationRequest;
   using motis::lookup::CreateLookupGeoStationResponse;
   using motis::lookup::LookupGeoStationRequest;
   auto const req = motis_content(LookupGeoStationRequest, msg);
+  auto const stations =
+      index.in_radius({req->pos()->lat(), req->pos()->lng()},
+                      req->min_radius(), req->max_radius());
   mm::message_creator mc;
   mc.create_and_finish(
       MsgContent_LookupGeoStationResponse,
       CreateLookupGeoStationResponse(
-          mc, mc.CreateVector(utl::to_vec(
-                  index.in_radius({req->pos()->lat(), req->pos()->lng()},
-                                  req->min_radius(), req->max_radius()),
-                  [&](auto const idx) { return index.get(idx).to_fbs(mc); })))
+          mc,
+          mc.CreateVector(utl::to_vec(
+              stations,
+              [&](auto const idx) { return index.get(idx).to_fbs(mc); })),
+          mc.CreateVector(utl::to_vec(
+              stations,
+              [](auto const idx) { return static_cast<std::uint32_t>(idx); })),
+          location_fingerprint)
           .Union());
   return mm::make_msg(mc);
 }
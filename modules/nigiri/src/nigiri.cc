@@ -1,5 +1,6 @@
 #include "motis/nigiri/nigiri.h"
 
+#include <atomic>
 #include <fstream>
 #include <utility>
 
@@ -27,7 +28,9 @@
 #include "nigiri/rt/util.h"
 #include "nigiri/timetable.h"
 
+#include "motis/core/common/atomic_shared_ptr.h"
 #include "motis/core/common/logging.h"
+#include "motis/module/context/motis_spawn.h"
 #include "motis/module/event_collector.h"
 #include "motis/nigiri/geo_station_lookup.h"
 #include "motis/nigiri/get_station.h"
@@ -36,7 +39,10 @@
 #include "motis/nigiri/initial_permalink.h"
 #include "motis/nigiri/railviz.h"
 #include "motis/nigiri/routing.h"
+#include "motis/nigiri/routing_cursor.h"
+#include "motis/nigiri/routing_state_pool.h"
 #include "motis/nigiri/station_lookup.h"
+#include "motis/nigiri/timetable_version.h"
 #include "motis/nigiri/trip_to_connection.h"
 #include "motis/nigiri/unixtime_conv.h"
 #include "utl/parser/split.h"
@@ -72,6 +78,29 @@ struct schedule_info {
   std::time_t created_;
 };
 
+struct schedule_path {
+  std::string tag_;
+  fs::path path_;
+};
+
+// Everything that depends on one timetable version. Requests hold a
+// shared_ptr to the version they started with, a reload swaps in a new one.
+struct nigiri::timetable_data {
+  std::shared_ptr<n::rt_timetable> get_rtt() const { return rtt_.load(); }
+
+  std::shared_ptr<cista::wrapped<n::timetable>> tt_;
+  atomic_shared_ptr<n::rt_timetable> rtt_;
+  tag_lookup tags_;
+  std::vector<gtfsrt> gtfsrt_{};  // resolved with tags_
+  std::shared_ptr<station_lookup> station_lookup_;
+  std::unique_ptr<guesser> guesser_{};
+  std::unique_ptr<railviz> railviz_{};
+  std::string initial_permalink_;
+  std::vector<schedule_info> schedules_{};
+  cista::hash_t hash_{0U};
+  timetable_version version_{};  // published as shared data
+};
+
 struct nigiri::impl {
   impl() {
     loaders_.emplace_back(std::make_unique<n::loader::gtfs::gtfs_loader>());
@@ -85,44 +114,47 @@ struct nigiri::impl {
         std::make_unique<n::loader::hrd::hrd_5_20_avv_loader>());
   }
 
-  void update_rtt(std::shared_ptr<n::rt_timetable> rtt) {
-#if __cpp_lib_atomic_shared_ptr  // not yet supported on macos
-    rtt_.store(std::move(rtt));
-#else
-    auto lock = std::lock_guard{mutex_};
-    rtt_ = std::move(rtt);
-#endif
+  std::shared_ptr<timetable_data> get_data() const { return data_.load(); }
+
+  // Shared data holders get aliasing pointers: each one keeps the whole
+  // version alive, the previous version is freed with its last reader.
+  // Timetable, tags and station lookup are published together in one
+  // holder. The station lookup holder is self-contained for its users.
+  void update_data(std::shared_ptr<timetable_data> const& d) {
+    d->version_ = {.tt_ = d->tt_->get(),
+                   .tags_ = &d->tags_,
+                   .station_lookup_ = d->station_lookup_.get()};
+    data_.store(d);
+    version_->store(std::shared_ptr<timetable_version const>{d, &d->version_});
+    if (d->station_lookup_ != nullptr) {
+      station_lookup_->store(
+          std::shared_ptr<station_lookup const>{d, d->station_lookup_.get()});
+    }
+    ++rtt_version_;
   }
 
-  std::shared_ptr<n::rt_timetable> get_rtt() {
-#if __cpp_lib_atomic_shared_ptr  // not yet supported on macos
-    return rtt_.load();
-#else
-    std::shared_ptr<n::rt_timetable> copy;
-    {
-      auto const lock = std::lock_guard{mutex_};
-      copy = rtt_;
+  void update_rtt(timetable_data& d, std::shared_ptr<n::rt_timetable> rtt) {
+    d.rtt_.store(rtt);
+    ++rtt_version_;
+    if (d.railviz_ != nullptr) {
+      d.railviz_->update(rtt);
     }
-    return copy;
-#endif
   }
 
   std::vector<std::unique_ptr<n::loader::loader_interface>> loaders_{};
-  std::shared_ptr<cista::wrapped<n::timetable>> tt_;
-#if __cpp_lib_atomic_shared_ptr  // not yet supported on macos
-  std::atomic<std::shared_ptr<n::rt_timetable>> rtt_;
-#else
-  std::shared_ptr<n::rt_timetable> rtt_;
-  std::mutex mutex_;
-#endif
-  tag_lookup tags_;
-  std::shared_ptr<station_lookup> station_lookup_;
-  std::vector<gtfsrt> gtfsrt_{};
-  std::unique_ptr<guesser> guesser_{};
-  std::unique_ptr<railviz> railviz_{};
-  std::string initial_permalink_;
-  std::vector<schedule_info> schedules_{};
-  cista::hash_t hash_{0U};
+  std::vector<schedule_path> schedule_paths_{};
+  atomic_shared_ptr<timetable_data> data_;
+  // Published as shared data, follow data_.
+  std::shared_ptr<shared_timetable> version_{
+      std::make_shared<shared_timetable>()};
+  std::shared_ptr<shared_station_lookup> station_lookup_{
+      std::make_shared<shared_station_lookup>()};
+  // Incremented on RT updates and timetable swaps.
+  // Read before get_data(): a stale version only invalidates cursors.
+  std::atomic_uint64_t rtt_version_{0U};
+  std::atomic_bool reloading_{false};
+  std::unique_ptr<routing_state_pool> state_pool_{};
+  std::unique_ptr<routing_cursor_cache> cursors_{};
 };
 
 nigiri::nigiri() : module("Next Generation Routing", "nigiri") {
@@ -151,93 +183,108 @@ nigiri::nigiri() : module("Next Generation Routing", "nigiri") {
   param(gtfsrt_incremental_, "gtfsrt_incremental",
         "true=incremental updates, false=forget all prev. RT updates");
   param(debug_, "debug", "write protobuf JSON files for debugging");
+  param(routing_max_states_, "routing_max_states",
+        "max. number of pooled routing states, searches beyond that use "
+        "a temporary state, 0=unlimited");
+  param(routing_max_state_mb_, "routing_max_state_mb",
+        "trim routing states larger than this after a query, 0=never");
+  param(routing_cursor_cache_size_, "routing_cursor_cache_size",
+        "number of searches kept for earlier/later pagination, 0=off");
+  param(reload_, "reload",
+        "provide /nigiri/reload (old and new timetable in memory at once)");
 }
 
 nigiri::~nigiri() = default;
 
 void nigiri::init(motis::module::registry& reg) {
-  if (!gtfsrt_paths_.empty()) {
-    auto const rtt_copy = std::make_shared<n::rt_timetable>(*impl_->get_rtt());
-    auto statistics = std::vector<n::rt::statistics>{};
-    for (auto const& p : gtfsrt_paths_) {
-      auto const [tag, path] = utl::split<'|', utl::cstr, utl::cstr>(p);
-      if (path.empty()) {
-        throw utl::fail("bad GTFS-RT path: {} (required: tag|path/to/file)", p);
-      }
-      auto const src = impl_->tags_.get_src(tag.to_str() + '_');
-      if (src == n::source_idx_t::invalid()) {
-        throw utl::fail("bad GTFS-RT path: tag {} not found", tag.view());
-      }
-      auto const file =
-          cista::mmap{path.c_str(), cista::mmap::protection::READ};
-      auto stats = n::rt::statistics{};
-      try {
-        stats = n::rt::gtfsrt_update_buf(**impl_->tt_, *rtt_copy, src,
-                                         tag.view(), file.view());
-      } catch (std::exception const& e) {
-        stats.parser_error_ = true;
-        LOG(logging::error)
-            << "GTFS-RT update error (tag=" << tag.view() << ") " << e.what();
-      } catch (...) {
-        stats.parser_error_ = true;
-        LOG(logging::error)
-            << "Unknown GTFS-RT update error (tag= " << tag.view() << ")";
-      }
-      statistics.emplace_back(stats);
-    }
-    impl_->update_rtt(rtt_copy);
-    impl_->railviz_->update(rtt_copy);
-    for (auto const [path, stats] : utl::zip(gtfsrt_paths_, statistics)) {
-      LOG(logging::info) << "init " << path << ": "
-                         << stats.total_entities_success_ << "/"
-                         << stats.total_entities_ << " ("
-                         << static_cast<double>(stats.total_entities_success_) /
-                                stats.total_entities_ * 100
-                         << "%)";
-    }
-  }
+  apply_gtfsrt_paths(*impl_->get_data());
 
   reg.register_op("/nigiri",
                   [&](mm::msg_ptr const& msg) {
-                    return route(impl_->tags_, **impl_->tt_,
-                                 impl_->get_rtt().get(), msg);
+                    auto const rtt_version = impl_->rtt_version_.load();
+                    auto const d = impl_->get_data();
+                    return route(d->tags_, **d->tt_, d->get_rtt().get(), msg,
+                                 n::profile_idx_t{0U},
+                                 impl_->state_pool_.get(),
+                                 impl_->cursors_.get(), rtt_version,
+                                 d->hash_);
                   },
                   {});
 
-  if (!impl_->tt_->get()->profiles_.empty()) {
-    for (auto const& [prf_name, prf_idx] : impl_->tt_->get()->profiles_) {
-      reg.register_op(fmt::format("/nigiri/{}", prf_name),
-                      [&, p = prf_idx, this](mm::msg_ptr const& msg) {
-                        return route(impl_->tags_, **impl_->tt_,
-                                     impl_->get_rtt().get(), msg, p);
-                      },
-                      {});
+  if (!impl_->get_data()->tt_->get()->profiles_.empty()) {
+    for (auto const& [prf_name, prf_idx] :
+         impl_->get_data()->tt_->get()->profiles_) {
+      reg.register_op(
+          fmt::format("/nigiri/{}", prf_name),
+          [&, name = std::string{std::string_view{prf_name}},
+           this](mm::msg_ptr const& msg) {
+            auto const rtt_version = impl_->rtt_version_.load();
+            auto const d = impl_->get_data();
+            auto const& profiles = (*d->tt_)->profiles_;
+            auto const it = utl::find_if(profiles, [&](auto&& p) {
+              return std::string_view{p.first} == name;
+            });
+            utl::verify(it != end(profiles),
+                        "profile {} not found in current timetable", name);
+            return route(d->tags_, **d->tt_, d->get_rtt().get(), msg,
+                         it->second, impl_->state_pool_.get(),
+                         impl_->cursors_.get(), rtt_version, d->hash_);
+          },
+          {});
     }
   }
 
+  // Responds when the reload has started, loading runs as a job.
+  // Off by default: the old and the new version are in memory at once.
+  if (reload_) {
+    reg.register_op(
+        "/nigiri/reload",
+        [&](mm::msg_ptr const&) {
+          utl::verify(!impl_->reloading_.exchange(true),
+                      "nigiri timetable reload already running");
+          mm::spawn_job_void([this]() {
+            try {
+              reload();
+            } catch (std::exception const& e) {
+              LOG(logging::error)
+                  << "nigiri timetable reload failed: " << e.what();
+            } catch (...) {
+              LOG(logging::error) << "nigiri timetable reload failed";
+            }
+            impl_->reloading_ = false;
+          });
+          return mm::make_success_msg();
+        },
+        {});
+  }
+
   if (lookup_) {
     reg.register_op("/lookup/geo_station",
                     [&](mm::msg_ptr const& msg) {
-                      return geo_station_lookup(*impl_->station_lookup_, msg);
+                      auto const d = impl_->get_data();
+                      return geo_station_lookup(*d->station_lookup_, d->hash_,
+                                                msg);
                     },
                     {});
     reg.register_op("/lookup/station_location",
                     [&](mm::msg_ptr const& msg) {
-                      return station_location(impl_->tags_, **impl_->tt_, msg);
+                      auto const d = impl_->get_data();
+                      return station_location(d->tags_, **d->tt_, msg);
                     },
                     {});
     reg.register_op("/lookup/schedule_info",
                     [&](mm::msg_ptr const&) {
-                      auto const& tt = (**impl_->tt_);
+                      auto const d = impl_->get_data();
+                      auto const& tt = (**d->tt_);
                       mm::message_creator b;
                       b.create_and_finish(
                           MsgContent_LookupScheduleInfoResponse,
                           lookup::CreateLookupScheduleInfoResponse(
-                              b, b.CreateString(fmt::to_string(impl_->hash_)),
+                              b, b.CreateString(fmt::to_string(d->hash_)),
                               to_motis_unixtime(tt.external_interval().from_),
                               to_motis_unixtime(tt.external_interval().to_),
                               b.CreateVector(utl::to_vec(
-                                  impl_->schedules_,
+                                  d->schedules_,
                                   [&](auto const& s) { return s.to_fbs(b); })))
                               .Union());
                       return make_msg(b);
@@ -246,20 +293,22 @@ void nigiri::init(motis::module::registry& reg) {
   }
 
   if (guesser_) {
-    reg.register_op(
-        "/guesser",
-        [&](mm::msg_ptr const& msg) { return impl_->guesser_->guess(msg); },
-        {});
+    reg.register_op("/guesser",
+                    [&](mm::msg_ptr const& msg) {
+                      return impl_->get_data()->guesser_->guess(msg);
+                    },
+                    {});
   }
 
   if (railviz_) {
     reg.register_op("/railviz/map_config",
                     [this](mm::msg_ptr const&) {
+                      auto const d = impl_->get_data();
                       mm::message_creator mc;
                       mc.create_and_finish(
                           MsgContent_RailVizMapConfigResponse,
                           motis::railviz::CreateRailVizMapConfigResponse(
-                              mc, mc.CreateString(impl_->initial_permalink_),
+                              mc, mc.CreateString(d->initial_permalink_),
                               mc.CreateString(""))
                               .Union());
                       return make_msg(mc);
@@ -267,17 +316,19 @@ void nigiri::init(motis::module::registry& reg) {
                     {});
     reg.register_op("/railviz/get_trains",
                     [&](mm::msg_ptr const& msg) {
-                      return impl_->railviz_->get_trains(msg);
+                      return impl_->get_data()->railviz_->get_trains(msg);
+                    },
+                    {});
+    reg.register_op("/railviz/get_trips",
+                    [&](mm::msg_ptr const& msg) {
+                      return impl_->get_data()->railviz_->get_trips(msg);
                     },
                     {});
-    reg.register_op(
-        "/railviz/get_trips",
-        [&](mm::msg_ptr const& msg) { return impl_->railviz_->get_trips(msg); },
-        {});
     reg.register_op("/railviz/get_station",
                     [&](mm::msg_ptr const& msg) {
-                      return get_station(impl_->tags_, **impl_->tt_,
-                                         impl_->get_rtt().get(), msg);
+                      auto const d = impl_->get_data();
+                      return get_station(d->tags_, **d->tt_,
+                                         d->get_rtt().get(), msg);
                     },
                     {});
   }
@@ -285,8 +336,9 @@ void nigiri::init(motis::module::registry& reg) {
   if (routing_) {
     reg.register_op("/trip_to_connection",
                     [&](mm::msg_ptr const& msg) {
-                      return trip_to_connection(impl_->tags_, **impl_->tt_,
-                                                impl_->get_rtt().get(), msg);
+                      auto const d = impl_->get_data();
+                      return trip_to_connection(d->tags_, **d->tt_,
+                                                d->get_rtt().get(), msg);
                     },
                     {});
   }
@@ -294,33 +346,95 @@ void nigiri::init(motis::module::registry& reg) {
   reg.subscribe("/init", [&]() { register_gtfsrt_timer(*shared_data_); }, {});
 }
 
+void nigiri::reload() {
+  LOG(logging::info) << "nigiri timetable reload: loading";
+  auto const d = load_timetable();
+  if (d->hash_ == impl_->get_data()->hash_) {
+    LOG(logging::info) << "nigiri timetable reload: unchanged (hash="
+                       << d->hash_ << ")";
+    return;
+  }
+
+  // Replay RT feeds onto the new version before it becomes visible.
+  // RT updates of the old version that run concurrently are not carried
+  // over: they are contained in the next regular GTFS-RT update.
+  apply_gtfsrt_paths(*d);
+  if (!d->gtfsrt_.empty()) {
+    update_gtfsrt(*d);
+  }
+
+  impl_->update_data(d);
+  LOG(logging::info) << "nigiri timetable reload: swapped to hash="
+                     << d->hash_;
+}
+
+void nigiri::apply_gtfsrt_paths(timetable_data& d) const {
+  if (gtfsrt_paths_.empty()) {
+    return;
+  }
+
+  auto const rtt_copy = std::make_shared<n::rt_timetable>(*d.get_rtt());
+  auto statistics = std::vector<n::rt::statistics>{};
+  for (auto const& p : gtfsrt_paths_) {
+    auto const [tag, path] = utl::split<'|', utl::cstr, utl::cstr>(p);
+    if (path.empty()) {
+      throw utl::fail("bad GTFS-RT path: {} (required: tag|path/to/file)", p);
+    }
+    auto const src = d.tags_.get_src(tag.to_str() + '_');
+    if (src == n::source_idx_t::invalid()) {
+      throw utl::fail("bad GTFS-RT path: tag {} not found", tag.view());
+    }
+    auto const file = cista::mmap{path.c_str(), cista::mmap::protection::READ};
+    auto stats = n::rt::statistics{};
+    try {
+      stats = n::rt::gtfsrt_update_buf(**d.tt_, *rtt_copy, src, tag.view(),
+                                       file.view());
+    } catch (std::exception const& e) {
+      stats.parser_error_ = true;
+      LOG(logging::error) << "GTFS-RT update error (tag=" << tag.view() << ") "
+                          << e.what();
+    } catch (...) {
+      stats.parser_error_ = true;
+      LOG(logging::error) << "Unknown GTFS-RT update error (tag= "
+                          << tag.view() << ")";
+    }
+    statistics.emplace_back(stats);
+  }
+  impl_->update_rtt(d, rtt_copy);
+  for (auto const [path, stats] : utl::zip(gtfsrt_paths_, statistics)) {
+    LOG(logging::info) << "init " << path << ": "
+                       << stats.total_entities_success_ << "/"
+                       << stats.total_entities_ << " ("
+                       << static_cast<double>(stats.total_entities_success_) /
+                              stats.total_entities_ * 100
+                       << "%)";
+  }
+}
+
 void nigiri::register_gtfsrt_timer(mm::dispatcher& d) {
   if (!gtfsrt_urls_.empty()) {
-    impl_->gtfsrt_ = utl::to_vec(gtfsrt_urls_, [&](auto&& config) {
-      return gtfsrt{impl_->tags_, config};
-    });
     d.register_timer("RIS GTFS-RT Update",
                      boost::posix_time::seconds{gtfsrt_update_interval_sec_},
-                     [&]() { update_gtfsrt(); }, {});
-    update_gtfsrt();
+                     [&]() { update_gtfsrt(*impl_->get_data()); }, {});
+    update_gtfsrt(*impl_->get_data());
   }
 }
 
-void nigiri::update_gtfsrt() {
+void nigiri::update_gtfsrt(timetable_data& d) const {
   LOG(logging::info) << "Starting GTFS-RT update: fetch URLs";
 
   auto const futures = utl::to_vec(
-      impl_->gtfsrt_, [](auto& endpoint) { return endpoint.fetch(); });
+      d.gtfsrt_, [](auto& endpoint) { return endpoint.fetch(); });
   auto const today = std::chrono::time_point_cast<date::days>(
       std::chrono::system_clock::now());
-  auto const rtt = gtfsrt_incremental_
-                       ? std::make_shared<n::rt_timetable>(
-                             n::rt_timetable{*impl_->get_rtt()})
-                       : std::make_shared<n::rt_timetable>(
-                             n::rt::create_rt_timetable(**impl_->tt_, today));
+  auto const rtt =
+      gtfsrt_incremental_
+          ? std::make_shared<n::rt_timetable>(n::rt_timetable{*d.get_rtt()})
+          : std::make_shared<n::rt_timetable>(
+                n::rt::create_rt_timetable(**d.tt_, today));
   auto statistics = std::vector<n::rt::statistics>{};
-  for (auto const [f, endpoint] : utl::zip(futures, impl_->gtfsrt_)) {
-    auto const tag = impl_->tags_.get_tag_clean(endpoint.src());
+  for (auto const [f, endpoint] : utl::zip(futures, d.gtfsrt_)) {
+    auto const tag = d.tags_.get_tag_clean(endpoint.src());
     auto stats = n::rt::statistics{};
     try {
       auto const& body = f->val().body;
@@ -328,7 +442,7 @@ void nigiri::update_gtfsrt() {
         std::ofstream{fmt::format("{}/{}.json", get_data_directory(), tag)}
             << n::rt::protobuf_to_json(body);
       }
-      stats = n::rt::gtfsrt_update_buf(**impl_->tt_, *rtt, endpoint.src(), tag,
+      stats = n::rt::gtfsrt_update_buf(**d.tt_, *rtt, endpoint.src(), tag,
                                        body);
     } catch (std::exception const& e) {
       stats.parser_error_ = true;
@@ -341,17 +455,167 @@ void nigiri::update_gtfsrt() {
     }
     statistics.emplace_back(stats);
   }
-  impl_->update_rtt(rtt);
-  impl_->railviz_->update(rtt);
+  impl_->update_rtt(d, rtt);
 
-  for (auto const [endpoint, stats] : utl::zip(impl_->gtfsrt_, statistics)) {
-    LOG(logging::info) << impl_->tags_.get_tag_clean(endpoint.src()) << ": "
+  for (auto const [endpoint, stats] : utl::zip(d.gtfsrt_, statistics)) {
+    LOG(logging::info) << d.tags_.get_tag_clean(endpoint.src()) << ": "
                        << stats;
   }
 }
 
+std::shared_ptr<nigiri::timetable_data> nigiri::load_timetable() const {
+  auto d = std::make_shared<timetable_data>();
+
+  date::sys_days begin;
+  auto const today = std::chrono::time_point_cast<date::days>(
+      std::chrono::system_clock::now());
+  if (first_day_ == "TODAY") {
+    begin = today;
+  } else {
+    std::stringstream ss;
+    ss << first_day_;
+    ss >> date::parse("%F", begin);
+  }
+
+  auto const interval = n::interval<date::sys_days>{
+      begin, begin + std::chrono::days{num_days_}};
+  LOG(logging::info) << "interval: " << interval.from_ << " - "
+                     << interval.to_;
+
+  auto h = cista::hash_combine(cista::BASE_HASH,
+                               interval.from_.time_since_epoch().count(),  //
+                               interval.to_.time_since_epoch().count(),  //
+                               adjust_footpaths_, link_stop_distance_,
+                               cista::hash(default_timezone_));
+
+  auto datasets =
+      std::vector<std::tuple<n::source_idx_t,
+                             decltype(impl_->loaders_)::const_iterator,
+                             std::unique_ptr<n::loader::dir>>>{};
+  auto i = 0U;
+  for (auto const& p : impl_->schedule_paths_) {
+    auto dir = n::loader::make_dir(p.path_);
+    auto const c = utl::find_if(
+        impl_->loaders_, [&](auto&& c) { return c->applicable(*dir); });
+    utl::verify(c != end(impl_->loaders_), "no loader applicable to {}",
+                p.path_);
+    auto const hash = (*c)->hash(*dir);
+    h = cista::hash_combine(h, hash);
+
+    auto const src = n::source_idx_t{i++};
+    datasets.emplace_back(src, c, std::move(dir));
+    d->tags_.add(src, p.tag_ + "_");
+
+    d->schedules_.emplace_back(p.tag_, hash, p.path_);
+  }
+  utl::verify(!datasets.empty(), "no schedule datasets found");
+  d->gtfsrt_ = utl::to_vec(gtfsrt_urls_, [&](auto&& config) {
+    return gtfsrt{d->tags_, config};
+  });
+
+  auto const data_dir = get_data_directory() / "nigiri";
+  auto const dump_file_path = data_dir / fmt::to_string(h);
+
+  auto loaded = false;
+  for (auto i = 0U; i != 2; ++i) {
+    // Parse from input files and write memory image.
+    if (no_cache_ || !fs::is_regular_file(dump_file_path)) {
+      d->tt_ = std::make_shared<cista::wrapped<n::timetable>>(
+          cista::raw::make_unique<n::timetable>());
+
+      (*d->tt_)->date_range_ = interval;
+      n::loader::register_special_stations(**d->tt_);
+
+      for (auto const& [src, loader, dir] : datasets) {
+        auto progress_tracker = utl::activate_progress_tracker(
+            fmt::format("{}nigiri", d->tags_.get_tag(src)));
+
+        LOG(logging::info) << "loading nigiri timetable with configuration "
+                           << (*loader)->name();
+
+        try {
+          (*loader)->load({.link_stop_distance_ = link_stop_distance_,
+                           .default_tz_ = default_timezone_},
+                          src, *dir, **d->tt_);
+          progress_tracker->status("FINISHED").show_progress(false);
+        } catch (std::exception const& e) {
+          progress_tracker->status(fmt::format("ERROR: {}", e.what()))
+              .show_progress(false);
+          throw;
+        } catch (...) {
+          progress_tracker->status("ERROR: UNKNOWN EXCEPTION")
+              .show_progress(false);
+          throw;
+        }
+      }
+
+      n::loader::finalize(**d->tt_, adjust_footpaths_, merge_duplicates_,
+                          max_footpath_length_);
+
+      if (no_cache_) {
+        loaded = true;
+        break;
+      } else {
+        // Write to disk, next step: read from disk.
+        std::filesystem::create_directories(data_dir);
+        (*d->tt_)->write(dump_file_path);
+      }
+    }
+
+    // Read memory image from disk.
+    if (!no_cache_) {
+      try {
+        d->tt_ = std::make_shared<cista::wrapped<n::timetable>>(
+            n::timetable::read(cista::memory_holder{
+                cista::file{dump_file_path.string().c_str(), "r"}
+                    .content()}));
+        (**d->tt_).locations_.resolve_timezones();
+        loaded = true;
+        break;
+      } catch (std::exception const& e) {
+        LOG(logging::error)
+            << "cannot read cached timetable image: " << e.what();
+        std::filesystem::remove(dump_file_path);
+        continue;
+      }
+    }
+  }
+
+  utl::verify(loaded, "loading failed");
+  d->hash_ = h;
+
+  LOG(logging::info) << "nigiri timetable: stations="
+                     << (*d->tt_)->locations_.names_.size()
+                     << ", trips=" << (*d->tt_)->trip_debug_.size() << "\n";
+
+  if (!gtfsrt_urls_.empty() || !gtfsrt_paths_.empty()) {
+    d->rtt_.store(std::make_shared<n::rt_timetable>(
+        n::rt::create_rt_timetable(**d->tt_, today)));
+  }
+
+  if (lookup_) {
+    d->station_lookup_ =
+        std::make_shared<nigiri_station_lookup>(d->tags_, **d->tt_);
+  }
+
+  if (guesser_) {
+    d->guesser_ = std::make_unique<guesser>(d->tags_, (**d->tt_));
+  }
+
+  if (railviz_) {
+    d->initial_permalink_ = get_initial_permalink(**d->tt_);
+    d->railviz_ = std::make_unique<railviz>(d->tags_, (**d->tt_));
+  }
+
+  return d;
+}
+
 void nigiri::import(motis::module::import_dispatcher& reg) {
   impl_ = std::make_unique<impl>();
+  impl_->state_pool_ = std::make_unique<routing_state_pool>(
+      routing_max_states_, routing_max_state_mb_ * 1024U * 1024U);
+  impl_->cursors_ =
+      std::make_unique<routing_cursor_cache>(routing_cursor_cache_size_);
   std::make_shared<mm::event_collector>(
       get_data_directory().generic_string(), "nigiri", reg,
       [this](mm::event_collector::dependencies_map_t const& dependencies,
@@ -368,167 +632,31 @@ void nigiri::import(motis::module::import_dispatcher& reg) {
                         }),
             "all schedules require a name tag, even with only one schedule");
 
-        date::sys_days begin;
-        auto const today = std::chrono::time_point_cast<date::days>(
-            std::chrono::system_clock::now());
-        if (first_day_ == "TODAY") {
-          begin = today;
-        } else {
-          std::stringstream ss;
-          ss << first_day_;
-          ss >> date::parse("%F", begin);
-        }
-
-        auto const interval = n::interval<date::sys_days>{
-            begin, begin + std::chrono::days{num_days_}};
-        LOG(logging::info) << "interval: " << interval.from_ << " - "
-                           << interval.to_;
-
-        auto h =
-            cista::hash_combine(cista::BASE_HASH,
-                                interval.from_.time_since_epoch().count(),  //
-                                interval.to_.time_since_epoch().count(),  //
-                                adjust_footpaths_, link_stop_distance_,
-                                cista::hash(default_timezone_));
-
-        auto datasets =
-            std::vector<std::tuple<n::source_idx_t,
-                                   decltype(impl_->loaders_)::const_iterator,
-                                   std::unique_ptr<n::loader::dir>>>{};
-        auto i = 0U;
         for (auto const p : *motis_content(FileEvent, msg)->paths()) {
-          if (p->tag()->str() != "schedule") {
-            continue;
-          }
-          auto const path = fs::path{p->path()->str()};
-          auto d = n::loader::make_dir(path);
-          auto const c = utl::find_if(
-              impl_->loaders_, [&](auto&& c) { return c->applicable(*d); });
-          utl::verify(c != end(impl_->loaders_), "no loader applicable to {}",
-                      path);
-          auto const hash = (*c)->hash(*d);
-          h = cista::hash_combine(h, hash);
-
-          auto const src = n::source_idx_t{i++};
-          datasets.emplace_back(src, c, std::move(d));
-          impl_->tags_.add(src, p->options()->str() + "_");
-
-          impl_->schedules_.emplace_back(p->options()->str(), hash, path);
-        }
-        utl::verify(!datasets.empty(), "no schedule datasets found");
-
-        auto const data_dir = get_data_directory() / "nigiri";
-        auto const dump_file_path = data_dir / fmt::to_string(h);
-
-        auto loaded = false;
-        for (auto i = 0U; i != 2; ++i) {
-          // Parse from input files and write memory image.
-          if (no_cache_ || !fs::is_regular_file(dump_file_path)) {
-            impl_->tt_ = std::make_shared<cista::wrapped<n::timetable>>(
-                cista::raw::make_unique<n::timetable>());
-
-            (*impl_->tt_)->date_range_ = interval;
-            n::loader::register_special_stations(**impl_->tt_);
-
-            for (auto const& [src, loader, dir] : datasets) {
-              auto progress_tracker = utl::activate_progress_tracker(
-                  fmt::format("{}nigiri", impl_->tags_.get_tag(src)));
-
-              LOG(logging::info)
-                  << "loading nigiri timetable with configuration "
-                  << (*loader)->name();
-
-              try {
-                (*loader)->load({.link_stop_distance_ = link_stop_distance_,
-                                 .default_tz_ = default_timezone_},
-                                src, *dir, **impl_->tt_);
-                progress_tracker->status("FINISHED").show_progress(false);
-              } catch (std::exception const& e) {
-                progress_tracker->status(fmt::format("ERROR: {}", e.what()))
-                    .show_progress(false);
-                throw;
-              } catch (...) {
-                progress_tracker->status("ERROR: UNKNOWN EXCEPTION")
-                    .show_progress(false);
-                throw;
-              }
-            }
-
-            n::loader::finalize(**impl_->tt_, adjust_footpaths_,
-                                merge_duplicates_, max_footpath_length_);
-
-            if (no_cache_) {
-              loaded = true;
-              break;
-            } else {
-              // Write to disk, next step: read from disk.
-              std::filesystem::create_directories(data_dir);
-              (*impl_->tt_)->write(dump_file_path);
-            }
-          }
-
-          // Read memory image from disk.
-          impl_->hash_ = h;
-          if (!no_cache_) {
-            try {
-              impl_->tt_ = std::make_shared<cista::wrapped<n::timetable>>(
-                  n::timetable::read(cista::memory_holder{
-                      cista::file{dump_file_path.string().c_str(), "r"}
-                          .content()}));
-              (**impl_->tt_).locations_.resolve_timezones();
-              if (!gtfsrt_urls_.empty() || !gtfsrt_paths_.empty()) {
-                impl_->update_rtt(std::make_shared<n::rt_timetable>(
-                    n::rt::create_rt_timetable(**impl_->tt_, today)));
-              }
-              loaded = true;
-              break;
-            } catch (std::exception const& e) {
-              LOG(logging::error)
-                  << "cannot read cached timetable image: " << e.what();
-              std::filesystem::remove(dump_file_path);
-              continue;
-            }
+          if (p->tag()->str() == "schedule") {
+            impl_->schedule_paths_.emplace_back(
+                schedule_path{p->options()->str(), fs::path{p->path()->str()}});
           }
         }
 
-        utl::verify(loaded, "loading failed");
-
-        LOG(logging::info) << "nigiri timetable: stations="
-                           << (*impl_->tt_)->locations_.names_.size()
-                           << ", trips=" << (*impl_->tt_)->trip_debug_.size()
-                           << "\n";
+        auto const d = load_timetable();
+        impl_->update_data(d);
 
+        // Holders: users load() the current version per request.
         if (lookup_) {
-          impl_->station_lookup_ = std::make_shared<nigiri_station_lookup>(
-              impl_->tags_, **impl_->tt_);
-          auto copy = impl_->station_lookup_;
           add_shared_data(to_res_id(mm::global_res_id::STATION_LOOKUP),
-                          std::move(copy));
-        }
-
-        if (guesser_) {
-          impl_->guesser_ =
-              std::make_unique<guesser>(impl_->tags_, (**impl_->tt_));
-        }
-
-        if (railviz_) {
-          impl_->initial_permalink_ = get_initial_permalink(**impl_->tt_);
-          impl_->railviz_ =
-              std::make_unique<railviz>(impl_->tags_, (**impl_->tt_));
+                          std::shared_ptr{impl_->station_lookup_});
         }
-
         add_shared_data(to_res_id(mm::global_res_id::NIGIRI_TIMETABLE),
-                        impl_->tt_->get());
-        add_shared_data(to_res_id(mm::global_res_id::NIGIRI_TAGS),
-                        &impl_->tags_);
+                        std::shared_ptr{impl_->version_});
 
         import_successful_ = true;
         {
           mm::message_creator fbb;
           fbb.create_and_finish(
               MsgContent_NigiriEvent,
-              motis::import::CreateNigiriEvent(fbb, h).Union(), "/import",
-              DestinationType_Topic);
+              motis::import::CreateNigiriEvent(fbb, d->hash_).Union(),
+              "/import", DestinationType_Topic);
           publish(make_msg(fbb));
         }
         {
@@ -1,7 +1,14 @@
 #include "motis/nigiri/routing.h"
 
-#include "boost/thread/tss.hpp"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
 
+#include "cista/hash.h"
+
+#include "fmt/core.h"
+
+#include "utl/enumerate.h"
 #include "utl/helpers/algorithm.h"
 #include "utl/pipes.h"
 #include "utl/to_vec.h"
@@ -17,67 +24,146 @@
 #include "motis/core/common/timing.h"
 #include "motis/core/access/error.h"
 #include "motis/core/journey/journeys_to_message.h"
+#include "motis/module/context/motis_parallel_for.h"
 #include "motis/nigiri/location.h"
 #include "motis/nigiri/nigiri_to_motis_journey.h"
+#include "motis/nigiri/routing_cursor.h"
+#include "motis/nigiri/routing_state_pool.h"
 #include "motis/nigiri/unixtime_conv.h"
 
 namespace n = ::nigiri;
 namespace mm = motis::module;
 namespace fbs = flatbuffers;
 
-// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
-boost::thread_specific_ptr<n::routing::search_state> search_state;
+namespace motis::nigiri {
 
-// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
-boost::thread_specific_ptr<n::routing::raptor_state> raptor_state;
+routing_state_pool& default_routing_state_pool() {
+  static auto pool = routing_state_pool{};
+  return pool;
+}
 
-namespace motis::nigiri {
+struct search_result {
+  std::string profile_;
+  n::pareto_set<n::routing::journey> journeys_;
+  n::interval<n::unixtime_t> interval_;
+  n::routing::search_stats search_stats_;
+  n::routing::raptor_stats raptor_stats_;
+  std::uint64_t routing_time_{0U};
+  unsigned n_searches_{0U};
+};
 
-mm::msg_ptr to_routing_response(
-    n::timetable const& tt, n::rt_timetable const* rtt, tag_lookup const& tags,
-    n::pareto_set<n::routing::journey> const* journeys,
-    n::interval<n::unixtime_t> search_interval,
-    n::routing::search_stats const& search_stats,
-    n::routing::raptor_stats const& raptor_stats,
-    std::uint64_t const routing_time) {
+// Counters are summed over all searches (via segments, pagination slices).
+// fastest_direct is taken from the first search which covers the start.
+void add_stats(search_result& r, n::routing::search_stats const& s,
+               n::routing::raptor_stats const& a) {
+  if (r.n_searches_++ == 0U) {
+    r.search_stats_ = s;
+    r.raptor_stats_ = a;
+    return;
+  }
+  r.search_stats_.lb_time_ += s.lb_time_;
+  r.raptor_stats_.n_footpaths_visited_ += a.n_footpaths_visited_;
+  r.raptor_stats_.n_routes_visited_ += a.n_routes_visited_;
+  r.raptor_stats_.n_earliest_trip_calls_ += a.n_earliest_trip_calls_;
+  r.raptor_stats_.n_earliest_arrival_updated_by_route_ +=
+      a.n_earliest_arrival_updated_by_route_;
+  r.raptor_stats_.n_earliest_arrival_updated_by_footpath_ +=
+      a.n_earliest_arrival_updated_by_footpath_;
+  r.raptor_stats_.fp_update_prevented_by_lower_bound_ +=
+      a.fp_update_prevented_by_lower_bound_;
+  r.raptor_stats_.route_update_prevented_by_lower_bound_ +=
+      a.route_update_prevented_by_lower_bound_;
+}
+
+mm::msg_ptr to_routing_response(n::timetable const& tt,
+                                n::rt_timetable const* rtt,
+                                tag_lookup const& tags,
+                                std::vector<search_result> const& results,
+                                routing_state_pool::stats const& pool_stats,
+                                std::string_view cursor,
+                                bool const is_multi_profile) {
   mm::message_creator fbb;
   MOTIS_START_TIMING(conversion);
-  auto const connections =
-      utl::to_vec(*journeys, [&](n::routing::journey const& j) {
-        return to_connection(fbb, nigiri_to_motis_journey(tt, rtt, tags, j));
-      });
+  auto connections = std::vector<fbs::Offset<Connection>>{};
+  auto connection_profiles = std::vector<fbs::Offset<fbs::String>>{};
+  for (auto const& r : results) {
+    auto const profile = fbb.CreateSharedString(r.profile_);
+    for (auto const& j : r.journeys_) {
+      connections.emplace_back(
+          to_connection(fbb, nigiri_to_motis_journey(tt, rtt, tags, j)));
+      if (is_multi_profile) {
+        connection_profiles.emplace_back(profile);
+      }
+    }
+  }
   MOTIS_STOP_TIMING(conversion);
 
-  auto entries = std::vector<fbs::Offset<StatisticsEntry>>{
-      CreateStatisticsEntry(fbb, fbb.CreateString("routing_time_ms"),
-                            routing_time),
-      CreateStatisticsEntry(fbb, fbb.CreateString("lower_bounds_time_ms"),
-                            search_stats.lb_time_),
-      CreateStatisticsEntry(fbb, fbb.CreateString("fastest_direct"),
-                            search_stats.fastest_direct_),
-      CreateStatisticsEntry(fbb, fbb.CreateString("footpaths_visited"),
-                            raptor_stats.n_footpaths_visited_),
-      CreateStatisticsEntry(fbb, fbb.CreateString("routes_visited"),
-                            raptor_stats.n_routes_visited_),
-      CreateStatisticsEntry(fbb, fbb.CreateString("earliest_trip_calls"),
-                            raptor_stats.n_earliest_trip_calls_),
-      CreateStatisticsEntry(
-          fbb, fbb.CreateString("earliest_arrival_updated_by_route"),
-          raptor_stats.n_earliest_arrival_updated_by_route_),
-      CreateStatisticsEntry(
-          fbb, fbb.CreateString("earliest_arrival_updated_by_footpath"),
-          raptor_stats.n_earliest_arrival_updated_by_footpath_),
-      CreateStatisticsEntry(
-          fbb, fbb.CreateString("fp_update_prevented_by_lower_bound"),
-          raptor_stats.fp_update_prevented_by_lower_bound_),
-      CreateStatisticsEntry(
-          fbb, fbb.CreateString("route_update_prevented_by_lower_bound"),
-          raptor_stats.route_update_prevented_by_lower_bound_),
-      CreateStatisticsEntry(fbb, fbb.CreateString("conversion"),
-                            MOTIS_TIMING_MS(conversion))};
-  auto statistics = std::vector<fbs::Offset<Statistics>>{
-      CreateStatistics(fbb, fbb.CreateString("nigiri.raptor"),
-                       fbb.CreateVectorOfSortedTables(&entries))};
+  auto statistics = std::vector<fbs::Offset<Statistics>>{};
+  auto search_interval = results.front().interval_;
+  for (auto const& r : results) {
+    search_interval.from_ = std::min(search_interval.from_, r.interval_.from_);
+    search_interval.to_ = std::max(search_interval.to_, r.interval_.to_);
+
+    auto const& search_stats = r.search_stats_;
+    auto const& raptor_stats = r.raptor_stats_;
+    auto entries = std::vector<fbs::Offset<StatisticsEntry>>{
+        CreateStatisticsEntry(fbb, fbb.CreateString("routing_time_ms"),
+                              r.routing_time_),
+        CreateStatisticsEntry(fbb, fbb.CreateString("lower_bounds_time_ms"),
+                              search_stats.lb_time_),
+        CreateStatisticsEntry(fbb, fbb.CreateString("fastest_direct"),
+                              search_stats.fastest_direct_),
+        CreateStatisticsEntry(fbb, fbb.CreateString("footpaths_visited"),
+                              raptor_stats.n_footpaths_visited_),
+        CreateStatisticsEntry(fbb, fbb.CreateString("routes_visited"),
+                              raptor_stats.n_routes_visited_),
+        CreateStatisticsEntry(fbb, fbb.CreateString("earliest_trip_calls"),
+                              raptor_stats.n_earliest_trip_calls_),
+        CreateStatisticsEntry(
+            fbb, fbb.CreateString("earliest_arrival_updated_by_route"),
+            raptor_stats.n_earliest_arrival_updated_by_route_),
+        CreateStatisticsEntry(
+            fbb, fbb.CreateString("earliest_arrival_updated_by_footpath"),
+            raptor_stats.n_earliest_arrival_updated_by_footpath_),
+        CreateStatisticsEntry(
+            fbb, fbb.CreateString("fp_update_prevented_by_lower_bound"),
+            raptor_stats.fp_update_prevented_by_lower_bound_),
+        CreateStatisticsEntry(
+            fbb, fbb.CreateString("route_update_prevented_by_lower_bound"),
+            raptor_stats.route_update_prevented_by_lower_bound_),
+        CreateStatisticsEntry(fbb, fbb.CreateString("conversion"),
+                              MOTIS_TIMING_MS(conversion))};
+    statistics.emplace_back(CreateStatistics(
+        fbb,
+        fbb.CreateString(is_multi_profile
+                             ? fmt::format("nigiri.raptor.{}", r.profile_)
+                             : std::string{"nigiri.raptor"}),
+        fbb.CreateVectorOfSortedTables(&entries)));
+  }
+
+  auto pool_entries = std::vector<fbs::Offset<StatisticsEntry>>{
+      CreateStatisticsEntry(fbb, fbb.CreateString("max_states"),
+                            pool_stats.max_states_),
+      CreateStatisticsEntry(fbb, fbb.CreateString("max_bytes"),
+                            pool_stats.max_bytes_),
+      CreateStatisticsEntry(fbb, fbb.CreateString("created"),
+                            pool_stats.created_),
+      CreateStatisticsEntry(fbb, fbb.CreateString("in_use"),
+                            pool_stats.in_use_),
+      CreateStatisticsEntry(fbb, fbb.CreateString("peak_in_use"),
+                            pool_stats.peak_in_use_),
+      CreateStatisticsEntry(fbb, fbb.CreateString("acquired"),
+                            pool_stats.acquired_),
+      CreateStatisticsEntry(fbb, fbb.CreateString("temporary"),
+                            pool_stats.temporary_),
+      CreateStatisticsEntry(fbb, fbb.CreateString("trimmed"),
+                            pool_stats.trimmed_),
+      CreateStatisticsEntry(fbb, fbb.CreateString("idle_bytes"),
+                            pool_stats.idle_bytes_)};
+  statistics.emplace_back(
+      CreateStatistics(fbb, fbb.CreateString("nigiri.state_pool"),
+                       fbb.CreateVectorOfSortedTables(&pool_entries)));
+
   fbb.create_and_finish(
       MsgContent_RoutingResponse,
       routing::CreateRoutingResponse(
@@ -85,7 +171,9 @@ mm::msg_ptr to_routing_response(
           fbb.CreateVector(connections),
           to_motis_unixtime(search_interval.from_),
           to_motis_unixtime(search_interval.to_),
-          fbb.CreateVector(std::vector<fbs::Offset<DirectConnection>>{}))
+          fbb.CreateVector(std::vector<fbs::Offset<DirectConnection>>{}),
+          fbb.CreateString(cursor),
+          is_multi_profile ? fbb.CreateVector(connection_profiles) : 0)
           .Union());
   return make_msg(fbb);
 }
@@ -94,7 +182,7 @@ std::vector<n::routing::offset> get_offsets(
     tag_lookup const& tags, n::timetable const& tt,
     fbs::Vector<fbs::Offset<motis::routing::AdditionalEdgeWrapper>> const*
         edges,
-    SearchDir const dir, bool const is_start) {
+    SearchDir const dir, bool const is_start, bool const use_location_idx) {
   auto const ref_station = n::get_special_station_name(
       is_start ? n::special_station::kStart : n::special_station::kEnd);
   return utl::all(*edges)  //
@@ -115,12 +203,18 @@ std::vector<n::routing::offset> get_offsets(
              return x != ref_station;
            })  //
          | utl::transform([&](routing::MumoEdge const* e) {
+             auto const idx = static_cast<std::uint32_t>(e->location_idx());
+             auto const l =
+                 use_location_idx && e->location_idx() >= 0 &&
+                         idx < tt.n_locations()
+                     ? n::location_idx_t{idx}
+                     : get_location_idx(
+                           tags, tt,
+                           ((dir == SearchDir_Forward) ^ is_start) == 0U
+                               ? e->to_station_id()->str()
+                               : e->from_station_id()->str());
              return n::routing::offset{
-                 get_location_idx(tags, tt,
-                                  ((dir == SearchDir_Forward) ^ is_start) == 0U
-                                      ? e->to_station_id()->str()
-                                      : e->from_station_id()->str()),
-                 n::duration_t{static_cast<std::int16_t>(e->duration())},
+                 l, n::duration_t{static_cast<std::int16_t>(e->duration())},
                  e->mumo_id()};
            })  //
          | utl::vec();
@@ -159,13 +253,279 @@ n::routing::clasz_mask_t to_clasz_mask(fbs::Vector<std::uint8_t> const* v) {
   }
 }
 
+struct via_stop {
+  n::location_idx_t l_;
+  n::duration_t stay_;
+};
+
+unsigned count_trips(n::routing::journey const& j) {
+  return static_cast<unsigned>(
+      std::count_if(begin(j.legs_), end(j.legs_), [](auto&& l) {
+        return std::holds_alternative<n::routing::journey::run_enter_exit>(
+            l.uses_);
+      }));
+}
+
+n::routing::journey concat(n::routing::journey const& prefix,
+                           n::routing::journey const& suffix) {
+  auto j = prefix;
+  j.legs_.insert(end(j.legs_), begin(suffix.legs_), end(suffix.legs_));
+  j.dest_time_ = suffix.dest_time_;
+  j.dest_ = suffix.dest_;
+  auto const n_trips = count_trips(j);
+  j.transfers_ = static_cast<std::uint8_t>(n_trips == 0U ? 0U : n_trips - 1U);
+  return j;
+}
+
+using raptor_result =
+    std::pair<std::vector<n::routing::journey>, n::interval<n::unixtime_t>>;
+
+// Request timeout shared by all searches of one profile (via segments,
+// pagination slices): each search gets what the previous ones left over.
+struct time_budget {
+  explicit time_budget(std::optional<std::chrono::seconds> const timeout)
+      : deadline_{timeout.has_value()
+                      ? std::optional{std::chrono::steady_clock::now() +
+                                      *timeout}
+                      : std::nullopt} {}
+
+  std::optional<std::chrono::seconds> remaining() const {
+    if (!deadline_.has_value()) {
+      return std::nullopt;
+    }
+    return std::max(std::chrono::seconds{0},
+                    std::chrono::ceil<std::chrono::seconds>(
+                        *deadline_ - std::chrono::steady_clock::now()));
+  }
+
+  bool exhausted() const {
+    return deadline_.has_value() &&
+           std::chrono::steady_clock::now() >= *deadline_;
+  }
+
+  std::optional<std::chrono::steady_clock::time_point> deadline_;
+};
+
+// Runs one raptor search. The journeys are copied because the state is
+// reused by the next search.
+raptor_result run_raptor(n::timetable const& tt, n::rt_timetable const* rtt,
+                         routing_state_pool::states& state,
+                         SearchDir const dir, time_budget const& budget,
+                         n::routing::query&& q, search_result& result) {
+  auto ret = raptor_result{};
+  auto const collect = [&](auto const& r) {
+    ret.first = std::vector<n::routing::journey>(r.journeys_->begin(),
+                                                 r.journeys_->end());
+    ret.second = r.interval_;
+    add_stats(result, r.search_stats_, r.algo_stats_);
+  };
+  if (dir == SearchDir_Forward) {
+    collect(run_search<n::direction::kForward>(state.search_state_,
+                                               state.raptor_state_, tt, rtt,
+                                               budget.remaining(),
+                                               std::move(q)));
+  } else {
+    collect(run_search<n::direction::kBackward>(state.search_state_,
+                                                state.raptor_state_, tt, rtt,
+                                                budget.remaining(),
+                                                std::move(q)));
+  }
+  return ret;
+}
+
+// Adds the journeys for the query to the result, returns the interval.
+n::interval<n::unixtime_t> search_journeys(
+    n::timetable const& tt, n::rt_timetable const* rtt,
+    routing_state_pool::states& state, SearchDir const dir,
+    time_budget const& budget, std::vector<via_stop> const& vias,
+    n::routing::query&& q, search_result& result) {
+  if (vias.empty()) {
+    auto [journeys, interval] =
+        run_raptor(tt, rtt, state, dir, budget, std::move(q), result);
+    for (auto& j : journeys) {
+      result.journeys_.add(std::move(j));
+    }
+    return interval;
+  }
+
+  // Via stops: chained searches, the first one covers the start interval,
+  // all following ones are ontrip searches from the via stop after the
+  // minimum stay duration. Partial journeys are pareto filtered per leg.
+  // max_transfers_ (number of trips) applies to the whole journey: each
+  // segment only gets the trips the prefix left over.
+  // Once the time budget is used up, no prefix is extended anymore: only
+  // journeys that reached the destination are returned.
+  auto const final_segment = q;
+  auto const max_trips = static_cast<unsigned>(q.max_transfers_);
+  auto const via_dest = [](via_stop const& v) {
+    return std::vector<n::routing::offset>{{v.l_, n::duration_t{0U}, 0U}};
+  };
+
+  q.destination_ = via_dest(vias.front());
+  q.dest_match_mode_ = n::routing::location_match_mode::kEquivalent;
+  auto [partial, interval] =
+      run_raptor(tt, rtt, state, dir, budget, std::move(q), result);
+
+  for (auto const [i, via] : utl::enumerate(vias)) {
+    auto const is_last = (i == vias.size() - 1U);
+    auto combined = n::pareto_set<n::routing::journey>{};
+    for (auto const& prefix : partial) {
+      if (budget.exhausted()) {
+        break;
+      }
+
+      auto const prefix_trips = count_trips(prefix);
+      if (prefix_trips > max_trips) {
+        continue;
+      }
+
+      auto segment = final_segment;
+      segment.max_transfers_ =
+          static_cast<std::uint8_t>(max_trips - prefix_trips);
+      segment.start_time_ = prefix.dest_time_ + via.stay_;
+      segment.start_match_mode_ = n::routing::location_match_mode::kEquivalent;
+      segment.start_ = via_dest(via);
+      segment.use_start_footpaths_ = true;
+      segment.min_connection_count_ = 0U;
+      segment.extend_interval_earlier_ = false;
+      segment.extend_interval_later_ = false;
+      if (!is_last) {
+        segment.destination_ = via_dest(vias[i + 1U]);
+        segment.dest_match_mode_ =
+            n::routing::location_match_mode::kEquivalent;
+      }
+      for (auto const& suffix :
+           run_raptor(tt, rtt, state, dir, budget, std::move(segment), result)
+               .first) {
+        if (auto j = concat(prefix, suffix); count_trips(j) <= max_trips) {
+          combined.add(std::move(j));
+        }
+      }
+    }
+    partial =
+        std::vector<n::routing::journey>(combined.begin(), combined.end());
+  }
+
+  for (auto& j : partial) {
+    result.journeys_.add(std::move(j));
+  }
+  return interval;
+}
+
+// Searches the query interval. With a previous result (pagination cursor),
+// only the time slices not covered by the cursor are searched and merged.
+search_result route_profile(n::timetable const& tt,
+                            n::rt_timetable const* rtt,
+                            routing_state_pool& pool, SearchDir const dir,
+                            std::optional<std::chrono::seconds> const timeout,
+                            std::vector<via_stop> const& vias,
+                            n::routing::query q,
+                            std::optional<routing_cursor_cache::entry> prev) {
+  auto const state = pool.acquire();
+  auto const budget = time_budget{timeout};
+  auto result = search_result{};
+  auto const search = [&](n::routing::query&& sub_query) {
+    return search_journeys(tt, rtt, *state, dir, budget, vias,
+                           std::move(sub_query), result);
+  };
+
+  MOTIS_START_TIMING(routing);
+  if (prev.has_value()) {
+    auto const requested = std::get<n::interval<n::unixtime_t>>(q.start_time_);
+    result.interval_ = prev->interval_;
+    for (auto& j : prev->journeys_) {
+      result.journeys_.add(std::move(j));
+    }
+    if (requested.from_ < result.interval_.from_) {
+      auto earlier = q;
+      earlier.start_time_ =
+          n::interval<n::unixtime_t>{requested.from_, result.interval_.from_};
+      earlier.extend_interval_later_ = false;
+      result.interval_.from_ =
+          std::min(result.interval_.from_, search(std::move(earlier)).from_);
+    }
+    if (requested.to_ > result.interval_.to_) {
+      auto later = q;
+      later.start_time_ =
+          n::interval<n::unixtime_t>{result.interval_.to_, requested.to_};
+      later.extend_interval_earlier_ = false;
+      result.interval_.to_ =
+          std::max(result.interval_.to_, search(std::move(later)).to_);
+    }
+  } else {
+    result.interval_ = search(std::move(q));
+  }
+  MOTIS_STOP_TIMING(routing);
+  result.routing_time_ = MOTIS_TIMING_MS(routing);
+
+  return result;
+}
+
+std::vector<std::pair<std::string, n::profile_idx_t>> get_profiles(
+    n::timetable const& tt, routing::RoutingRequest const* req) {
+  return utl::to_vec(*req->profiles(), [&](fbs::String const* name) {
+    for (auto const& [prf_name, prf_idx] : tt.profiles_) {
+      if (std::string_view{prf_name} == name->view()) {
+        return std::pair{name->str(), prf_idx};
+      }
+    }
+    utl::verify(name->view() == "default", "unknown profile {}",
+                name->view());
+    return std::pair{name->str(), n::profile_idx_t{0U}};
+  });
+}
+
+// Hash of all request parameters that influence the search result except
+// the start interval and the interval extension settings.
+std::uint64_t get_fingerprint(routing::RoutingRequest const* req,
+                              n::profile_idx_t const prf_idx) {
+  auto const str_hash = [](fbs::String const* s) {
+    return s == nullptr ? cista::BASE_HASH : cista::hash(s->view());
+  };
+
+  auto h = cista::hash_combine(
+      cista::BASE_HASH, req->start_type(), req->search_dir(),
+      req->use_start_metas(), req->use_dest_metas(),
+      req->use_start_footpaths(), req->max_transfers(), prf_idx,
+      to_clasz_mask(req->allowed_claszes()),
+      str_hash(req->destination()->id()));
+  if (req->via() != nullptr) {
+    for (auto const& v : *req->via()) {
+      h = cista::hash_combine(h, str_hash(v->station()->id()),
+                              v->stay_duration());
+    }
+  }
+  if (req->start_type() == routing::Start_PretripStart) {
+    auto const start =
+        reinterpret_cast<routing::PretripStart const*>(req->start());
+    h = cista::hash_combine(h, str_hash(start->station()->id()));
+  }
+  for (auto const& e : *req->additional_edges()) {
+    auto const me =
+        reinterpret_cast<routing::MumoEdge const*>(e->additional_edge());
+    h = cista::hash_combine(h, str_hash(me->from_station_id()),
+                            str_hash(me->to_station_id()), me->duration(),
+                            me->mumo_id());
+  }
+  return h;
+}
+
 motis::module::msg_ptr route(tag_lookup const& tags, n::timetable const& tt,
                              n::rt_timetable const* rtt,
                              motis::module::msg_ptr const& msg,
-                             n::profile_idx_t const prf_idx) {
+                             n::profile_idx_t const prf_idx,
+                             routing_state_pool* pool,
+                             routing_cursor_cache* cursors,
+                             std::uint64_t const rt_version,
+                             std::uint64_t const location_fingerprint) {
   using motis::routing::RoutingRequest;
   auto const req = motis_content(RoutingRequest, msg);
 
+  // Location indices from a geo station lookup on the same timetable.
+  auto const use_location_idx =
+      req->location_fingerprint() != 0U &&
+      req->location_fingerprint() == location_fingerprint;
+
   auto min_connection_count = static_cast<std::uint8_t>(0U);
   auto extend_interval_earlier = false;
   auto extend_interval_later = false;
@@ -286,7 +646,8 @@ motis::module::msg_ptr route(tag_lookup const& tags, n::timetable const& tt,
 
   auto destination = is_intermodal_dest
                          ? get_offsets(tags, tt, req->additional_edges(),
-                                       req->search_dir(), false)
+                                       req->search_dir(), false,
+                                       use_location_idx)
                          : std::vector<n::routing::offset>{
                                {destination_station, n::duration_t{0U}, 0U}};
 
@@ -313,7 +674,7 @@ motis::module::msg_ptr route(tag_lookup const& tags, n::timetable const& tt,
       .use_start_footpaths_ = req->use_start_footpaths(),
       .start_ = is_intermodal_start
                     ? get_offsets(tags, tt, req->additional_edges(),
-                                  req->search_dir(), true)
+                                  req->search_dir(), true, use_location_idx)
                     : std::vector<n::routing::offset>{{start_station,
                                                        n::duration_t{0U}, 0U}},
       .destination_ = std::move(destination),
@@ -327,38 +688,70 @@ motis::module::msg_ptr route(tag_lookup const& tags, n::timetable const& tt,
   utl::verify(!q.start_.empty(), "no start edges");
   utl::verify(!q.destination_.empty(), "no destination edges");
 
-  if (search_state.get() == nullptr) {
-    search_state.reset(new n::routing::search_state{});
+  auto const vias =
+      req->via() == nullptr
+          ? std::vector<via_stop>{}
+          : utl::to_vec(*req->via(), [&](routing::Via const* v) {
+              auto const l =
+                  get_location_idx(tags, tt, v->station()->id()->view());
+              utl::verify(l != n::location_idx_t::invalid(),
+                          "unknown via station {}", v->station()->id()->view());
+              return via_stop{.l_ = l,
+                              .stay_ = n::duration_t{static_cast<std::int16_t>(
+                                  v->stay_duration())}};
+            });
+  utl::verify(vias.empty() || req->search_dir() == SearchDir_Forward,
+              "via stops are only supported for forward searches");
+
+  if (pool == nullptr) {
+    pool = &default_routing_state_pool();
   }
-  if (raptor_state.get() == nullptr) {
-    raptor_state.reset(new n::routing::raptor_state{});
+
+  if (req->profiles() != nullptr && req->profiles()->size() != 0U) {
+    // Multiple profiles: locations and offsets are resolved once (above),
+    // the searches run in parallel, each with its own routing state.
+    auto const profiles = get_profiles(tt, req);
+    auto results = std::vector<search_result>(profiles.size());
+    auto const search_profile = [&](std::size_t const i) {
+      auto profile_query = q;
+      profile_query.prf_idx_ = profiles[i].second;
+      results[i] =
+          route_profile(tt, rtt, *pool, req->search_dir(), timeout, vias,
+                        std::move(profile_query), std::nullopt);
+      results[i].profile_ = profiles[i].first;
+    };
+    auto indices = std::vector<std::size_t>(profiles.size());
+    std::iota(begin(indices), end(indices), 0U);
+    motis_parallel_for(indices, search_profile);
+    return to_routing_response(tt, rtt, tags, results, pool->get_stats(), "",
+                               true);
   }
 
-  MOTIS_START_TIMING(routing);
-  auto search_interval = n::interval<n::unixtime_t>{};
-  n::pareto_set<n::routing::journey> const* journeys{nullptr};
-  n::routing::search_stats search_stats;
-  n::routing::raptor_stats raptor_stats;
-  if (req->search_dir() == SearchDir_Forward) {
-    auto const r = run_search<n::direction::kForward>(
-        *search_state, *raptor_state, tt, rtt, timeout, std::move(q));
-    journeys = r.journeys_;
-    search_stats = r.search_stats_;
-    raptor_stats = r.algo_stats_;
-    search_interval = r.interval_;
-  } else {
-    auto const r = run_search<n::direction::kBackward>(
-        *search_state, *raptor_state, tt, rtt, timeout, std::move(q));
-    journeys = r.journeys_;
-    search_stats = r.search_stats_;
-    raptor_stats = r.algo_stats_;
-    search_interval = r.interval_;
+  auto const fingerprint = get_fingerprint(req, prf_idx);
+  auto prev = std::optional<routing_cursor_cache::entry>{};
+  if (cursors != nullptr && req->cursor() != nullptr &&
+      std::holds_alternative<n::interval<n::unixtime_t>>(q.start_time_)) {
+    prev = cursors->get(req->cursor()->view(), fingerprint, rt_version);
+  }
+
+  auto results = std::vector<search_result>{};
+  results.emplace_back(route_profile(tt, rtt, *pool, req->search_dir(),
+                                     timeout, vias, std::move(q),
+                                     std::move(prev)));
+  auto const& result = results.front();
+
+  auto cursor = std::string{};
+  if (cursors != nullptr && req->start_type() == routing::Start_PretripStart) {
+    cursor = cursors->add({.fingerprint_ = fingerprint,
+                           .rt_version_ = rt_version,
+                           .interval_ = result.interval_,
+                           .journeys_ = std::vector<n::routing::journey>(
+                               result.journeys_.begin(),
+                               result.journeys_.end())});
   }
-  MOTIS_STOP_TIMING(routing);
 
-  return to_routing_response(tt, rtt, tags, journeys, search_interval,
-                             search_stats, raptor_stats,
-                             MOTIS_TIMING_MS(routing));
+  return to_routing_response(tt, rtt, tags, results, pool->get_stats(),
+                             cursor, false);
 }
 
 }  // namespace motis::nigiri
@@ -0,0 +1,65 @@
+#include "motis/nigiri/routing_cursor.h"
+
+#include <charconv>
+
+#include "fmt/core.h"
+
+namespace motis::nigiri {
+
+routing_cursor_cache::routing_cursor_cache(std::size_t const max_entries)
+    : max_entries_{max_entries} {}
+
+std::string routing_cursor_cache::add(entry e) {
+  auto const lock = std::lock_guard{mutex_};
+  if (max_entries_ == 0U) {
+    return {};
+  }
+
+  while (order_.size() >= max_entries_) {
+    entries_.erase(order_.front());
+    order_.pop_front();
+  }
+
+  auto const id = next_id_++;
+  auto const cursor =
+      fmt::format("{:016x}{:016x}{:016x}", id, e.fingerprint_, e.rt_version_);
+  order_.emplace_back(id);
+  entries_.emplace(id, std::move(e));
+  return cursor;
+}
+
+std::optional<routing_cursor_cache::entry> routing_cursor_cache::get(
+    std::string_view const cursor, std::uint64_t const fingerprint,
+    std::uint64_t const rt_version) const {
+  auto const parse_hex = [&](std::size_t const pos) {
+    auto x = std::uint64_t{0U};
+    auto const s = cursor.substr(pos, 16U);
+    auto const [ptr, ec] =
+        std::from_chars(s.data(), s.data() + s.size(), x, 16);
+    return (ec == std::errc{} && ptr == s.data() + s.size())
+               ? std::optional{x}
+               : std::nullopt;
+  };
+
+  if (cursor.size() != 48U) {
+    return std::nullopt;
+  }
+
+  auto const id = parse_hex(0U);
+  auto const cursor_fingerprint = parse_hex(16U);
+  auto const cursor_rt_version = parse_hex(32U);
+  if (!id.has_value() || cursor_fingerprint != fingerprint ||
+      cursor_rt_version != rt_version) {
+    return std::nullopt;
+  }
+
+  auto const lock = std::lock_guard{mutex_};
+  auto const it = entries_.find(*id);
+  if (it == end(entries_) || it->second.fingerprint_ != fingerprint ||
+      it->second.rt_version_ != rt_version) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+}  // namespace motis::nigiri
@@ -0,0 +1,99 @@
+#include "motis/nigiri/routing_state_pool.h"
+
+#include <algorithm>
+
+namespace motis::nigiri {
+
+template <typename T>
+std::size_t capacity_in_bytes(T const& v) {
+  return v.capacity() * sizeof(typename T::value_type);
+}
+
+std::size_t routing_state_pool::states::size_in_bytes() const {
+  return capacity_in_bytes(search_state_.travel_time_lower_bound_) +
+         capacity_in_bytes(search_state_.dist_to_dest_) +
+         capacity_in_bytes(search_state_.starts_) +
+         capacity_in_bytes(search_state_.is_destination_.blocks_) +
+         capacity_in_bytes(raptor_state_.tmp_) +
+         capacity_in_bytes(raptor_state_.best_) +
+         capacity_in_bytes(raptor_state_.round_times_.entries_) +
+         capacity_in_bytes(raptor_state_.station_mark_.blocks_) +
+         capacity_in_bytes(raptor_state_.prev_station_mark_.blocks_) +
+         capacity_in_bytes(raptor_state_.route_mark_.blocks_);
+}
+
+routing_state_pool::handle::handle(routing_state_pool& pool,
+                                   std::unique_ptr<states> s,
+                                   bool const pooled)
+    : pool_{pool}, states_{std::move(s)}, pooled_{pooled} {}
+
+routing_state_pool::handle::~handle() {
+  pool_.release(std::move(states_), pooled_);
+}
+
+routing_state_pool::routing_state_pool(unsigned const max_states,
+                                       std::size_t const max_bytes)
+    : max_states_{max_states}, max_bytes_{max_bytes} {
+  stats_.max_states_ = max_states;
+  stats_.max_bytes_ = max_bytes;
+}
+
+routing_state_pool::handle routing_state_pool::acquire() {
+  auto lock = std::unique_lock{mutex_};
+
+  ++stats_.acquired_;
+  ++stats_.in_use_;
+  stats_.peak_in_use_ = std::max(stats_.peak_in_use_, stats_.in_use_);
+
+  if (!idle_.empty()) {
+    auto s = std::move(idle_.back());
+    idle_.pop_back();
+    stats_.idle_bytes_ -= s->size_in_bytes();
+    return handle{*this, std::move(s), true};
+  }
+
+  auto const pooled = max_states_ == 0U || stats_.created_ < max_states_;
+  if (pooled) {
+    ++stats_.created_;
+  } else {
+    ++stats_.temporary_;
+  }
+  lock.unlock();
+  return handle{*this, std::make_unique<states>(), pooled};
+}
+
+void routing_state_pool::release(std::unique_ptr<states> s,
+                                 bool const pooled) {
+  // Free and trim before taking the lock: freeing large buffers can take a
+  // while.
+  if (!pooled) {
+    s.reset();
+    auto const lock = std::lock_guard{mutex_};
+    --stats_.in_use_;
+    return;
+  }
+
+  auto trimmed = false;
+  if (max_bytes_ != 0U && s->size_in_bytes() > max_bytes_) {
+    s = std::make_unique<states>();
+    trimmed = true;
+  }
+  auto const size = s->size_in_bytes();
+
+  {
+    auto const lock = std::lock_guard{mutex_};
+    idle_.emplace_back(std::move(s));
+    stats_.idle_bytes_ += size;
+    --stats_.in_use_;
+    if (trimmed) {
+      ++stats_.trimmed_;
+    }
+  }
+}
+
+routing_state_pool::stats routing_state_pool::get_stats() const {
+  auto const lock = std::lock_guard{mutex_};
+  return stats_;
+}
+
+}  // namespace motis::nigiri
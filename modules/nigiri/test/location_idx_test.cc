@@ -0,0 +1,160 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+#include "utl/to_vec.h"
+
+#include "nigiri/loader/dir.h"
+#include "nigiri/loader/gtfs/load_timetable.h"
+#include "nigiri/loader/init_finish.h"
+#include "nigiri/timetable.h"
+
+#include "motis/core/common/constants.h"
+#include "motis/core/journey/journey.h"
+#include "motis/core/journey/message_to_journeys.h"
+#include "motis/core/journey/print_journey.h"
+#include "motis/nigiri/location.h"
+#include "motis/nigiri/routing.h"
+#include "motis/nigiri/tag_lookup.h"
+
+#include "./utils.h"
+
+using namespace date;
+using namespace std::chrono_literals;
+namespace n = nigiri;
+namespace mn = motis::nigiri;
+
+namespace {
+
+constexpr auto const kFingerprint = std::uint64_t{42U};
+
+struct edge {
+  std::string_view from_, to_;
+  int location_idx_;
+  std::uint16_t duration_;
+};
+
+motis::module::msg_ptr make_intermodal_routing_msg(
+    std::int64_t const start, std::vector<edge> const& edges,
+    std::uint64_t const location_fingerprint) {
+  using namespace motis;
+  using flatbuffers::Offset;
+
+  motis::module::message_creator fbb;
+  auto mumo_id = 0;
+  fbb.create_and_finish(
+      MsgContent_RoutingRequest,
+      CreateRoutingRequest(
+          fbb, motis::routing::Start_OntripStationStart,
+          CreateOntripStationStart(
+              fbb,
+              routing::CreateInputStation(fbb, fbb.CreateString(STATION_START),
+                                          fbb.CreateString("")),
+              start)
+              .Union(),
+          routing::CreateInputStation(fbb, fbb.CreateString(STATION_END),
+                                      fbb.CreateString("")),
+          routing::SearchType_Default, SearchDir_Forward,
+          fbb.CreateVector(std::vector<Offset<routing::Via>>()),
+          fbb.CreateVector(utl::to_vec(
+              edges,
+              [&](edge const& e) {
+                return routing::CreateAdditionalEdgeWrapper(
+                    fbb, routing::AdditionalEdge_MumoEdge,
+                    routing::CreateMumoEdge(
+                        fbb, fbb.CreateString(e.from_),
+                        fbb.CreateString(e.to_), e.duration_, 0U, 0U,
+                        mumo_id++, e.location_idx_)
+                        .Union());
+              })),
+          true, true, true, 0, 0, 0, -1, 0, 0, location_fingerprint)
+          .Union(),
+      "/nigiri");
+  return make_msg(fbb);
+}
+
+std::vector<std::string> route(mn::tag_lookup const& tags,
+                               n::timetable const& tt,
+                               motis::module::msg_ptr const& msg) {
+  using motis::routing::RoutingResponse;
+  auto journeys = utl::to_vec(
+      motis::message_to_journeys(motis_content(
+          RoutingResponse, mn::route(tags, tt, nullptr, msg,
+                                     n::profile_idx_t{0U}, nullptr, nullptr,
+                                     0U, kFingerprint))),
+      [](motis::journey const& j) {
+        std::stringstream ss;
+        motis::print_journey(j, ss, false);
+        return ss.str();
+      });
+  std::sort(begin(journeys), end(journeys));
+  return journeys;
+}
+
+}  // namespace
+
+TEST(nigiri, location_idx_test) {
+  auto tt = n::timetable{};
+  tt.date_range_ = {date::sys_days{2019_y / June / 24},
+                    date::sys_days{2019_y / June / 27}};
+  n::loader::register_special_stations(tt);
+  n::loader::gtfs::load_timetable(
+      {}, n::source_idx_t{0},
+      *n::loader::make_dir("test/schedule/gtfs_minimal_swiss"), tt);
+  n::loader::finalize(tt);
+
+  auto tags = mn::tag_lookup{};
+  tags.add(n::source_idx_t{0U}, "tag_");
+
+  constexpr auto const kZurich = "tag_8503000:0:41/42";
+  constexpr auto const kLenzburg = "tag_8502119:0:3";
+  constexpr auto const kAarau = "tag_8502113:0:4";
+  auto const idx = [&](std::string_view id) {
+    auto const l = mn::get_location_idx(tags, tt, id);
+    EXPECT_NE(n::location_idx_t::invalid(), l);
+    return static_cast<int>(to_idx(l));
+  };
+
+  auto const start = mn::to_unix(date::sys_days{2019_y / June / 24} + 22h);
+  auto const edges = [&](int const zurich, int const lenzburg,
+                         int const aarau) {
+    return std::vector<edge>{{STATION_START, kZurich, zurich, 5U},
+                             {STATION_START, kLenzburg, lenzburg, 50U},
+                             {kAarau, STATION_END, aarau, 3U}};
+  };
+
+  // Reference: station IDs only.
+  auto const expected = route(
+      tags, tt, make_intermodal_routing_msg(start, edges(-1, -1, -1), 0U));
+  ASSERT_FALSE(expected.empty());
+
+  // Mixed: location indices for some edges, station IDs for the others.
+  EXPECT_EQ(expected,
+            route(tags, tt,
+                  make_intermodal_routing_msg(
+                      start, edges(idx(kZurich), -1, idx(kAarau)),
+                      kFingerprint)));
+
+  // All edges with location indices.
+  EXPECT_EQ(expected,
+            route(tags, tt,
+                  make_intermodal_routing_msg(
+                      start,
+                      edges(idx(kZurich), idx(kLenzburg), idx(kAarau)),
+                      kFingerprint)));
+
+  // Indices for another timetable version are ignored.
+  EXPECT_EQ(expected,
+            route(tags, tt,
+                  make_intermodal_routing_msg(
+                      start,
+                      edges(idx(kAarau), idx(kAarau), idx(kZurich)),
+                      kFingerprint + 1U)));
+
+  // Out of range indices fall back to the station ID.
+  auto const invalid = static_cast<int>(tt.n_locations());
+  EXPECT_EQ(expected,
+            route(tags, tt,
+                  make_intermodal_routing_msg(
+                      start, edges(invalid, invalid, invalid), kFingerprint)));
+}
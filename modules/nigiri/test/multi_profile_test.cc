@@ -0,0 +1,173 @@
+#include "gtest/gtest.h"
+
+#include "utl/helpers/algorithm.h"
+#include "utl/to_vec.h"
+
+#include "nigiri/footpath.h"
+#include "nigiri/loader/dir.h"
+#include "nigiri/loader/gtfs/load_timetable.h"
+#include "nigiri/loader/init_finish.h"
+#include "nigiri/timetable.h"
+
+#include "motis/core/journey/journey.h"
+#include "motis/core/journey/message_to_journeys.h"
+#include "motis/core/journey/print_journey.h"
+#include "motis/module/message.h"
+#include "motis/nigiri/routing.h"
+#include "motis/nigiri/tag_lookup.h"
+#include "motis/test/motis_instance_test.h"
+
+#include "./utils.h"
+
+using namespace date;
+using namespace std::chrono_literals;
+namespace n = nigiri;
+namespace mn = motis::nigiri;
+
+namespace {
+
+// Footpaths of the "alt" profile: long enough to miss the first train.
+constexpr auto const kAltFootpathDuration = n::duration_t{120};
+
+// No start metas: only the footpaths of the profile lead to other tracks.
+// Without profiles, the profile passed to route() is used.
+motis::module::msg_ptr make_multi_profile_routing_msg(
+    std::string_view from, std::string_view to, std::int64_t const start,
+    std::vector<std::string> const& profiles) {
+  using namespace motis;
+  using flatbuffers::Offset;
+
+  motis::module::message_creator fbb;
+  fbb.create_and_finish(
+      MsgContent_RoutingRequest,
+      CreateRoutingRequest(
+          fbb, motis::routing::Start_OntripStationStart,
+          CreateOntripStationStart(
+              fbb,
+              routing::CreateInputStation(fbb, fbb.CreateString(from),
+                                          fbb.CreateString("")),
+              start)
+              .Union(),
+          routing::CreateInputStation(fbb, fbb.CreateString(to),
+                                      fbb.CreateString("")),
+          routing::SearchType_Default, SearchDir_Forward,
+          fbb.CreateVector(std::vector<Offset<routing::Via>>()),
+          fbb.CreateVector(
+              std::vector<Offset<routing::AdditionalEdgeWrapper>>()),
+          false, true, true, 0, 0, 0, -1, 0,
+          profiles.empty() ? 0 : fbb.CreateVectorOfStrings(profiles))
+          .Union(),
+      "/nigiri");
+  return make_msg(fbb);
+}
+
+std::string print(motis::journey const& j) {
+  std::stringstream ss;
+  motis::print_journey(j, ss, false);
+  return ss.str();
+}
+
+}  // namespace
+
+// Profiles are searched as parallel jobs: run inside a motis instance.
+struct nigiri_multi_profile_test : public motis::test::motis_instance_test {
+  motis::module::msg_ptr route(motis::module::msg_ptr const& msg,
+                               n::profile_idx_t const prf_idx) {
+    auto res = motis::module::msg_ptr{};
+    run([&]() { res = mn::route(tags_, tt_, nullptr, msg, prf_idx); });
+    return res;
+  }
+
+  n::timetable tt_;
+  mn::tag_lookup tags_;
+};
+
+TEST_F(nigiri_multi_profile_test, multi_profile_test) {
+  using motis::routing::RoutingResponse;
+
+  auto& tt = tt_;
+  tt.date_range_ = {date::sys_days{2019_y / June / 24},
+                    date::sys_days{2019_y / June / 27}};
+  n::loader::register_special_stations(tt);
+  n::loader::gtfs::load_timetable(
+      {}, n::source_idx_t{0},
+      *n::loader::make_dir("test/schedule/gtfs_minimal_swiss"), tt);
+  n::loader::finalize(tt);
+
+  // Second profile: same footpaths as the default profile, but all of them
+  // take kAltFootpathDuration. From track 13, the default profile walks to
+  // track 41/42 for the 01:00 train, "alt" only reaches the 05:19 train
+  // from track 14.
+  auto const alt = n::profile_idx_t{1U};
+  tt.profiles_.emplace("alt", alt);
+  tt.locations_.footpaths_out_[alt] = tt.locations_.footpaths_out_[0];
+  tt.locations_.footpaths_in_[alt] = tt.locations_.footpaths_in_[0];
+  auto& loc = tt.locations_;
+  for (auto* fps : {&loc.footpaths_out_[alt], &loc.footpaths_in_[alt]}) {
+    for (auto i = 0U; i != fps->size(); ++i) {
+      for (auto& fp : (*fps)[n::location_idx_t{i}]) {
+        fp = n::footpath{fp.target(), kAltFootpathDuration};
+      }
+    }
+  }
+
+  tags_.add(n::source_idx_t{0U}, "tag_");
+
+  auto const from = "tag_8503000:0:13";
+  auto const to = "tag_8502113:0:4";
+  auto const start = mn::to_unix(date::sys_days{2019_y / June / 24} + 22h);
+
+  auto const separate = [&](n::profile_idx_t const prf_idx) {
+    auto const res =
+        route(make_multi_profile_routing_msg(from, to, start, {}), prf_idx);
+    return utl::to_vec(
+        motis::message_to_journeys(motis_content(RoutingResponse, res)),
+        print);
+  };
+  auto const expected_default = separate(n::profile_idx_t{0U});
+  auto const expected_alt = separate(alt);
+  ASSERT_FALSE(expected_default.empty());
+  ASSERT_FALSE(expected_alt.empty());
+  ASSERT_NE(expected_default, expected_alt);
+
+  auto const res = route(
+      make_multi_profile_routing_msg(from, to, start, {"default", "alt"}),
+      n::profile_idx_t{0U});
+  auto const content = motis_content(RoutingResponse, res);
+  auto const journeys = motis::message_to_journeys(content);
+
+  ASSERT_NE(nullptr, content->connection_profiles());
+  ASSERT_EQ(journeys.size(), content->connection_profiles()->size());
+  ASSERT_EQ(expected_default.size() + expected_alt.size(), journeys.size());
+
+  auto multi_default = std::vector<std::string>{};
+  auto multi_alt = std::vector<std::string>{};
+  for (auto i = 0U; i != journeys.size(); ++i) {
+    auto const profile = content->connection_profiles()->Get(i)->view();
+    ASSERT_TRUE(profile == "default" || profile == "alt");
+    (profile == "default" ? multi_default : multi_alt)
+        .emplace_back(print(journeys[i]));
+  }
+  EXPECT_EQ(expected_default, multi_default);
+  EXPECT_EQ(expected_alt, multi_alt);
+
+  // A single entry in the profiles list is still a multi-profile request.
+  auto const single_res =
+      route(make_multi_profile_routing_msg(from, to, start, {"alt"}),
+            n::profile_idx_t{0U});
+  auto const single = motis_content(RoutingResponse, single_res);
+  auto const single_journeys = motis::message_to_journeys(single);
+  ASSERT_NE(nullptr, single->connection_profiles());
+  ASSERT_EQ(single_journeys.size(), single->connection_profiles()->size());
+  for (auto const* profile : *single->connection_profiles()) {
+    EXPECT_EQ("alt", profile->view());
+  }
+  EXPECT_EQ(expected_alt, utl::to_vec(single_journeys, print));
+  EXPECT_TRUE(utl::any_of(*single->statistics(), [](auto const* s) {
+    return s->category()->view() == "nigiri.raptor.alt";
+  }));
+
+  EXPECT_ANY_THROW(
+      route(make_multi_profile_routing_msg(from, to, start, {"unknown"}),
+            n::profile_idx_t{0U}));
+}
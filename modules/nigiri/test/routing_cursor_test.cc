@@ -0,0 +1,153 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+#include "nigiri/loader/gtfs/files.h"
+#include "nigiri/loader/gtfs/load_timetable.h"
+#include "nigiri/loader/init_finish.h"
+#include "nigiri/timetable.h"
+
+#include "motis/core/journey/journey.h"
+#include "motis/core/journey/message_to_journeys.h"
+#include "motis/core/journey/print_journey.h"
+#include "motis/nigiri/routing.h"
+#include "motis/nigiri/routing_cursor.h"
+#include "motis/nigiri/tag_lookup.h"
+
+#include "./utils.h"
+
+using namespace date;
+using namespace std::chrono_literals;
+using namespace std::string_view_literals;
+namespace n = nigiri;
+namespace mn = motis::nigiri;
+
+namespace {
+
+// Hourly direct trips A -> C, a faster connection via B at 09:20 which
+// dominates the direct 09:00 trip.
+constexpr auto const test_files = R"(
+# agency.txt
+agency_id,agency_name,agency_url,agency_timezone
+DB,Deutsche Bahn,https://deutschebahn.com,Europe/Berlin
+
+# stops.txt
+stop_id,stop_name,stop_desc,stop_lat,stop_lon,stop_url,location_type,parent_station
+A,A,,0.0,1.0,,
+B,B,,2.0,3.0,,
+C,C,,4.0,5.0,,
+
+# routes.txt
+route_id,agency_id,route_short_name,route_long_name,route_desc,route_type
+R1,DB,1,,,3
+R2,DB,2,,,3
+
+# trips.txt
+route_id,service_id,trip_id,trip_headsign,block_id
+R1,S1,T1,,
+R1,S1,T2,,
+R1,S1,T3,,
+R1,S1,T4,,
+R1,S1,T5,,
+R2,S1,T6,,
+R2,S1,T7,,
+
+# stop_times.txt
+trip_id,arrival_time,departure_time,stop_id,stop_sequence,pickup_type,drop_off_type
+T1,08:00:00,08:00:00,A,0,0,0
+T1,09:00:00,09:00:00,C,1,0,0
+T2,09:00:00,09:00:00,A,0,0,0
+T2,10:00:00,10:00:00,C,1,0,0
+T3,10:00:00,10:00:00,A,0,0,0
+T3,11:00:00,11:00:00,C,1,0,0
+T4,11:00:00,11:00:00,A,0,0,0
+T4,12:00:00,12:00:00,C,1,0,0
+T5,12:00:00,12:00:00,A,0,0,0
+T5,13:00:00,13:00:00,C,1,0,0
+T6,09:20:00,09:20:00,A,0,0,0
+T6,09:30:00,09:30:00,B,1,0,0
+T7,09:35:00,09:35:00,B,0,0,0
+T7,09:50:00,09:50:00,C,1,0,0
+
+# calendar_dates.txt
+service_id,date,exception_type
+S1,20190501,1
+)"sv;
+
+std::vector<std::string> get_journeys(motis::module::msg_ptr const& msg) {
+  using motis::routing::RoutingResponse;
+  auto journeys = std::vector<std::string>{};
+  for (auto const& j :
+       motis::message_to_journeys(motis_content(RoutingResponse, msg))) {
+    std::stringstream ss;
+    motis::print_journey(j, ss, false);
+    journeys.emplace_back(ss.str());
+  }
+  std::sort(begin(journeys), end(journeys));
+  return journeys;
+}
+
+}  // namespace
+
+TEST(nigiri, routing_cursor_test) {
+  using namespace motis;
+  using motis::routing::RoutingResponse;
+
+  auto tt = n::timetable{};
+  tt.date_range_ = {date::sys_days{2019_y / May / 1},
+                    date::sys_days{2019_y / May / 2}};
+  n::loader::register_special_stations(tt);
+  n::loader::gtfs::load_timetable({}, n::source_idx_t{0},
+                                  n::loader::mem_dir::read(test_files), tt);
+  n::loader::finalize(tt);
+
+  auto tags = mn::tag_lookup{};
+  tags.add(n::source_idx_t{0U}, "tag_");
+
+  auto cursors = mn::routing_cursor_cache{16U};
+  auto const t = [](std::chrono::minutes const m) {
+    return mn::to_unix(date::sys_days{2019_y / May / 1} + m);
+  };
+  auto const route = [&](std::int64_t const begin, std::int64_t const end,
+                         std::string_view cursor, std::uint64_t rt_version) {
+    return mn::route(
+        tags, tt, nullptr,
+        mn::make_pretrip_routing_msg("tag_A", "tag_C", begin, end, cursor),
+        n::profile_idx_t{0U}, nullptr, &cursors, rt_version);
+  };
+
+  // Reference: one search over the whole interval (07:00 - 10:00 UTC).
+  auto const single = route(t(7h), t(10h), "", 0U);
+  auto const expected = get_journeys(single);
+  ASSERT_FALSE(expected.empty());
+
+  // Page 1: 08:00 - 09:00 UTC.
+  auto const page = route(t(8h), t(9h), "", 0U);
+  auto const page_cursor =
+      motis_content(RoutingResponse, page)->cursor()->str();
+  ASSERT_FALSE(page_cursor.empty());
+  EXPECT_NE(expected, get_journeys(page));
+
+  // Earlier + later in one go with the cursor of page 1.
+  auto const paged = route(t(7h), t(10h), page_cursor, 0U);
+  EXPECT_EQ(expected, get_journeys(paged));
+  EXPECT_EQ(motis_content(RoutingResponse, single)->interval_begin(),
+            motis_content(RoutingResponse, paged)->interval_begin());
+  EXPECT_EQ(motis_content(RoutingResponse, single)->interval_end(),
+            motis_content(RoutingResponse, paged)->interval_end());
+
+  // Earlier and later step by step.
+  auto const earlier = route(t(7h), t(9h), page_cursor, 0U);
+  auto const later = route(
+      t(7h), t(10h), motis_content(RoutingResponse, earlier)->cursor()->str(),
+      0U);
+  EXPECT_EQ(expected, get_journeys(later));
+
+  // RT update: cursor is not valid anymore -> full search, same result.
+  auto const after_rt = route(t(7h), t(10h), page_cursor, 1U);
+  EXPECT_EQ(expected, get_journeys(after_rt));
+
+  // Unknown cursor -> full search.
+  auto const bad = route(t(7h), t(10h), "not a cursor", 0U);
+  EXPECT_EQ(expected, get_journeys(bad));
+}
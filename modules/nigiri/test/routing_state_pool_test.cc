@@ -0,0 +1,164 @@
+#include "gtest/gtest.h"
+
+#include <thread>
+
+#include "nigiri/loader/gtfs/files.h"
+#include "nigiri/loader/gtfs/load_timetable.h"
+#include "nigiri/loader/init_finish.h"
+#include "nigiri/timetable.h"
+
+#include "motis/core/journey/journey.h"
+#include "motis/core/journey/message_to_journeys.h"
+#include "motis/core/journey/print_journey.h"
+#include "motis/nigiri/routing.h"
+#include "motis/nigiri/routing_state_pool.h"
+#include "motis/nigiri/tag_lookup.h"
+
+#include "./utils.h"
+
+using namespace date;
+using namespace std::chrono_literals;
+using namespace std::string_view_literals;
+namespace n = nigiri;
+namespace mn = motis::nigiri;
+
+namespace {
+
+constexpr auto const test_files = R"(
+# agency.txt
+agency_id,agency_name,agency_url,agency_timezone
+DB,Deutsche Bahn,https://deutschebahn.com,Europe/Berlin
+
+# stops.txt
+stop_id,stop_name,stop_desc,stop_lat,stop_lon,stop_url,location_type,parent_station
+A,A,,0.0,1.0,,
+B,B,,2.0,3.0,,
+C,C,,4.0,5.0,,
+D,D,,6.0,7.0,,
+
+# routes.txt
+route_id,agency_id,route_short_name,route_long_name,route_desc,route_type
+R1,DB,1,,,3
+R2,DB,2,,,3
+R3,DB,3,,,3
+
+# trips.txt
+route_id,service_id,trip_id,trip_headsign,block_id
+R1,S1,T1,,
+R2,S1,T2,,
+R3,S1,T3,,
+
+# stop_times.txt
+trip_id,arrival_time,departure_time,stop_id,stop_sequence,pickup_type,drop_off_type
+T1,10:00:00,10:00:00,A,0,0,0
+T1,11:00:00,11:00:00,D,1,0,0
+T2,10:00:00,10:00:00,A,0,0,0
+T2,10:10:00,10:10:00,B,1,0,0
+T3,10:15:00,10:15:00,B,0,0,0
+T3,10:20:00,10:20:00,C,1,0,0
+T3,10:50:00,10:50:00,D,2,0,0
+
+# calendar_dates.txt
+service_id,date,exception_type
+S1,20190501,1
+)"sv;
+
+std::string print_response(motis::module::msg_ptr const& msg) {
+  using motis::routing::RoutingResponse;
+  std::stringstream ss;
+  for (auto const& j :
+       motis::message_to_journeys(motis_content(RoutingResponse, msg))) {
+    motis::print_journey(j, ss, false);
+  }
+  return ss.str();
+}
+
+}  // namespace
+
+TEST(nigiri, routing_state_pool_limit) {
+  constexpr auto const kMaxStates = 2U;
+
+  auto pool = mn::routing_state_pool{kMaxStates};
+  {
+    auto const a = pool.acquire();
+    auto const b = pool.acquire();
+    auto const c = pool.acquire();  // exhausted: temporary, does not block
+    auto const stats = pool.get_stats();
+    EXPECT_EQ(kMaxStates, stats.created_);
+    EXPECT_EQ(1U, stats.temporary_);
+    EXPECT_EQ(3U, stats.in_use_);
+  }
+  {
+    // The temporary state is not kept.
+    auto const a = pool.acquire();
+    auto const b = pool.acquire();
+    auto const stats = pool.get_stats();
+    EXPECT_EQ(kMaxStates, stats.created_);
+    EXPECT_EQ(1U, stats.temporary_);
+  }
+
+  constexpr auto const kThreads = 8U;
+  auto threads = std::vector<std::thread>{};
+  for (auto i = 0U; i != kThreads; ++i) {
+    threads.emplace_back([&]() {
+      for (auto j = 0U; j != 16U; ++j) {
+        auto const state = pool.acquire();
+        std::this_thread::sleep_for(1ms);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  auto const stats = pool.get_stats();
+  EXPECT_EQ(kMaxStates, stats.created_);
+  EXPECT_EQ(5U + kThreads * 16U, stats.acquired_);
+  EXPECT_EQ(0U, stats.in_use_);
+}
+
+TEST(nigiri, routing_state_pool_results) {
+  auto tt = n::timetable{};
+  tt.date_range_ = {date::sys_days{2019_y / May / 1},
+                    date::sys_days{2019_y / May / 2}};
+  n::loader::register_special_stations(tt);
+  n::loader::gtfs::load_timetable({}, n::source_idx_t{0},
+                                  n::loader::mem_dir::read(test_files), tt);
+  n::loader::finalize(tt);
+
+  auto tags = mn::tag_lookup{};
+  tags.add(n::source_idx_t{0U}, "tag_");
+
+  auto const route = [&](mn::routing_state_pool* pool) {
+    return print_response(mn::route(
+        tags, tt, nullptr,
+        mn::make_routing_msg(
+            "tag_A", "tag_D",
+            mn::to_unix(date::sys_days{2019_y / May / 1} + 7h + 50min)),
+        n::profile_idx_t{0U}, pool));
+  };
+
+  auto const reference = route(nullptr);
+  ASSERT_FALSE(reference.empty());
+
+  // High-water mark of 1 byte: every state gets trimmed after each query.
+  auto trimming_pool = mn::routing_state_pool{1U, 1U};
+  auto results = std::vector<std::string>(4U);
+  auto threads = std::vector<std::thread>{};
+  for (auto& r : results) {
+    threads.emplace_back([&]() { r = route(&trimming_pool); });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  for (auto const& r : results) {
+    EXPECT_EQ(reference, r);
+  }
+
+  auto const stats = trimming_pool.get_stats();
+  EXPECT_EQ(1U, stats.created_);
+  EXPECT_EQ(4U, stats.acquired_);
+  EXPECT_EQ(4U, stats.trimmed_ + stats.temporary_);
+  EXPECT_EQ(0U, stats.idle_bytes_);
+}
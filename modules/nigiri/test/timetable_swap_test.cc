@@ -0,0 +1,230 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "date/date.h"
+
+#include "motis/core/journey/journey.h"
+#include "motis/core/journey/message_to_journeys.h"
+#include "motis/core/schedule/station_lookup.h"
+#include "motis/module/context/motis_call.h"
+#include "motis/module/global_res_ids.h"
+#include "motis/module/message.h"
+#include "motis/test/motis_instance_test.h"
+#include "motis/nigiri/location.h"
+#include "motis/nigiri/timetable_version.h"
+
+#include "./utils.h"
+
+using namespace std::chrono_literals;
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+namespace mm = motis::module;
+namespace mn = motis::nigiri;
+
+namespace {
+
+constexpr auto const kAgency =
+    R"(agency_id,agency_name,agency_url,agency_timezone
+DB,Deutsche Bahn,https://deutschebahn.com,Europe/Berlin
+)"sv;
+
+constexpr auto const kRoutes =
+    R"(route_id,agency_id,route_short_name,route_long_name,route_desc,route_type
+R1,DB,1,,,3
+)"sv;
+
+constexpr auto const kTrips =
+    R"(route_id,service_id,trip_id,trip_headsign,block_id
+R1,S1,T1,,
+R1,S1,T2,,
+)"sv;
+
+constexpr auto const kStopsV1 =
+    R"(stop_id,stop_name,stop_desc,stop_lat,stop_lon,stop_url,location_type,parent_station
+A,A,,0.0,1.0,,
+B,B,,2.0,3.0,,
+)"sv;
+
+// Version 1: A -> B at 08:00 and 10:00.
+constexpr auto const kStopTimesV1 =
+    R"(trip_id,arrival_time,departure_time,stop_id,stop_sequence,pickup_type,drop_off_type
+T1,08:00:00,08:00:00,A,0,0,0
+T1,09:00:00,09:00:00,B,1,0,0
+T2,10:00:00,10:00:00,A,0,0,0
+T2,11:00:00,11:00:00,B,1,0,0
+)"sv;
+
+// Version 2: the second trip is 30 minutes later, new stop C.
+constexpr auto const kStopsV2 =
+    R"(stop_id,stop_name,stop_desc,stop_lat,stop_lon,stop_url,location_type,parent_station
+A,A,,0.0,1.0,,
+B,B,,2.0,3.0,,
+C,C,,4.0,5.0,,
+)"sv;
+
+constexpr auto const kStopTimesV2 =
+    R"(trip_id,arrival_time,departure_time,stop_id,stop_sequence,pickup_type,drop_off_type
+T1,08:00:00,08:00:00,A,0,0,0
+T1,09:00:00,09:00:00,B,1,0,0
+T2,10:30:00,10:30:00,A,0,0,0
+T2,11:30:00,11:30:00,B,1,0,0
+)"sv;
+
+// Relative to the first departure: {T1 delay, T2 offset, T2 delay} (s).
+// The GTFS-RT file delays T1 by 10 minutes.
+std::vector<std::int64_t> const kExpectedV1{600, 7200, 0};
+std::vector<std::int64_t> const kExpectedV2{600, 9000, 0};
+
+date::sys_days today() {
+  return std::chrono::time_point_cast<date::days>(
+      std::chrono::system_clock::now());
+}
+
+void write(fs::path const& p, std::string_view content) {
+  std::ofstream{p, std::ios::binary} << content;
+}
+
+fs::path schedule_dir() {
+  return fs::temp_directory_path() /
+         ("motis_nigiri_timetable_swap_test_" + std::to_string(getpid()));
+}
+
+void write_version(fs::path const& dir, std::string_view stops,
+                   std::string_view stop_times) {
+  write(dir / "stops.txt", stops);
+  write(dir / "stop_times.txt", stop_times);
+}
+
+// Writes version 1 and the GTFS-RT file, returns the module options.
+std::vector<std::string> make_schedule() {
+  auto const dir = schedule_dir();
+  fs::create_directories(dir / "gtfs");
+  write(dir / "gtfs" / "agency.txt", kAgency);
+  write(dir / "gtfs" / "routes.txt", kRoutes);
+  write(dir / "gtfs" / "trips.txt", kTrips);
+  write(dir / "gtfs" / "calendar_dates.txt",
+        "service_id,date,exception_type\nS1," +
+            date::format("%Y%m%d", today()) + ",1\n");
+  write_version(dir / "gtfs", kStopsV1, kStopTimesV1);
+
+  auto const rt = mn::to_feed_msg(
+      {mn::trip_update{.trip_id_ = "T1",
+                       .stop_updates_ = {{.stop_id_ = "A",
+                                          .ev_type_ = nigiri::event_type::kDep,
+                                          .delay_minutes_ = 10U}}}},
+      date::sys_seconds{today() + 6h});
+  write(dir / "rt.pb", rt.SerializeAsString());
+
+  return {"--import.paths=schedule-swap:" + (dir / "gtfs").string(),
+          "--nigiri.gtfsrt_paths=swap|" + (dir / "rt.pb").string(),
+          "--nigiri.reload=true"};
+}
+
+mm::msg_ptr make_request() {
+  auto const t = [](auto const h) { return mn::to_unix(today() + h); };
+  return mn::make_pretrip_routing_msg("swap_A", "swap_B", t(0h), t(12h));
+}
+
+std::vector<std::int64_t> summarize(mm::msg_ptr const& msg) {
+  using motis::routing::RoutingResponse;
+  auto deps = std::vector<motis::journey::stop::event_info>{};
+  for (auto const& j :
+       motis::message_to_journeys(motis_content(RoutingResponse, msg))) {
+    deps.emplace_back(j.stops_.front().departure_);
+  }
+  std::sort(begin(deps), end(deps), [](auto const& a, auto const& b) {
+    return a.schedule_timestamp_ < b.schedule_timestamp_;
+  });
+  if (deps.size() != 2U) {
+    return {};
+  }
+  return {deps[0].timestamp_ - deps[0].schedule_timestamp_,
+          deps[1].schedule_timestamp_ - deps[0].schedule_timestamp_,
+          deps[1].timestamp_ - deps[1].schedule_timestamp_};
+}
+
+}  // namespace
+
+struct nigiri_timetable_swap_test : public motis::test::motis_instance_test {
+  nigiri_timetable_swap_test()
+      : motis::test::motis_instance_test({"nigiri"}, make_schedule()) {}
+
+  ~nigiri_timetable_swap_test() override { fs::remove_all(schedule_dir()); }
+
+  motis::lookup_station get_station(std::string_view id) {
+    return instance_
+        ->get<std::shared_ptr<motis::shared_station_lookup>>(
+            mm::to_res_id(mm::global_res_id::STATION_LOOKUP))
+        ->load()
+        ->get(id);
+  }
+
+  std::shared_ptr<mn::timetable_version const> get_version() {
+    return instance_
+        ->get<std::shared_ptr<mn::shared_timetable>>(
+            mm::to_res_id(mm::global_res_id::NIGIRI_TIMETABLE))
+        ->load();
+  }
+
+  mm::msg_ptr reload() { return call(mm::make_no_msg("/nigiri/reload")); }
+};
+
+TEST_F(nigiri_timetable_swap_test, reload) {
+  EXPECT_EQ(kExpectedV1, summarize(call(make_request())));
+  EXPECT_FALSE(get_station("swap_C").valid());
+
+  // Unchanged files: the loaded version stays.
+  reload();
+  EXPECT_EQ(kExpectedV1, summarize(call(make_request())));
+
+  // The GTFS-RT file is replayed onto the new version, the shared
+  // station lookup follows the swap.
+  write_version(schedule_dir() / "gtfs", kStopsV2, kStopTimesV2);
+  reload();
+  EXPECT_EQ(kExpectedV2, summarize(call(make_request())));
+  EXPECT_TRUE(get_station("swap_C").valid());
+
+  // All parts of the shared timetable version belong to the new version.
+  auto const v = get_version();
+  ASSERT_NE(nullptr, v->station_lookup_);
+  EXPECT_TRUE(v->station_lookup_->get("swap_C").valid());
+  auto const c = mn::get_location_idx(*v->tags_, *v->tt_, "swap_C");
+  EXPECT_EQ("swap_C", mn::get_station_id(*v->tags_, *v->tt_, c).view());
+}
+
+TEST_F(nigiri_timetable_swap_test, in_flight_requests) {
+  write_version(schedule_dir() / "gtfs", kStopsV2, kStopTimesV2);
+
+  // Requests started before, during and after the reload each finish on
+  // one complete version.
+  auto results = std::vector<std::vector<std::int64_t>>{};
+  run([&]() {
+    auto futures = std::vector<mm::future>{};
+    for (auto i = 0U; i != 8U; ++i) {
+      futures.emplace_back(motis_call(make_request()));
+    }
+    auto const f_reload = motis_call(mm::make_no_msg("/nigiri/reload"));
+    for (auto i = 0U; i != 8U; ++i) {
+      futures.emplace_back(motis_call(make_request()));
+    }
+    f_reload->val();
+    for (auto const& f : futures) {
+      results.emplace_back(summarize(f->val()));
+    }
+  });
+
+  ASSERT_EQ(16U, results.size());
+  for (auto const& r : results) {
+    EXPECT_TRUE(r == kExpectedV1 || r == kExpectedV2);
+  }
+
+  // The reload job has finished with the run.
+  EXPECT_EQ(kExpectedV2, summarize(call(make_request())));
+}
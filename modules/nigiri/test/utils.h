@@ -113,4 +113,34 @@ inline motis::module::msg_ptr make_routing_msg(std::string_view from,
   return make_msg(fbb);
 }
 
+inline motis::module::msg_ptr make_pretrip_routing_msg(
+    std::string_view from, std::string_view to, std::int64_t const begin,
+    std::int64_t const end, std::string_view cursor = "") {
+  using namespace motis;
+  using flatbuffers::Offset;
+
+  motis::module::message_creator fbb;
+  auto const interval = motis::Interval{begin, end};
+  fbb.create_and_finish(
+      MsgContent_RoutingRequest,
+      CreateRoutingRequest(
+          fbb, motis::routing::Start_PretripStart,
+          CreatePretripStart(
+              fbb,
+              routing::CreateInputStation(fbb, fbb.CreateString(from),
+                                          fbb.CreateString("")),
+              &interval, 0U, false, false)
+              .Union(),
+          routing::CreateInputStation(fbb, fbb.CreateString(to),
+                                      fbb.CreateString("")),
+          routing::SearchType_Default, SearchDir_Forward,
+          fbb.CreateVector(std::vector<Offset<routing::Via>>()),
+          fbb.CreateVector(
+              std::vector<Offset<routing::AdditionalEdgeWrapper>>()),
+          true, true, true, 0, 0, 0, -1, fbb.CreateString(cursor))
+          .Union(),
+      "/nigiri");
+  return make_msg(fbb);
+}
+
 }  // namespace motis::nigiri
@@ -0,0 +1,170 @@
+#include "gtest/gtest.h"
+
+#include "cista/reflection/comparable.h"
+
+#include "utl/erase_if.h"
+#include "utl/helpers/algorithm.h"
+#include "utl/to_vec.h"
+
+#include "nigiri/loader/dir.h"
+#include "nigiri/loader/gtfs/load_timetable.h"
+#include "nigiri/loader/init_finish.h"
+#include "nigiri/timetable.h"
+
+#include "motis/core/journey/journey.h"
+#include "motis/core/journey/message_to_journeys.h"
+#include "motis/nigiri/routing.h"
+#include "motis/nigiri/tag_lookup.h"
+
+#include "./utils.h"
+
+using namespace date;
+using namespace std::chrono_literals;
+namespace n = nigiri;
+namespace mn = motis::nigiri;
+
+namespace {
+
+constexpr auto const kZurich = "tag_8503000:0:41/42";
+constexpr auto const kLenzburg = "tag_8502119:0:3";
+constexpr auto const kAarau = "tag_8502113:0:4";
+
+motis::module::msg_ptr make_via_routing_msg(
+    std::string_view from, std::string_view to, std::int64_t const start,
+    std::vector<std::pair<std::string_view, unsigned>> const& vias,
+    int const max_transfers = -1) {
+  using namespace motis;
+  using flatbuffers::Offset;
+
+  motis::module::message_creator fbb;
+  fbb.create_and_finish(
+      MsgContent_RoutingRequest,
+      CreateRoutingRequest(
+          fbb, motis::routing::Start_OntripStationStart,
+          CreateOntripStationStart(
+              fbb,
+              routing::CreateInputStation(fbb, fbb.CreateString(from),
+                                          fbb.CreateString("")),
+              start)
+              .Union(),
+          routing::CreateInputStation(fbb, fbb.CreateString(to),
+                                      fbb.CreateString("")),
+          routing::SearchType_Default, SearchDir_Forward,
+          fbb.CreateVector(utl::to_vec(
+              vias,
+              [&](auto const& v) {
+                return routing::CreateVia(
+                    fbb,
+                    routing::CreateInputStation(fbb,
+                                                fbb.CreateString(v.first),
+                                                fbb.CreateString("")),
+                    v.second);
+              })),
+          fbb.CreateVector(
+              std::vector<Offset<routing::AdditionalEdgeWrapper>>()),
+          true, true, true, 0, 0, 0, max_transfers)
+          .Union(),
+      "/nigiri");
+  return make_msg(fbb);
+}
+
+struct journey_summary {
+  CISTA_COMPARABLE()
+  std::int64_t dep_;
+  std::int64_t arr_;
+  unsigned transfers_;
+};
+
+std::vector<journey_summary> summarize(
+    std::vector<motis::journey> const& journeys) {
+  auto summaries = utl::to_vec(journeys, [](motis::journey const& j) {
+    return journey_summary{j.stops_.front().departure_.timestamp_,
+                           j.stops_.back().arrival_.timestamp_,
+                           j.transfers_};
+  });
+  std::sort(begin(summaries), end(summaries));
+  return summaries;
+}
+
+std::vector<motis::journey> route(mn::tag_lookup const& tags,
+                                  n::timetable const& tt,
+                                  motis::module::msg_ptr const& msg) {
+  using motis::routing::RoutingResponse;
+  return motis::message_to_journeys(
+      motis_content(RoutingResponse, mn::route(tags, tt, nullptr, msg)));
+}
+
+}  // namespace
+
+TEST(nigiri, via_test) {
+  auto tt = n::timetable{};
+  tt.date_range_ = {date::sys_days{2019_y / June / 24},
+                    date::sys_days{2019_y / June / 27}};
+  n::loader::register_special_stations(tt);
+  n::loader::gtfs::load_timetable(
+      {}, n::source_idx_t{0},
+      *n::loader::make_dir("test/schedule/gtfs_minimal_swiss"), tt);
+  n::loader::finalize(tt);
+
+  auto tags = mn::tag_lookup{};
+  tags.add(n::source_idx_t{0U}, "tag_");
+
+  auto const start = mn::to_unix(date::sys_days{2019_y / June / 24} + 22h);
+  constexpr auto const kStay = 5U;
+
+  // Direct: Zürich HB 01:00 -> Aarau 02:00 (passes Lenzburg 01:52).
+  auto const direct =
+      route(tags, tt, mn::make_routing_msg(kZurich, kAarau, start));
+  ASSERT_FALSE(direct.empty());
+
+  // Via Lenzburg with 5 minutes stay: same train to Lenzburg, continue with
+  // the first train of the morning.
+  auto const via =
+      route(tags, tt,
+            make_via_routing_msg(kZurich, kAarau, start, {{kLenzburg, kStay}}));
+  ASSERT_FALSE(via.empty());
+  EXPECT_NE(summarize(direct), summarize(via));
+
+  // Manually chained queries.
+  auto chained = std::vector<journey_summary>{};
+  for (auto const& first :
+       route(tags, tt, mn::make_routing_msg(kZurich, kLenzburg, start))) {
+    auto const arr = first.stops_.back().arrival_.timestamp_;
+    for (auto const& second :
+         route(tags, tt,
+               mn::make_routing_msg(kLenzburg, kAarau, arr + kStay * 60))) {
+      chained.emplace_back(
+          journey_summary{first.stops_.front().departure_.timestamp_,
+                          second.stops_.back().arrival_.timestamp_,
+                          first.transfers_ + second.transfers_ + 1U});
+    }
+  }
+  std::sort(begin(chained), end(chained));
+  EXPECT_EQ(chained, summarize(via));
+
+  // The via stop is part of every journey with the minimum stay.
+  for (auto const& j : via) {
+    auto const it = utl::find_if(j.stops_, [](motis::journey::stop const& s) {
+      return s.eva_no_ == kLenzburg;
+    });
+    ASSERT_NE(it, end(j.stops_));
+    EXPECT_TRUE(it->exit_);
+    EXPECT_TRUE(it->enter_);
+    EXPECT_GE(it->departure_.timestamp_,
+              it->arrival_.timestamp_ + kStay * 60);
+  }
+
+  // max_transfers limits the whole journey, not each segment.
+  for (auto const limit : {0U, 1U, 2U}) {
+    SCOPED_TRACE(limit);
+    auto expected = summarize(via);
+    utl::erase_if(expected, [&](journey_summary const& s) {
+      return s.transfers_ > limit;
+    });
+    EXPECT_EQ(expected,
+              summarize(route(tags, tt,
+                              make_via_routing_msg(kZurich, kAarau, start,
+                                                   {{kLenzburg, kStay}},
+                                                   static_cast<int>(limit)))));
+  }
+}
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <memory>
+#include <string>
 
+#include "motis/core/common/memory_residency.h"
 #include "motis/module/module.h"
 
 namespace motis::osr {
@@ -24,10 +26,13 @@ struct osr : public motis::module::module {
   motis::module::msg_ptr via(motis::module::msg_ptr const&) const;
   motis::module::msg_ptr ppr(motis::module::msg_ptr const&) const;
 
+  residency_mode get_residency_mode() const;
+
   bool import_successful() const override { return import_successful_; }
 
   bool import_successful_{false};
-  bool lock_{true};
+  std::string residency_;  // empty: "lock" or none
+  std::string lock_;  // deprecated: true = residency lock, false = none
 
   struct impl;
   std::unique_ptr<impl> impl_;
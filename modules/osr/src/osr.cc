@@ -1,9 +1,13 @@
 #include "motis/osr/osr.h"
 
+#include <algorithm>
 #include <filesystem>
+#include <span>
 
 #include "boost/thread/tss.hpp"
 
+#include "geo/latlng.h"
+
 #include "utl/to_vec.h"
 
 #include "cista/reflection/comparable.h"
@@ -17,6 +21,7 @@
 #include "osr/ways.h"
 
 #include "motis/core/common/logging.h"
+#include "motis/core/common/timing.h"
 #include "motis/core/conv/position_conv.h"
 #include "motis/module/context/motis_spawn.h"
 #include "motis/module/event_collector.h"
@@ -30,6 +35,32 @@ namespace motis::osr {
 
 constexpr auto const kMaxDist = o::cost_t{3600U};  // = 1h
 
+using path_future_t = ctx::future_ptr<mm::ctx_data, std::optional<o::path>>;
+
+// Paths of backward searches are reconstructed starting at the search start
+// (= the end of the walk). Reversed, the polyline runs in walking direction.
+flatbuffers::Offset<Polyline> to_polyline(
+    mm::message_creator& fbb, std::span<o::path const> paths,
+    o::direction const dir = o::direction::kForward) {
+  auto points = std::vector<geo::latlng>{};
+  for (auto const& p : paths) {
+    for (auto const& s : p.segments_) {
+      points.insert(end(points), begin(s.polyline_), end(s.polyline_));
+    }
+  }
+  if (dir == o::direction::kBackward) {
+    std::reverse(begin(points), end(points));
+  }
+
+  auto doubles = std::vector<double>{};
+  doubles.reserve(points.size() * 2U);
+  for (auto const& x : points) {
+    doubles.emplace_back(x.lat());
+    doubles.emplace_back(x.lng());
+  }
+  return CreatePolyline(fbb, fbb.CreateVector(doubles.data(), doubles.size()));
+}
+
 struct import_state {
   CISTA_COMPARABLE()
 
@@ -39,8 +70,9 @@ struct import_state {
 };
 
 struct osr::impl {
-  impl(std::unique_ptr<o::ways> w, std::unique_ptr<o::lookup> l)
-      : w_{std::move(w)}, l_{std::move(l)} {}
+  impl(std::unique_ptr<o::ways> w, std::unique_ptr<o::lookup> l,
+       std::unique_ptr<memory_residency> residency)
+      : w_{std::move(w)}, l_{std::move(l)}, residency_{std::move(residency)} {}
 
   template <typename Profile>
   o::dijkstra<Profile>& get_dijkstra() {
@@ -53,10 +85,13 @@ struct osr::impl {
 
   std::unique_ptr<o::ways> w_;
   std::unique_ptr<o::lookup> l_;
+  std::unique_ptr<memory_residency> residency_;
 };
 
 osr::osr() : module("Open Street Router", "osr") {
-  param(lock_, "lock", "mlock routing data into RAM");
+  param(residency_, "residency",
+        "routing data residency: none (default) | prefetch | lock (mlock)");
+  param(lock_, "lock", "deprecated, use residency: true = lock, false = none");
 }
 
 osr::~osr() noexcept = default;
@@ -187,51 +222,68 @@ mm::msg_ptr osr::via(mm::msg_ptr const& msg) const {
   using osrm::OSRMViaRouteRequest;
   auto const req = motis_content(OSRMViaRouteRequest, msg);
 
-  utl::verify(req->waypoints()->size() == 2U, "no via points supported");
+  utl::verify(req->waypoints()->size() >= 2U, "not enough waypoints");
 
   auto const profile = o::to_profile(req->profile()->view());
-  auto const from =
-      o::location{from_fbs(req->waypoints()->Get(0)), o::level_t::invalid()};
-  auto const to =
-      o::location{from_fbs(req->waypoints()->Get(1)), o::level_t::invalid()};
-  auto result = std::optional<o::path>{};
   switch (profile) {
     case o::search_profile::kWheelchair:
-      result =
-          o::route(*impl_->w_, *impl_->l_, impl_->get_dijkstra<o::foot<true>>(),
-                   from, to, kMaxDist, o::direction::kForward);
-      break;
     case o::search_profile::kFoot:
-      result = o::route(*impl_->w_, *impl_->l_,
+    case o::search_profile::kBike:
+    case o::search_profile::kCar: break;
+    default: throw utl::fail("not implemented");
+  }
+
+  auto const waypoints = utl::to_vec(*req->waypoints(), [](auto&& x) {
+    return o::location{from_fbs(x), o::level_t::invalid()};
+  });
+  auto const route_leg = [&](o::location const& from, o::location const& to) {
+    switch (profile) {
+      case o::search_profile::kWheelchair:
+        return o::route(*impl_->w_, *impl_->l_,
+                        impl_->get_dijkstra<o::foot<true>>(), from, to,
+                        kMaxDist, o::direction::kForward);
+      case o::search_profile::kFoot:
+        return o::route(*impl_->w_, *impl_->l_,
                         impl_->get_dijkstra<o::foot<false>>(), from, to,
                         kMaxDist, o::direction::kForward);
-      break;
-    case o::search_profile::kBike:
-      result = o::route(*impl_->w_, *impl_->l_, impl_->get_dijkstra<o::bike>(),
+      case o::search_profile::kBike:
+        return o::route(*impl_->w_, *impl_->l_, impl_->get_dijkstra<o::bike>(),
                         from, to, kMaxDist, o::direction::kForward);
-      break;
-    case o::search_profile::kCar:
-      result = o::route(*impl_->w_, *impl_->l_, impl_->get_dijkstra<o::car>(),
+      case o::search_profile::kCar:
+        return o::route(*impl_->w_, *impl_->l_, impl_->get_dijkstra<o::car>(),
                         from, to, kMaxDist, o::direction::kForward);
-      break;
-    default: throw utl::fail("not implemented");
+      default: throw utl::fail("not implemented");
+    }
+  };
+
+  // Legs are independent searches: each job uses the Dijkstra of its thread.
+  auto fut = std::vector<path_future_t>{};
+  for (auto i = 1U; i != waypoints.size(); ++i) {
+    fut.emplace_back(mm::spawn_job(
+        [&, i]() { return route_leg(waypoints[i - 1U], waypoints[i]); }));
   }
 
-  utl::verify(result.has_value(), "no path found");
+  // The jobs reference this stack frame: wait for all of them before a
+  // failed leg may leave it.
+  ctx::await_all(fut);
+  auto results = utl::to_vec(fut, [](path_future_t const& f) {
+    return f->val();
+  });
 
-  auto doubles = std::vector<double>{};
-  for (auto const& s : result->segments_) {
-    for (auto const& p : s.polyline_) {
-      doubles.emplace_back(p.lat());
-      doubles.emplace_back(p.lng());
-    }
+  auto legs = std::vector<o::path>{};
+  auto time = 0;
+  auto dist = 0.0;
+  for (auto& leg : results) {
+    utl::verify(leg.has_value(), "no path found (leg {})", legs.size());
+    time += static_cast<int>(leg->cost_);
+    dist += leg->dist_;
+    legs.emplace_back(std::move(*leg));
   }
+
   mm::message_creator fbb;
   fbb.create_and_finish(
       MsgContent_OSRMViaRouteResponse,
-      osrm::CreateOSRMViaRouteResponse(
-          fbb, static_cast<int>(result->cost_), result->dist_,
-          CreatePolyline(fbb, fbb.CreateVector(doubles.data(), doubles.size())))
+      osrm::CreateOSRMViaRouteResponse(fbb, time, dist, to_polyline(fbb, legs))
           .Union());
   return make_msg(fbb);
 }
@@ -245,44 +297,40 @@ mm::msg_ptr osr::ppr(mm::msg_ptr const& msg) const {
   auto const req = motis_content(FootRoutingRequest, msg);
   mm::message_creator fbb;
   if (req->include_path()) {
+    auto const start =
+        o::location{from_fbs(req->start()), o::level_t::invalid()};
+    auto const dests = utl::to_vec(*req->destinations(), [](auto&& x) {
+      return o::location{from_fbs(x), o::level_t::invalid()};
+    });
+    auto const dir = req->search_direction() == SearchDir_Forward
+                         ? o::direction::kForward
+                         : o::direction::kBackward;
+
+    // One search from the start reconstructs the paths to all destinations.
+    auto const paths =
+        o::route(*impl_->w_, *impl_->l_, impl_->get_dijkstra<o::foot<false>>(),
+                 start, dests, kMaxDist, dir);
+
     fbb.create_and_finish(
         MsgContent_FootRoutingResponse,
         ppr::CreateFootRoutingResponse(
             fbb,
             fbb.CreateVector(utl::to_vec(
-                *req->destinations(),
-                [&](Position const* dest) {
-                  mm::message_creator req_fbb;
-                  auto const from_to = std::array<Position, 2>{
-                      // NOLINTNEXTLINE(clang-analyzer-core.NonNullParamChecker)
-                      req->search_direction() == SearchDir_Forward
-                          ? *req->start()
-                          : *dest,
-                      // NOLINTNEXTLINE(clang-analyzer-core.NonNullParamChecker)
-                      req->search_direction() == SearchDir_Forward
-                          ? *dest
-                          : *req->start()};
-                  req_fbb.create_and_finish(
-                      MsgContent_OSRMViaRouteRequest,
-                      osrm::CreateOSRMViaRouteRequest(
-                          req_fbb, req_fbb.CreateString("foot"),
-                          req_fbb.CreateVectorOfStructs(from_to.data(), 2U))
-                          .Union());
-                  auto const res_msg = via(make_msg(req_fbb));
-                  auto const res = motis_content(OSRMViaRouteResponse, res_msg);
-                  return ppr::CreateRoutes(
-                      fbb,
-                      fbb.CreateVector(std::vector{ppr::CreateRoute(
-                          fbb, res->distance(), res->time() / 60.0,
-                          res->time() / 60.0, 0.0, 0U, 0.0, 0.0, req->start(),
-                          dest,
-                          fbb.CreateVector(
-                              std::vector<
-                                  flatbuffers::Offset<ppr::RouteStep>>{}),
-                          fbb.CreateVector(
-                              std::vector<flatbuffers::Offset<ppr::Edge>>{}),
-                          motis_copy_table(Polyline, fbb, res->polyline()), 0,
-                          0)}));
+                paths,
+                [&, i = 0U](std::optional<o::path> const& p) mutable {
+                  auto const dest = req->destinations()->Get(i++);
+                  auto routes = std::vector<flatbuffers::Offset<ppr::Route>>{};
+                  if (p.has_value()) {
+                    routes.emplace_back(ppr::CreateRoute(
+                        fbb, p->dist_, p->cost_ / 60.0, p->cost_ / 60.0, 0.0,
+                        0U, 0.0, 0.0, req->start(), dest,
+                        fbb.CreateVector(
+                            std::vector<flatbuffers::Offset<ppr::RouteStep>>{}),
+                        fbb.CreateVector(
+                            std::vector<flatbuffers::Offset<ppr::Edge>>{}),
+                        to_polyline(fbb, {&*p, 1U}, dir), 0, 0));
+                  }
+                  return ppr::CreateRoutes(fbb, fbb.CreateVector(routes));
                 })))
             .Union());
   } else {
@@ -325,6 +373,23 @@ mm::msg_ptr osr::ppr(mm::msg_ptr const& msg) const {
   return make_msg(fbb);
 }
 
+residency_mode osr::get_residency_mode() const {
+  if (!residency_.empty()) {
+    return to_residency_mode(residency_);
+  } else if (lock_.empty()) {
+    return residency_mode::kNone;
+  }
+
+  LOG(logging::warn) << "osr.lock is deprecated, use osr.residency";
+  if (lock_ == "true" || lock_ == "1" || lock_ == "yes" || lock_ == "on") {
+    return residency_mode::kLock;
+  } else if (lock_ == "false" || lock_ == "0" || lock_ == "no" ||
+             lock_ == "off") {
+    return residency_mode::kNone;
+  }
+  throw utl::fail("invalid osr.lock value {} (true|false)", lock_);
+}
+
 void osr::import(mm::import_dispatcher& reg) {
   std::make_shared<mm::event_collector>(
       get_data_directory().generic_string(), "osr", reg,
@@ -346,7 +411,21 @@ void osr::import(mm::import_dispatcher& reg) {
 
         auto w = std::make_unique<o::ways>(dir, cista::mmap::protection::READ);
         auto l = std::make_unique<o::lookup>(*w);
-        impl_ = std::make_unique<impl>(std::move(w), std::move(l));
+
+        MOTIS_START_TIMING(residency_timing);
+        auto residency =
+            std::make_unique<memory_residency>(get_residency_mode());
+        residency->add(dir);
+        MOTIS_STOP_TIMING(residency_timing);
+        LOG(logging::info) << "osr memory residency "
+                           << to_str(residency->requested_mode_) << ": "
+                           << residency->bytes_locked_ << " bytes locked, "
+                           << residency->bytes_prefetched_
+                           << " bytes prefetched in "
+                           << MOTIS_TIMING_MS(residency_timing) << "ms";
+
+        impl_ = std::make_unique<impl>(std::move(w), std::move(l),
+                                       std::move(residency));
 
         import_successful_ = true;
 
@@ -0,0 +1,227 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "osmium/builder/attr.hpp"
+#include "osmium/io/pbf_output.hpp"
+#include "osmium/io/writer.hpp"
+#include "osmium/memory/buffer.hpp"
+
+#include "utl/to_vec.h"
+
+#include "motis/module/message.h"
+#include "motis/test/motis_instance_test.h"
+
+namespace fs = std::filesystem;
+namespace mm = motis::module;
+using namespace motis;
+using motis::osrm::OSRMViaRouteResponse;
+using motis::ppr::FootRoutingResponse;
+
+namespace {
+
+fs::path test_dir() {
+  return fs::temp_directory_path() /
+         ("motis_osr_ppr_test_" + std::to_string(getpid()));
+}
+
+// Comb of footways: a main street (west -> east) with side streets to the
+// north. Every node is reached by exactly one shortest path.
+constexpr auto const kLat = 49.0;
+constexpr auto const kLng = 8.0;
+constexpr auto const kStep = 0.001;
+
+Position side_street_node(int const street, int const i) {
+  return {kLat + kStep * i, kLng + kStep * 2 * street};
+}
+
+std::vector<std::string> make_osm() {
+  using namespace osmium::builder::attr;  // NOLINT
+
+  auto const dir = test_dir();
+  fs::create_directories(dir / "data");
+
+  auto buf = osmium::memory::Buffer{1024U * 1024U,
+                                    osmium::memory::Buffer::auto_grow::yes};
+  auto id = osmium::object_id_type{0};
+  auto const add_node = [&](Position const& p) {
+    osmium::builder::add_node(buf, _id(++id),
+                              _location(osmium::Location{p.lng(), p.lat()}));
+    return id;
+  };
+
+  auto main_street = std::vector<osmium::object_id_type>{};
+  auto side_streets = std::vector<std::vector<osmium::object_id_type>>{};
+  for (auto street = 0; street != 4; ++street) {
+    main_street.emplace_back(add_node(side_street_node(street, 0)));
+    main_street.emplace_back(add_node(
+        {kLat, kLng + kStep * (2 * street + 1)}));  // between side streets
+    auto& side = side_streets.emplace_back();
+    side.emplace_back(main_street[main_street.size() - 2U]);
+    for (auto i = 1; i != 4; ++i) {
+      side.emplace_back(add_node(side_street_node(street, i)));
+    }
+  }
+
+  auto way_id = osmium::object_id_type{1000};
+  osmium::builder::add_way(buf, _id(way_id++), _tag("highway", "footway"),
+                           _nodes(main_street));
+  for (auto const& side : side_streets) {
+    osmium::builder::add_way(buf, _id(way_id++), _tag("highway", "footway"),
+                             _nodes(side));
+  }
+
+  auto writer = osmium::io::Writer{(dir / "test.osm.pbf").string(),
+                                   osmium::io::overwrite::allow};
+  writer(std::move(buf));
+  writer.close();
+
+  return {"--import.paths=osm:" + (dir / "test.osm.pbf").string(),
+          "--import.data_dir=" + (dir / "data").string()};
+}
+
+std::vector<double> coordinates(Polyline const* p) {
+  return {p->coordinates()->begin(), p->coordinates()->end()};
+}
+
+}  // namespace
+
+struct osr_ppr_test : public motis::test::motis_instance_test {
+  osr_ppr_test() : motis::test::motis_instance_test({"osr"}, make_osm()) {}
+
+  ~osr_ppr_test() override { fs::remove_all(test_dir()); }
+
+  static mm::msg_ptr make_ppr_request(Position const& start,
+                                      std::vector<Position> const& dests,
+                                      SearchDir const dir) {
+    mm::message_creator fbb;
+    fbb.create_and_finish(
+        MsgContent_FootRoutingRequest,
+        ppr::CreateFootRoutingRequest(
+            fbb, &start, fbb.CreateVectorOfStructs(dests.data(), dests.size()),
+            0, dir, false, false, true)
+            .Union(),
+        "/ppr/route");
+    return make_msg(fbb);
+  }
+
+  // Previous implementation: one point-to-point search per destination.
+  mm::msg_ptr route_via(Position const& from, Position const& to) {
+    return route_via({from, to});
+  }
+
+  mm::msg_ptr route_via(std::vector<Position> const& waypoints) {
+    mm::message_creator fbb;
+    fbb.create_and_finish(
+        MsgContent_OSRMViaRouteRequest,
+        osrm::CreateOSRMViaRouteRequest(
+            fbb, fbb.CreateString("foot"),
+            fbb.CreateVectorOfStructs(waypoints.data(), waypoints.size()))
+            .Union(),
+        "/osrm/via");
+    return call(make_msg(fbb));
+  }
+};
+
+TEST_F(osr_ppr_test, paths_match_point_to_point_search) {
+  auto const start = Position{kLat - 0.0001, kLng + 0.0001};
+  auto dests = std::vector<Position>{};
+  for (auto street = 0; street != 4; ++street) {
+    for (auto i = 1; i != 4; ++i) {
+      dests.emplace_back(side_street_node(street, i));
+    }
+  }
+  auto const unreachable = Position{kLat + 1.0, kLng + 1.0};
+  dests.emplace_back(unreachable);
+
+  for (auto const dir : {SearchDir_Forward, SearchDir_Backward}) {
+    auto const res_msg = call(make_ppr_request(start, dests, dir));
+    auto const res = motis_content(FootRoutingResponse, res_msg);
+    ASSERT_EQ(dests.size(), res->routes()->size());
+
+    // Backward: the path runs from the destination to the start.
+    for (auto i = 0U; i != dests.size() - 1U; ++i) {
+      auto const via_msg = dir == SearchDir_Forward
+                               ? route_via(start, dests[i])
+                               : route_via(dests[i], start);
+      auto const via = motis_content(OSRMViaRouteResponse, via_msg);
+
+      auto const routes = res->routes()->Get(i)->routes();
+      ASSERT_EQ(1U, routes->size());
+      auto const r = routes->Get(0);
+      EXPECT_DOUBLE_EQ(via->time() / 60.0, r->duration_exact());
+      EXPECT_DOUBLE_EQ(via->distance(), r->distance());
+      EXPECT_EQ(coordinates(via->polyline()), coordinates(r->path()));
+    }
+
+    // Unreachable destinations get no route instead of failing the request.
+    EXPECT_EQ(0U, res->routes()->Get(dests.size() - 1U)->routes()->size());
+  }
+}
+
+TEST_F(osr_ppr_test, via_matches_chained_point_to_point_searches) {
+  auto const waypoints = std::vector<Position>{
+      {kLat - 0.0001, kLng + 0.0001}, side_street_node(2, 3),
+      side_street_node(0, 2), side_street_node(3, 1), side_street_node(3, 3)};
+
+  auto time = 0;
+  auto dist = 0.0;
+  auto polyline = std::vector<double>{};
+  for (auto i = 1U; i != waypoints.size(); ++i) {
+    auto const leg_msg = route_via(waypoints[i - 1U], waypoints[i]);
+    auto const leg = motis_content(OSRMViaRouteResponse, leg_msg);
+    time += leg->time();
+    dist += leg->distance();
+    auto const coords = coordinates(leg->polyline());
+    polyline.insert(end(polyline), begin(coords), end(coords));
+  }
+
+  auto const res_msg = route_via(waypoints);
+  auto const res = motis_content(OSRMViaRouteResponse, res_msg);
+  EXPECT_EQ(time, res->time());
+  EXPECT_DOUBLE_EQ(dist, res->distance());
+  EXPECT_EQ(polyline, coordinates(res->polyline()));
+
+  // A leg without path fails the whole request.
+  auto unreachable = waypoints;
+  unreachable.insert(begin(unreachable) + 1, Position{kLat + 1.0, kLng + 1.0});
+  EXPECT_ANY_THROW(route_via(unreachable));
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST_F(osr_ppr_test, DISABLED_via_benchmark) {
+  constexpr auto const kRuns = 200U;
+
+  auto waypoints = std::vector<Position>{{kLat - 0.0001, kLng + 0.0001}};
+  for (auto street = 0; street != 4; ++street) {
+    waypoints.emplace_back(side_street_node(street, 3));
+    waypoints.emplace_back(side_street_node(3 - street, 1));
+  }
+
+  auto const timed = [](auto&& fn) {
+    auto const start = std::chrono::steady_clock::now();
+    for (auto run = 0U; run != kRuns; ++run) {
+      fn();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count() /
+           kRuns;
+  };
+
+  auto const chained_us = timed([&]() {
+    for (auto i = 1U; i != waypoints.size(); ++i) {
+      route_via(waypoints[i - 1U], waypoints[i]);
+    }
+  });
+  auto const via_us = timed([&]() { route_via(waypoints); });
+
+  std::cout << waypoints.size() << " waypoints: chained " << chained_us
+            << "us, via " << via_us << "us\n";
+}
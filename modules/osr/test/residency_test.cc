@@ -0,0 +1,24 @@
+#include "gtest/gtest.h"
+
+#include "motis/osr/osr.h"
+
+using motis::residency_mode;
+
+TEST(osr_residency, deprecated_lock_option) {
+  auto m = motis::osr::osr{};
+  EXPECT_EQ(residency_mode::kNone, m.get_residency_mode());
+
+  m.lock_ = "true";
+  EXPECT_EQ(residency_mode::kLock, m.get_residency_mode());
+  m.lock_ = "false";
+  EXPECT_EQ(residency_mode::kNone, m.get_residency_mode());
+  m.lock_ = "maybe";
+  EXPECT_ANY_THROW(m.get_residency_mode());
+
+  // residency takes precedence over the deprecated option.
+  m.lock_ = "true";
+  m.residency_ = "prefetch";
+  EXPECT_EQ(residency_mode::kPrefetch, m.get_residency_mode());
+  m.residency_ = "none";
+  EXPECT_EQ(residency_mode::kNone, m.get_residency_mode());
+}
@@ -1,5 +1,7 @@
 #include "motis/osrm/router.h"
 
+#include <limits>
+
 #include "osrm/engine_config.hpp"
 #include "osrm/multi_target_parameters.hpp"
 #include "osrm/osrm.hpp"
@@ -10,7 +12,7 @@
 #include "util/json_container.hpp"
 #include "util/json_util.hpp"
 
-#include "utl/to_vec.h"
+#include "utl/verify.h"
 
 #include "motis/osrm/error.h"
 
@@ -23,6 +25,23 @@ using namespace osrm::util::json;
 
 namespace motis::osrm {
 
+namespace {
+
+// The engine only returns json::Object results, the JSON tree is still
+// built. Values are read from it once and written directly into the
+// flatbuffer (no intermediate vector).
+Offset<flatbuffers::Vector<double>> write_numbers(
+    FlatBufferBuilder& fbb, std::vector<json::Value> const& values) {
+  double* out = nullptr;
+  auto const vec = fbb.CreateUninitializedVector(values.size(), &out);
+  for (auto const& v : values) {
+    *out++ = v.get<Number>().value;
+  }
+  return vec;
+}
+
+}  // namespace
+
 struct router::impl {
 public:
   explicit impl(std::string const& path) {
@@ -61,20 +80,25 @@ public:
     Object result;
     osrm_->Table(params, result);
 
-    std::vector<double> durations;
-    for (auto const& duration_row :
-         result.values["durations"].get<Array>().values) {
-      for (auto const& d : duration_row.get<Array>().values) {
-        durations.emplace_back(d.get<Number>().value);
-      }
-    }
+    auto const& rows = result.values["durations"].get<Array>().values;
+    utl::verify(rows.size() == req->from()->size(), "bad table size");
 
     message_creator fbb;
+    double* out = nullptr;
+    auto const durations = fbb.CreateUninitializedVector(
+        req->from()->size() * req->to()->size(), &out);
+    for (auto const& row : rows) {
+      auto const& row_values = row.get<Array>().values;
+      utl::verify(row_values.size() == req->to()->size(), "bad table size");
+      for (auto const& d : row_values) {
+        // unreachable: null
+        *out++ = d.is<Number>() ? d.get<Number>().value
+                                : std::numeric_limits<double>::max();
+      }
+    }
     fbb.create_and_finish(
         MsgContent_OSRMManyToManyResponse,
-        CreateOSRMManyToManyResponse(
-            fbb, fbb.CreateVector(durations.data(), durations.size()))
-            .Union());
+        CreateOSRMManyToManyResponse(fbb, durations).Union());
     return make_msg(fbb);
   }
 
@@ -107,18 +131,19 @@ public:
       throw std::system_error(error::no_routing_response);
     }
 
-    std::vector<Cost> costs;
-    for (auto const& cost : result.values["costs"].get<Array>().values) {
-      auto const& cost_obj = cost.get<Object>();
-      costs.emplace_back(cost_obj.values.at("duration").get<Number>().value,
-                         cost_obj.values.at("distance").get<Number>().value);
-    }
+    auto const& cost_values = result.values["costs"].get<Array>().values;
 
     message_creator fbb;
-    fbb.create_and_finish(
-        MsgContent_OSRMOneToManyResponse,
-        CreateOSRMOneToManyResponse(fbb, fbb.CreateVectorOfStructs(costs))
-            .Union());
+    Cost* out = nullptr;
+    auto const costs =
+        fbb.CreateUninitializedVectorOfStructs(cost_values.size(), &out);
+    for (auto const& cost : cost_values) {
+      auto const& cost_obj = cost.get<Object>().values;
+      *out++ = Cost{cost_obj.at("duration").get<Number>().value,
+                    cost_obj.at("distance").get<Number>().value};
+    }
+    fbb.create_and_finish(MsgContent_OSRMOneToManyResponse,
+                          CreateOSRMOneToManyResponse(fbb, costs).Union());
     return make_msg(fbb);
   }
 
@@ -146,15 +171,14 @@ public:
 
     message_creator mc;
     auto& route = get(all_routes, 0U);
-    auto const& polyline =
-        utl::to_vec(get(route, "geometry").get<Array>().values,
-                    [](auto&& jc) { return jc.template get<Number>().value; });
+    auto const polyline =
+        write_numbers(mc, get(route, "geometry").get<Array>().values);
 
     mc.create_and_finish(MsgContent_OSRMViaRouteResponse,
                          CreateOSRMViaRouteResponse(
                              mc, get(route, "duration").get<Number>().value,
                              get(route, "distance").get<Number>().value,
-                             CreatePolyline(mc, mc.CreateVector(polyline)))
+                             CreatePolyline(mc, polyline))
                              .Union());
     return make_msg(mc);
   }
@@ -178,13 +202,12 @@ public:
     }
 
     message_creator mc;
+    auto const& geometry = result.values["geometry"].get<Array>().values;
     std::vector<Offset<Polyline>> segments;
-    for (auto const& json_polyline :
-         result.values["geometry"].get<Array>().values) {
-      auto const& polyline = utl::to_vec(
-          json_polyline.get<Array>().values,
-          [](auto&& jc) { return jc.template get<Number>().value; });
-      segments.emplace_back(CreatePolyline(mc, mc.CreateVector(polyline)));
+    segments.reserve(geometry.size());
+    for (auto const& json_polyline : geometry) {
+      segments.emplace_back(CreatePolyline(
+          mc, write_numbers(mc, json_polyline.get<Array>().values)));
     }
 
     mc.create_and_finish(MsgContent_OSRMSmoothViaRouteResponse,
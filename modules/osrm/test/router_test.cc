@@ -0,0 +1,303 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "osmium/builder/attr.hpp"
+#include "osmium/io/pbf_output.hpp"
+#include "osmium/io/writer.hpp"
+#include "osmium/memory/buffer.hpp"
+
+#include "osrm/engine_config.hpp"
+#include "osrm/multi_target_parameters.hpp"
+#include "osrm/osrm.hpp"
+#include "osrm/route_parameters.hpp"
+#include "osrm/table_parameters.hpp"
+#include "util/coordinate.hpp"
+#include "util/json_container.hpp"
+
+#include "utl/to_vec.h"
+
+#include "motis/module/message.h"
+#include "motis/test/motis_instance_test.h"
+
+namespace fs = std::filesystem;
+namespace mm = motis::module;
+namespace json = ::osrm::util::json;
+using motis::Position;
+using motis::SearchDir;
+using motis::SearchDir_Backward;
+using motis::SearchDir_Forward;
+using motis::osrm::OSRMManyToManyResponse;
+using motis::osrm::OSRMOneToManyResponse;
+using motis::osrm::OSRMViaRouteResponse;
+
+namespace {
+
+fs::path test_dir() {
+  return fs::temp_directory_path() /
+         ("motis_osrm_router_test_" + std::to_string(getpid()));
+}
+
+// Grid of residential streets.
+constexpr auto const kLat = 49.0;
+constexpr auto const kLng = 8.0;
+constexpr auto const kStep = 0.001;
+constexpr auto const kGrid = 8;
+
+Position grid_pos(double const row, double const col) {
+  return {kLat + kStep * row, kLng + kStep * 1.5 * col};
+}
+
+std::vector<std::string> make_osm() {
+  using namespace osmium::builder::attr;  // NOLINT
+
+  auto const dir = test_dir();
+  fs::create_directories(dir / "data");
+
+  auto buf = osmium::memory::Buffer{1024U * 1024U,
+                                    osmium::memory::Buffer::auto_grow::yes};
+  auto nodes = std::vector<std::vector<osmium::object_id_type>>(kGrid);
+  auto id = osmium::object_id_type{0};
+  for (auto row = 0; row != kGrid; ++row) {
+    for (auto col = 0; col != kGrid; ++col) {
+      auto const p = grid_pos(row, col);
+      osmium::builder::add_node(
+          buf, _id(++id), _location(osmium::Location{p.lng(), p.lat()}));
+      nodes[row].emplace_back(id);
+    }
+  }
+
+  auto way_id = osmium::object_id_type{1000};
+  for (auto i = 0; i != kGrid; ++i) {
+    auto column = std::vector<osmium::object_id_type>{};
+    for (auto row = 0; row != kGrid; ++row) {
+      column.emplace_back(nodes[row][i]);
+    }
+    osmium::builder::add_way(buf, _id(way_id++),
+                             _tag("highway", "residential"), _nodes(nodes[i]));
+    osmium::builder::add_way(buf, _id(way_id++),
+                             _tag("highway", "residential"), _nodes(column));
+  }
+
+  auto writer = osmium::io::Writer{(dir / "test.osm.pbf").string(),
+                                   osmium::io::overwrite::allow};
+  writer(std::move(buf));
+  writer.close();
+
+  return {"--import.paths=osm:" + (dir / "test.osm.pbf").string(),
+          "--import.data_dir=" + (dir / "data").string(),
+          "--osrm.profiles=deps/osrm-backend/profiles/car.lua"};
+}
+
+std::vector<Position> random_positions(std::size_t const n) {
+  auto gen = std::mt19937{42U};
+  auto dist = std::uniform_real_distribution<double>{0.0, kGrid - 1.0};
+  auto positions = std::vector<Position>(n);
+  for (auto& p : positions) {
+    p = grid_pos(dist(gen), dist(gen));
+  }
+  return positions;
+}
+
+::osrm::util::Coordinate to_coord(Position const& p) {
+  return ::osrm::util::FloatCoordinate{::osrm::util::FloatLongitude{p.lng()},
+                                       ::osrm::util::FloatLatitude{p.lat()}};
+}
+
+std::vector<double> numbers(json::Value const& v) {
+  return utl::to_vec(v.get<json::Array>().values, [](json::Value const& x) {
+    return x.get<json::Number>().value;
+  });
+}
+
+// Engine results read through the JSON tree into vectors, as the router
+// did before writing them into the flatbuffers directly.
+struct reference_engine {
+  explicit reference_engine(fs::path const& dataset) {
+    auto config = ::osrm::EngineConfig{};
+    config.storage_config = {dataset.generic_string()};
+    config.use_shared_memory = false;
+    osrm_ = std::make_unique<::osrm::OSRM>(config);
+  }
+
+  std::vector<double> table(std::vector<Position> const& from,
+                            std::vector<Position> const& to) const {
+    auto params = ::osrm::TableParameters{};
+    for (auto const& p : from) {
+      params.sources.emplace_back(params.coordinates.size());
+      params.coordinates.emplace_back(to_coord(p));
+    }
+    for (auto const& p : to) {
+      params.destinations.emplace_back(params.coordinates.size());
+      params.coordinates.emplace_back(to_coord(p));
+    }
+
+    auto result = json::Object{};
+    osrm_->Table(params, result);
+
+    auto durations = std::vector<double>{};
+    auto const& rows = result.values["durations"].get<json::Array>().values;
+    for (auto const& row : rows) {
+      auto const row_durations = numbers(row);
+      durations.insert(end(durations), begin(row_durations),
+                       end(row_durations));
+    }
+    return durations;
+  }
+
+  std::vector<std::pair<double, double>> one_to_many(
+      Position const& one, std::vector<Position> const& many,
+      SearchDir const dir) const {
+    auto params = ::osrm::MultiTargetParameters{};
+    params.forward = dir == SearchDir_Forward;
+    params.coordinates.emplace_back(to_coord(one));
+    for (auto const& p : many) {
+      params.coordinates.emplace_back(to_coord(p));
+    }
+
+    auto result = json::Object{};
+    EXPECT_EQ(::osrm::Status::Ok, osrm_->MultiTarget(params, result));
+    return utl::to_vec(
+        result.values["costs"].get<json::Array>().values,
+        [](json::Value const& c) {
+          auto const& cost = c.get<json::Object>().values;
+          return std::pair{cost.at("duration").get<json::Number>().value,
+                           cost.at("distance").get<json::Number>().value};
+        });
+  }
+
+  std::tuple<double, double, std::vector<double>> via(
+      std::vector<Position> const& waypoints) const {
+    auto params = ::osrm::RouteParameters{};
+    params.geometries = ::osrm::RouteParameters::GeometriesType::CoordVec1D;
+    params.overview = ::osrm::RouteParameters::OverviewType::Full;
+    for (auto const& p : waypoints) {
+      params.coordinates.emplace_back(to_coord(p));
+    }
+
+    auto result = json::Object{};
+    EXPECT_EQ(::osrm::Status::Ok, osrm_->Route(params, result));
+    auto const& routes = result.values["routes"].get<json::Array>().values;
+    auto route = routes.at(0).get<json::Object>();
+    return {route.values["duration"].get<json::Number>().value,
+            route.values["distance"].get<json::Number>().value,
+            numbers(route.values["geometry"])};
+  }
+
+  std::unique_ptr<::osrm::OSRM> osrm_;
+};
+
+}  // namespace
+
+struct osrm_router_test : public motis::test::motis_instance_test {
+  osrm_router_test()
+      : motis::test::motis_instance_test({"osrm"}, make_osm()),
+        reference_{test_dir() / "data" / "osrm" / "car" / "test.osrm"} {}
+
+  ~osrm_router_test() override { fs::remove_all(test_dir()); }
+
+  mm::msg_ptr table(std::vector<Position> const& from,
+                    std::vector<Position> const& to) {
+    mm::message_creator fbb;
+    fbb.create_and_finish(
+        motis::MsgContent_OSRMManyToManyRequest,
+        motis::osrm::CreateOSRMManyToManyRequest(
+            fbb, fbb.CreateString("car"),
+            fbb.CreateVectorOfStructs(from.data(), from.size()),
+            fbb.CreateVectorOfStructs(to.data(), to.size()))
+            .Union(),
+        "/osrm/table");
+    return call(make_msg(fbb));
+  }
+
+  mm::msg_ptr one_to_many(Position const& one,
+                          std::vector<Position> const& many,
+                          SearchDir const dir) {
+    mm::message_creator fbb;
+    fbb.create_and_finish(
+        motis::MsgContent_OSRMOneToManyRequest,
+        motis::osrm::CreateOSRMOneToManyRequest(
+            fbb, fbb.CreateString("car"), dir, &one,
+            fbb.CreateVectorOfStructs(many.data(), many.size()))
+            .Union(),
+        "/osrm/one_to_many");
+    return call(make_msg(fbb));
+  }
+
+  mm::msg_ptr via(std::vector<Position> const& waypoints) {
+    mm::message_creator fbb;
+    fbb.create_and_finish(
+        motis::MsgContent_OSRMViaRouteRequest,
+        motis::osrm::CreateOSRMViaRouteRequest(
+            fbb, fbb.CreateString("car"),
+            fbb.CreateVectorOfStructs(waypoints.data(), waypoints.size()))
+            .Union(),
+        "/osrm/via");
+    return call(make_msg(fbb));
+  }
+
+  reference_engine reference_;
+};
+
+TEST_F(osrm_router_test, responses_match_json_results) {
+  auto const from = random_positions(7U);
+  auto const to = random_positions(11U);
+
+  auto const table_msg = table(from, to);
+  auto const costs = motis_content(OSRMManyToManyResponse, table_msg)->costs();
+  EXPECT_EQ(reference_.table(from, to),
+            std::vector<double>(costs->begin(), costs->end()));
+
+  for (auto const dir : {SearchDir_Forward, SearchDir_Backward}) {
+    auto const res_msg = one_to_many(from[0], to, dir);
+    auto const res = motis_content(OSRMOneToManyResponse, res_msg);
+    EXPECT_EQ(reference_.one_to_many(from[0], to, dir),
+              utl::to_vec(*res->costs(), [](motis::osrm::Cost const* c) {
+                return std::pair{c->duration(), c->distance()};
+              }));
+  }
+
+  auto const waypoints = std::vector<Position>{from[0], to[0], from[1]};
+  auto const via_msg = via(waypoints);
+  auto const res = motis_content(OSRMViaRouteResponse, via_msg);
+  auto const [time, dist, polyline] = reference_.via(waypoints);
+  EXPECT_EQ(static_cast<int>(time), res->time());
+  EXPECT_EQ(dist, res->distance());
+  auto const coords = res->polyline()->coordinates();
+  EXPECT_EQ(polyline, std::vector<double>(coords->begin(), coords->end()));
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST_F(osrm_router_test, DISABLED_table_benchmark) {
+  constexpr auto const kSize = 500U;
+  constexpr auto const kRuns = 5U;
+  auto const from = random_positions(kSize);
+  auto const to = random_positions(kSize);
+
+  auto const timed = [](auto&& fn) {
+    auto const start = std::chrono::steady_clock::now();
+    for (auto run = 0U; run != kRuns; ++run) {
+      fn();
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start)
+               .count() /
+           kRuns;
+  };
+
+  auto const reference_ms = timed([&]() { reference_.table(from, to); });
+  auto const router_ms = timed([&]() { table(from, to); });
+
+  std::cout << kSize << "x" << kSize << " table: JSON to vector "
+            << reference_ms << "ms, /osrm/table " << router_ms << "ms\n";
+}
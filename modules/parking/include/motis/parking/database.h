@@ -14,28 +14,41 @@
 
 #include "motis/ppr/profile_info.h"
 
-#include "motis/parking/dbschema/FootEdges_generated.h"
-
 #include "motis/parking/foot_edge_task.h"
+#include "motis/parking/foot_edges_cache.h"
 #include "motis/parking/parking_lot.h"
 
 namespace motis::parking {
 
-using persistable_foot_edges = typed_flatbuffer<FootEdges>;
+struct foot_edges_entry {
+  persistable_foot_edges foot_edges_;
+  std::vector<std::pair<lookup_station, double>> reachable_stations_;
+};
 
 struct database {
   explicit database(std::string const& path,
                     std::size_t max_size =
                         sizeof(void*) >= 8
                             ? static_cast<std::size_t>(1024) * 1024 * 1024 * 512
-                            : 256 * 1024 * 1024);
+                            : 256 * 1024 * 1024,
+                    std::size_t footedges_cache_size = 0U);
 
   void put_footedges(
       persistable_foot_edges const& fe,
       std::vector<std::pair<lookup_station, double>> const& reachable_stations);
 
-  std::optional<persistable_foot_edges> get_footedges(
-      int32_t parking_id, std::string const& search_profile);
+  // All entries in one write transaction.
+  void put_footedges(std::vector<foot_edges_entry> const&);
+
+  // nullptr if there are no foot edges for this parking lot and profile.
+  foot_edges_cache::entry_ptr get_footedges(int32_t parking_id,
+                                            std::string const& search_profile);
+
+  // Loads foot edges into the cache until it is full.
+  // Returns the number of cached entries.
+  std::size_t prewarm_footedges_cache();
+
+  foot_edges_cache const& footedges_cache() const { return footedges_cache_; }
 
   std::vector<std::size_t> add_parking_lots(
       std::vector<parking_lot>& parking_lots);
@@ -60,9 +73,27 @@ private:
 
   void init();
 
+  void write_footedges(
+      lmdb::txn&, persistable_foot_edges const&,
+      std::vector<std::pair<lookup_station, double>> const& reachable_stations);
+
+  // After commit: a concurrent reader could otherwise cache the old value.
+  void invalidate_footedges_cache(persistable_foot_edges const&);
+
   lmdb::env mutable env_;
-  std::mutex mutex_;
+
+  // Opened once in init(): mdb_dbi_open must not run concurrently with
+  // other transactions, so read paths need no lock.
+  lmdb::txn::dbi parking_lots_db_{};
+  lmdb::txn::dbi osm_parking_lots_db_{};
+  lmdb::txn::dbi parkendd_parking_lots_db_{};
+  lmdb::txn::dbi reachable_stations_db_{};
+  lmdb::txn::dbi footedges_db_{};
+
+  std::mutex write_mutex_;  // LMDB allows one writer, readers never block
   std::int32_t highest_parking_lot_id_{};
+
+  foot_edges_cache footedges_cache_;
 };
 
 }  // namespace motis::parking
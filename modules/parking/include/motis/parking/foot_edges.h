@@ -1,6 +1,9 @@
 #pragma once
 
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "motis/ppr/data.h"
 #include "motis/ppr/profile_info.h"
@@ -11,6 +14,30 @@
 
 namespace motis::parking {
 
+// Computes foot edges on a thread pool while further tasks are added.
+// The parking lots referenced by the tasks must stay alive until finish().
+struct foot_edges_computation {
+  foot_edges_computation(
+      database& db, motis::ppr::ppr_data const& ppr_data,
+      std::map<std::string, motis::ppr::profile_info> const& ppr_profiles,
+      int threads, bool ppr_exact);
+  ~foot_edges_computation();
+
+  foot_edges_computation(foot_edges_computation const&) = delete;
+  foot_edges_computation& operator=(foot_edges_computation const&) = delete;
+  foot_edges_computation(foot_edges_computation&&) = delete;
+  foot_edges_computation& operator=(foot_edges_computation&&) = delete;
+
+  void add(std::vector<foot_edge_task>&& tasks);
+
+  // Waits until all added tasks are computed and written.
+  void finish();
+
+private:
+  struct impl;
+  std::unique_ptr<impl> impl_;
+};
+
 void compute_foot_edges_direct(
     database& db, std::vector<foot_edge_task> const& tasks,
     motis::ppr::ppr_data const& ppr_data,
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include "motis/hash_map.h"
+
+#include "motis/core/common/typed_flatbuffer.h"
+
+#include "motis/parking/dbschema/FootEdges_generated.h"
+
+namespace motis::parking {
+
+using persistable_foot_edges = typed_flatbuffer<FootEdges>;
+
+// LRU cache of foot edges read from the database, keyed by the database key
+// (parking id + search profile). Bounded by the total flatbuffer size.
+// Returned entries stay valid after eviction.
+//
+// Fills race with writes: a value read before a write may arrive after the
+// write's erase(). Readers take generation() before their read transaction,
+// put() drops the value if anything was erased since.
+struct foot_edges_cache {
+  using entry_ptr = std::shared_ptr<persistable_foot_edges const>;
+
+  explicit foot_edges_cache(std::size_t max_size) : max_size_{max_size} {}
+
+  entry_ptr get(std::string_view key);
+
+  std::uint64_t generation() const;
+
+  // Evicts least recently used entries to make room.
+  // Returns false if the entry is larger than the whole cache or an entry
+  // was erased after the given generation was read.
+  bool put(std::string const& key, entry_ptr const& fe,
+           std::uint64_t generation);
+
+  void erase(std::string_view key);
+
+  bool enabled() const { return max_size_ != 0U; }
+  std::size_t max_size() const { return max_size_; }
+  std::size_t size() const;
+  std::size_t entries() const;
+
+  std::atomic_uint64_t hits_{0U};
+  std::atomic_uint64_t misses_{0U};
+
+private:
+  struct entry {
+    std::string key_;
+    entry_ptr foot_edges_;
+  };
+
+  void evict(std::size_t required);
+
+  std::size_t const max_size_;
+  mutable std::mutex mutex_;
+  std::uint64_t generation_{0U};
+  std::size_t size_{0U};
+  std::list<entry> lru_;  // most recently used first
+  mcd::hash_map<std::string, std::list<entry>::iterator> index_;
+};
+
+}  // namespace motis::parking
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -7,6 +8,15 @@
 
 namespace motis::parking {
 
+using parking_lots_callback_t =
+    std::function<void(std::vector<parking_lot>&& /*parking_lots*/)>;
+
+// Passes the parking lots on in batches, in extraction order, while the
+// file is still being read: node parking lots are complete before the way
+// pass starts.
+void extract_osm_parking_lots(std::string const& osm_file,
+                              parking_lots_callback_t const& on_parking_lots);
+
 std::vector<parking_lot> extract_osm_parking_lots(std::string const& osm_file);
 
 }  // namespace motis::parking
@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -42,6 +43,9 @@ private:
   bool ppr_exact_{true};
 
   std::size_t db_max_size_{static_cast<std::size_t>(1024) * 1024 * 1024 * 512};
+  std::size_t footedges_cache_size_{static_cast<std::size_t>(256) * 1024 *
+                                    1024};
+  bool prewarm_footedges_cache_{false};
 
   std::vector<std::string> parkendd_endpoints_;
   unsigned parkendd_update_interval_{300};  // seconds
@@ -50,7 +54,7 @@ private:
   std::unique_ptr<impl> impl_;
   bool import_successful_{false};
   std::map<std::string, ::motis::ppr::profile_info> ppr_profiles_;
-  station_lookup const* stations_{nullptr};
+  std::shared_ptr<shared_station_lookup> stations_;
 };
 
 }  // namespace motis::parking
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
@@ -11,11 +12,15 @@
 #include "motis/hash_map.h"
 #include "motis/hash_set.h"
 
+#include "motis/core/common/atomic_shared_ptr.h"
+
 #include "motis/parking/database.h"
 #include "motis/parking/parking_lot.h"
 
 namespace motis::parking {
 
+// Readers work on immutable snapshots and never block.
+// Writers build a new snapshot next to the current one and swap it in.
 struct parkings {
   explicit parkings(database& db);
 
@@ -29,14 +34,20 @@ struct parkings {
   void set_unavailable_parking_lots(mcd::hash_set<std::int32_t>&& unavailable);
 
 private:
-  void create_rtree();
+  struct snapshot {
+    std::vector<parking_lot> parkings_;
+    geo::point_rtree rtree_;
+    mcd::hash_map<std::string, std::int32_t> parkendd_id_to_parking_lot_id_;
+  };
+
+  static std::shared_ptr<snapshot const> make_snapshot(
+      snapshot const* prev, std::vector<parking_lot> const& parking_lots);
 
-  std::mutex mutex_;
-  geo::point_rtree rtree_;
+  std::mutex write_mutex_;
   database& db_;
-  std::vector<parking_lot> parkings_;
-  mcd::hash_map<std::string, std::int32_t> parkendd_id_to_parking_lot_id_;
-  mcd::hash_set<std::int32_t> unavailable_parking_lots_;
+  atomic_shared_ptr<snapshot const> snapshot_;
+  atomic_shared_ptr<mcd::hash_set<std::int32_t> const>
+      unavailable_parking_lots_;
 };
 
 }  // namespace motis::parking
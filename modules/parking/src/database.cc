@@ -1,12 +1,13 @@
 #include "motis/parking/database.h"
 
-#include <sstream>
+#include <memory>
 #include <string_view>
 #include <variant>
 
 #include "cista/serialization.h"
 
 #include "utl/enumerate.h"
+#include "utl/to_vec.h"
 
 #include "fmt/core.h"
 
@@ -55,19 +56,27 @@ inline std::string_view get_parkendd_parking_lot_key(parking_lot const& lot) {
   return info.id_;
 }
 
-inline std::string serialize_reachable_stations(
+// Binary array of station ID hashes: compared as a whole, never parsed.
+// Timetable independent (unlike station indices).
+inline std::vector<cista::hash_t> serialize_reachable_stations(
     std::vector<std::pair<lookup_station, double>> const& st) {
-  std::stringstream ss;
-  for (auto const& s : st) {
-    ss << s.first.id() << "|";
-  }
-  return ss.str();
+  return utl::to_vec(st, [](auto const& s) { return s.first.hash(); });
+}
+
+inline std::string_view view(std::vector<cista::hash_t> const& v) {
+  return std::string_view{reinterpret_cast<char const*>(v.data()),
+                          v.size() * sizeof(cista::hash_t)};
 }
 
-database::database(std::string const& path, std::size_t const max_size) {
+database::database(std::string const& path, std::size_t const max_size,
+                   std::size_t const footedges_cache_size)
+    : footedges_cache_{footedges_cache_size} {
   env_.set_maxdbs(10);
   env_.set_mapsize(max_size);
-  auto flags = lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOSYNC;
+  // NOTLS: read transactions are not bound to a thread (ctx may resume
+  // operations on another worker)
+  auto flags = lmdb::env_open_flags::NOSUBDIR | lmdb::env_open_flags::NOSYNC |
+               lmdb::env_open_flags::NOTLS;
   env_.open(path.c_str(), flags);
   init();
 }
@@ -75,14 +84,15 @@ database::database(std::string const& path, std::size_t const max_size) {
 void database::init() {
   // create databases
   auto txn = lmdb::txn{env_};
-  auto parking_lots_db = parking_lots_dbi(txn, lmdb::dbi_flags::CREATE);
-  osm_parking_lots_dbi(txn, lmdb::dbi_flags::CREATE);
-  parkendd_parking_lots_dbi(txn, lmdb::dbi_flags::CREATE);
-  reachable_stations_dbi(txn, lmdb::dbi_flags::CREATE);
-  footedges_dbi(txn, lmdb::dbi_flags::CREATE);
+  parking_lots_db_ = parking_lots_dbi(txn, lmdb::dbi_flags::CREATE);
+  osm_parking_lots_db_ = osm_parking_lots_dbi(txn, lmdb::dbi_flags::CREATE);
+  parkendd_parking_lots_db_ =
+      parkendd_parking_lots_dbi(txn, lmdb::dbi_flags::CREATE);
+  reachable_stations_db_ = reachable_stations_dbi(txn, lmdb::dbi_flags::CREATE);
+  footedges_db_ = footedges_dbi(txn, lmdb::dbi_flags::CREATE);
 
   // find highest existing parking lot id
-  auto parking_cur = lmdb::cursor{txn, parking_lots_db};
+  auto parking_cur = lmdb::cursor{txn, parking_lots_db_};
   auto const entry = parking_cur.get(lmdb::cursor_op::LAST);
   if (entry.has_value()) {
     highest_parking_lot_id_ = lmdb::as_int(entry->first);
@@ -97,65 +107,118 @@ void database::init() {
 void database::put_footedges(
     const persistable_foot_edges& fe,
     std::vector<std::pair<lookup_station, double>> const& reachable_stations) {
-  auto lock = std::lock_guard{mutex_};
+  auto lock = std::lock_guard{write_mutex_};
+  auto txn = lmdb::txn{env_};
+  write_footedges(txn, fe, reachable_stations);
+  txn.commit();
+  invalidate_footedges_cache(fe);
+}
+
+void database::put_footedges(std::vector<foot_edges_entry> const& entries) {
+  if (entries.empty()) {
+    return;
+  }
+  auto lock = std::lock_guard{write_mutex_};
   auto txn = lmdb::txn{env_};
-  auto reachable_stations_db = reachable_stations_dbi(txn);
-  auto footedges_db = footedges_dbi(txn);
+  for (auto const& e : entries) {
+    write_footedges(txn, e.foot_edges_, e.reachable_stations_);
+  }
+  txn.commit();
+  for (auto const& e : entries) {
+    invalidate_footedges_cache(e.foot_edges_);
+  }
+}
+
+void database::write_footedges(
+    lmdb::txn& txn, persistable_foot_edges const& fe,
+    std::vector<std::pair<lookup_station, double>> const& reachable_stations) {
   auto const key = get_footedges_db_key(fe.get()->parking_id(),
                                         fe.get()->search_profile()->str());
-  txn.put(footedges_db, key, fe.to_string());
-  txn.put(reachable_stations_db, key,
-          serialize_reachable_stations(reachable_stations));
-  txn.commit();
+  txn.put(footedges_db_, key, fe.to_string_view());
+  txn.put(reachable_stations_db_, key,
+          view(serialize_reachable_stations(reachable_stations)));
+}
+
+void database::invalidate_footedges_cache(persistable_foot_edges const& fe) {
+  footedges_cache_.erase(get_footedges_db_key(
+      fe.get()->parking_id(), fe.get()->search_profile()->str()));
 }
 
-std::optional<persistable_foot_edges> database::get_footedges(
+foot_edges_cache::entry_ptr database::get_footedges(
     int32_t parking_id, std::string const& search_profile) {
-  auto lock = std::lock_guard{mutex_};
-  auto txn = lmdb::txn{env_, lmdb::txn_flags::RDONLY};
-  auto db = footedges_dbi(txn);
   auto const key = get_footedges_db_key(parking_id, search_profile);
-  if (auto const r = txn.get(db, key); !r.has_value()) {
-    return {};
+  if (auto cached = footedges_cache_.get(key); cached != nullptr) {
+    return cached;
+  }
+
+  auto const generation = footedges_cache_.generation();
+  auto txn = lmdb::txn{env_, lmdb::txn_flags::RDONLY};
+  if (auto const r = txn.get(footedges_db_, key); !r.has_value()) {
+    return nullptr;
   } else {
-    return {persistable_foot_edges(*r)};
+    auto fe = std::make_shared<persistable_foot_edges const>(*r);
+    if (footedges_cache_.enabled()) {
+      footedges_cache_.put(key, fe, generation);
+    }
+    return fe;
+  }
+}
+
+std::size_t database::prewarm_footedges_cache() {
+  if (!footedges_cache_.enabled()) {
+    return 0U;
+  }
+
+  auto const generation = footedges_cache_.generation();
+  auto txn = lmdb::txn{env_, lmdb::txn_flags::RDONLY};
+  auto cur = lmdb::cursor{txn, footedges_db_};
+  auto entry = cur.get(lmdb::cursor_op::FIRST);
+  // Stops when the cache is full or at the first concurrent write.
+  while (entry.has_value() &&
+         footedges_cache_.size() + entry->second.size() <=
+             footedges_cache_.max_size() &&
+         footedges_cache_.put(
+             std::string{entry->first},
+             std::make_shared<persistable_foot_edges const>(entry->second),
+             generation)) {
+    entry = cur.get(lmdb::cursor_op::NEXT);
   }
+  cur.reset();
+  return footedges_cache_.entries();
 }
 
 std::vector<std::size_t> database::add_parking_lots(
     std::vector<parking_lot>& parking_lots) {
   auto added_indices = std::vector<std::size_t>{};
-  auto lock = std::lock_guard{mutex_};
+  auto lock = std::lock_guard{write_mutex_};
   auto txn = lmdb::txn{env_};
-  auto parking_lots_db = parking_lots_dbi(txn);
-  auto osm_parking_lots_db = osm_parking_lots_dbi(txn);
-  auto parkendd_parking_lots_db = parkendd_parking_lots_dbi(txn);
 
   auto const store_parking_lot = [&](parking_lot const& lot) {
     auto const serialized_lot = cista::serialize(lot);
-    txn.put(parking_lots_db, lot.id_, view(serialized_lot));
+    txn.put(parking_lots_db_, lot.id_, view(serialized_lot));
   };
 
   for (auto const& [idx, lot] : utl::enumerate(parking_lots)) {
     if (lot.is_from_osm()) {
       auto const osm_key = get_osm_parking_lot_key(lot);
-      if (auto const r = txn.get(osm_parking_lots_db, osm_key); r.has_value()) {
+      if (auto const r = txn.get(osm_parking_lots_db_, osm_key);
+          r.has_value()) {
         lot.id_ = lmdb::as_int(r.value());
       } else {
         lot.id_ = ++highest_parking_lot_id_;
         store_parking_lot(lot);
-        txn.put(osm_parking_lots_db, osm_key, int_view(lot.id_));
+        txn.put(osm_parking_lots_db_, osm_key, int_view(lot.id_));
         added_indices.emplace_back(idx);
       }
     } else if (lot.is_from_parkendd()) {
       auto const parkendd_key = get_parkendd_parking_lot_key(lot);
-      if (auto const r = txn.get(parkendd_parking_lots_db, parkendd_key);
+      if (auto const r = txn.get(parkendd_parking_lots_db_, parkendd_key);
           r.has_value()) {
         lot.id_ = lmdb::as_int(r.value());
       } else {
         lot.id_ = ++highest_parking_lot_id_;
         store_parking_lot(lot);
-        txn.put(parkendd_parking_lots_db, parkendd_key, int_view(lot.id_));
+        txn.put(parkendd_parking_lots_db_, parkendd_key, int_view(lot.id_));
         added_indices.emplace_back(idx);
       }
     }
@@ -167,10 +230,8 @@ std::vector<std::size_t> database::add_parking_lots(
 
 std::vector<parking_lot> database::get_parking_lots() {
   auto parking_lots = std::vector<parking_lot>{};
-  auto lock = std::lock_guard{mutex_};
   auto txn = lmdb::txn{env_, lmdb::txn_flags::RDONLY};
-  auto parking_lots_db = parking_lots_dbi(txn);
-  auto cur = lmdb::cursor{txn, parking_lots_db};
+  auto cur = lmdb::cursor{txn, parking_lots_db_};
   auto entry = cur.get(lmdb::cursor_op::FIRST);
   while (entry.has_value()) {
     parking_lots.emplace_back(
@@ -185,10 +246,7 @@ std::vector<foot_edge_task> database::get_foot_edge_tasks(
     station_lookup const& st, std::vector<parking_lot> const& parking_lots,
     std::map<std::string, motis::ppr::profile_info> const& ppr_profiles) {
   auto tasks = std::vector<foot_edge_task>{};
-  auto lock = std::lock_guard{mutex_};
   auto txn = lmdb::txn{env_, lmdb::txn_flags::RDONLY};
-  auto reachable_stations_db = reachable_stations_dbi(txn);
-  auto footedges_db = footedges_dbi(txn);
 
   for (auto const& [profile_name, pi] : ppr_profiles) {
     auto const& profile = pi.profile_;
@@ -198,11 +256,12 @@ std::vector<foot_edge_task> database::get_foot_edge_tasks(
       auto const key = get_footedges_db_key(pl.id_, profile_name);
       auto task = foot_edge_task{&pl, st.in_radius(pl.location_, walk_radius),
                                  &profile_name};
-      if (auto const sr = txn.get(reachable_stations_db, key); sr.has_value()) {
+      if (auto const sr = txn.get(reachable_stations_db_, key);
+          sr.has_value()) {
         auto const reachable_stations =
             serialize_reachable_stations(task.stations_in_radius_);
-        if (sr.value() == reachable_stations) {
-          if (auto const sf = txn.get(footedges_db, key); sf.has_value()) {
+        if (sr.value() == view(reachable_stations)) {
+          if (auto const sf = txn.get(footedges_db_, key); sf.has_value()) {
             // already in db
             continue;
           }
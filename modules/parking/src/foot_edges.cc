@@ -1,8 +1,13 @@
 #include <cmath>
 #include <algorithm>
+#include <condition_variable>
 #include <functional>
+#include <list>
+#include <mutex>
+#include <memory>
 #include <optional>
 #include <string>
+#include <thread>
 
 #include "utl/progress_tracker.h"
 #include "utl/to_vec.h"
@@ -84,8 +89,8 @@ using route_fn_t = std::function<std::vector<std::vector<foot_edge_info>>(
     std::string const& /*profile_name*/, search_profile const& /*profile*/,
     search_direction /*dir*/)>;
 
-void compute_edges(
-    foot_edge_task const& task, database& db,
+foot_edges_entry compute_edges(
+    foot_edge_task const& task,
     std::map<std::string, motis::ppr::profile_info> const& ppr_profiles,
     bool const ppr_exact, route_fn_t const& route_fn) {
   auto const* lot = task.parking_lot_;
@@ -142,8 +147,153 @@ void compute_edges(
   fbb.Finish(CreateFootEdges(fbb, lot->id_,
                              fbb.CreateString(*task.ppr_profile_),
                              fbs_outward_edges, fbs_return_edges));
-  db.put_footedges(persistable_foot_edges(std::move(fbb)),
-                   task.stations_in_radius_);
+  return {persistable_foot_edges(std::move(fbb)), task.stations_in_radius_};
+}
+
+// Single writer for the worker threads: everything that was computed while
+// the previous batch was written goes into one write transaction.
+// Workers block while max_queued entries are waiting.
+struct foot_edges_writer {
+  explicit foot_edges_writer(database& db, std::size_t const max_queued = 1024U)
+      : db_{db}, max_queued_{max_queued}, thread_{[this]() { run(); }} {}
+
+  foot_edges_writer(foot_edges_writer const&) = delete;
+  foot_edges_writer& operator=(foot_edges_writer const&) = delete;
+  foot_edges_writer(foot_edges_writer&&) = delete;
+  foot_edges_writer& operator=(foot_edges_writer&&) = delete;
+
+  ~foot_edges_writer() {
+    if (thread_.joinable()) {
+      finish();
+    }
+  }
+
+  void push(foot_edges_entry&& e) {
+    {
+      auto lock = std::unique_lock{mutex_};
+      not_full_.wait(lock, [&]() { return queue_.size() < max_queued_; });
+      queue_.emplace_back(std::move(e));
+    }
+    cv_.notify_one();
+  }
+
+  void finish() {
+    {
+      auto const lock = std::lock_guard{mutex_};
+      done_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+  }
+
+  std::size_t batches_{0U};
+
+private:
+  void run() {
+    auto batch = std::vector<foot_edges_entry>{};
+    while (true) {
+      {
+        auto lock = std::unique_lock{mutex_};
+        cv_.wait(lock, [&]() { return done_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        std::swap(batch, queue_);
+      }
+      not_full_.notify_all();
+      db_.put_footedges(batch);
+      ++batches_;
+      batch.clear();
+    }
+  }
+
+  database& db_;
+  std::size_t max_queued_;
+  std::mutex mutex_;
+  std::condition_variable cv_, not_full_;
+  std::vector<foot_edges_entry> queue_;
+  bool done_{false};
+  std::thread thread_;
+};
+
+struct foot_edges_computation::impl {
+  impl(database& db, motis::ppr::ppr_data const& ppr_data,
+       std::map<std::string, motis::ppr::profile_info> const& ppr_profiles,
+       int const threads, bool const ppr_exact)
+      : ppr_data_{ppr_data},
+        ppr_profiles_{ppr_profiles},
+        ppr_exact_{ppr_exact},
+        progress_tracker_{utl::get_active_progress_tracker()},
+        writer_{db},
+        pool_{static_cast<unsigned>(std::max(1, threads))} {
+    progress_tracker_->reset_bounds().in_high(0U);
+  }
+
+  impl(impl const&) = delete;
+  impl& operator=(impl const&) = delete;
+  impl(impl&&) = delete;
+  impl& operator=(impl&&) = delete;
+
+  ~impl() {
+    if (!finished_) {
+      finish();
+    }
+  }
+
+  void add(std::vector<foot_edge_task>&& tasks) {
+    auto const& t = tasks_.emplace_back(std::move(tasks));
+    n_tasks_ += t.size();
+    progress_tracker_->in_high(n_tasks_);
+    auto const route_fn = [&rg = ppr_data_.rg_](
+                              location const& parking_loc,
+                              std::vector<location> const& station_locs,
+                              std::string const& /*profile_name*/,
+                              search_profile const& profile,
+                              search_direction const dir) {
+      return route_ppr_direct(rg, parking_loc, station_locs, profile, dir);
+    };
+    for (auto const& task : t) {
+      pool_.post([&, &task = task, route_fn] {
+        progress_tracker_->increment();
+        writer_.push(compute_edges(task, ppr_profiles_, ppr_exact_, route_fn));
+      });
+    }
+  }
+
+  void finish() {
+    finished_ = true;
+    pool_.join();
+    writer_.finish();
+  }
+
+  motis::ppr::ppr_data const& ppr_data_;
+  std::map<std::string, motis::ppr::profile_info> const& ppr_profiles_;
+  bool ppr_exact_;
+  utl::progress_tracker_ptr progress_tracker_;
+  std::list<std::vector<foot_edge_task>> tasks_;  // stable for pool jobs
+  std::size_t n_tasks_{0U};
+  foot_edges_writer writer_;
+  thread_pool pool_;
+  bool finished_{false};
+};
+
+foot_edges_computation::foot_edges_computation(
+    database& db, motis::ppr::ppr_data const& ppr_data,
+    std::map<std::string, motis::ppr::profile_info> const& ppr_profiles,
+    int const threads, bool const ppr_exact)
+    : impl_{std::make_unique<impl>(db, ppr_data, ppr_profiles, threads,
+                                   ppr_exact)} {}
+
+foot_edges_computation::~foot_edges_computation() = default;
+
+void foot_edges_computation::add(std::vector<foot_edge_task>&& tasks) {
+  impl_->add(std::move(tasks));
+}
+
+void foot_edges_computation::finish() {
+  impl_->finish();
+  LOG(info) << "Foot edges precomputed (" << impl_->n_tasks_ << " tasks, "
+            << impl_->writer_.batches_ << " write transactions).";
 }
 
 void compute_foot_edges_direct(
@@ -155,25 +305,10 @@ void compute_foot_edges_direct(
 
   scoped_timer const timer{"Computing foot edges"};
 
-  auto progress_tracker = utl::get_active_progress_tracker();
-  progress_tracker->reset_bounds().in_high(tasks.size());
-  thread_pool pool{static_cast<unsigned>(std::max(1, threads))};
-  auto const route_fn = [&](location const& parking_loc,
-                            std::vector<location> const& station_locs,
-                            std::string const& /*profile_name*/,
-                            search_profile const& profile,
-                            search_direction const dir) {
-    return route_ppr_direct(ppr_data.rg_, parking_loc, station_locs, profile,
-                            dir);
-  };
-  for (auto const& t : tasks) {
-    pool.post([&, &t = t] {
-      progress_tracker->increment();
-      compute_edges(t, db, ppr_profiles, ppr_exact, route_fn);
-    });
-  }
-  pool.join();
-  LOG(info) << "Foot edges precomputed.";
+  auto computation =
+      foot_edges_computation{db, ppr_data, ppr_profiles, threads, ppr_exact};
+  computation.add(std::vector<foot_edge_task>{tasks});
+  computation.finish();
 }
 
 void compute_foot_edges_via_module(
@@ -190,7 +325,8 @@ void compute_foot_edges_via_module(
                             dir);
   };
   motis_parallel_for(tasks, [&](foot_edge_task const& task) {
-    compute_edges(task, db, ppr_profiles, ppr_exact, route_fn);
+    auto const e = compute_edges(task, ppr_profiles, ppr_exact, route_fn);
+    db.put_footedges(e.foot_edges_, e.reachable_stations_);
   });
 }
 
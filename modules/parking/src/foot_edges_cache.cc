@@ -0,0 +1,75 @@
+#include "motis/parking/foot_edges_cache.h"
+
+namespace motis::parking {
+
+foot_edges_cache::entry_ptr foot_edges_cache::get(std::string_view key) {
+  if (!enabled()) {
+    return nullptr;
+  }
+  auto const lock = std::lock_guard{mutex_};
+  auto const it = index_.find(key);
+  if (it == end(index_)) {
+    ++misses_;
+    return nullptr;
+  }
+  ++hits_;
+  lru_.splice(begin(lru_), lru_, it->second);
+  return it->second->foot_edges_;
+}
+
+std::uint64_t foot_edges_cache::generation() const {
+  auto const lock = std::lock_guard{mutex_};
+  return generation_;
+}
+
+bool foot_edges_cache::put(std::string const& key, entry_ptr const& fe,
+                           std::uint64_t const generation) {
+  if (fe->size() > max_size_) {
+    return false;
+  }
+  auto const lock = std::lock_guard{mutex_};
+  if (generation != generation_) {
+    return false;
+  }
+  if (auto const it = index_.find(key); it != end(index_)) {
+    size_ -= it->second->foot_edges_->size();
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+  evict(fe->size());
+  lru_.push_front(entry{key, fe});
+  index_[key] = begin(lru_);
+  size_ += fe->size();
+  return true;
+}
+
+void foot_edges_cache::erase(std::string_view key) {
+  auto const lock = std::lock_guard{mutex_};
+  ++generation_;
+  if (auto const it = index_.find(key); it != end(index_)) {
+    size_ -= it->second->foot_edges_->size();
+    lru_.erase(it->second);
+    index_.erase(it);
+  }
+}
+
+void foot_edges_cache::evict(std::size_t const required) {
+  while (!lru_.empty() && size_ + required > max_size_) {
+    auto const& last = lru_.back();
+    size_ -= last.foot_edges_->size();
+    index_.erase(last.key_);
+    lru_.pop_back();
+  }
+}
+
+std::size_t foot_edges_cache::size() const {
+  auto const lock = std::lock_guard{mutex_};
+  return size_;
+}
+
+std::size_t foot_edges_cache::entries() const {
+  auto const lock = std::lock_guard{mutex_};
+  return lru_.size();
+}
+
+}  // namespace motis::parking
@@ -1,5 +1,6 @@
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <string_view>
 
 #include "osmium/area/assembler.hpp"
@@ -38,8 +39,8 @@ osmium::geom::Coordinates calc_center(osmium::NodeRefList const& nr_list) {
 
 class parking_handler : public osmium::handler::Handler {
 public:
-  explicit parking_handler(std::vector<parking_lot>& parking_lots)
-      : parking_lots_{parking_lots} {}
+  explicit parking_handler(parking_lots_callback_t const& on_parking_lots)
+      : on_parking_lots_{on_parking_lots} {}
 
   void node(osmium::Node const& node) {
     auto const& tags = node.tags();
@@ -48,6 +49,14 @@ public:
     }
   }
 
+  // Nodes come first: node parking lots are complete before the first way.
+  void way(osmium::Way const&) {
+    if (!nodes_done_) {
+      nodes_done_ = true;
+      flush();
+    }
+  }
+
   void area(osmium::Area const& area) {
     auto const& tags = area.tags();
     if (tags.has_tag("amenity", "parking")) {
@@ -57,6 +66,16 @@ public:
     }
   }
 
+  void flush() {
+    if (!parking_lots_.empty()) {
+      count_ += parking_lots_.size();
+      on_parking_lots_(std::move(parking_lots_));
+      parking_lots_ = {};
+    }
+  }
+
+  std::size_t count_{0U};
+
 private:
   void add_parking(osm_type const ot, osmium::object_id_type const id,
                    osmium::geom::Coordinates const& coord,
@@ -67,6 +86,9 @@ private:
     parking_lots_.emplace_back(parking_lot{
         0, geo::latlng{coord.y, coord.x},
         parking_lot::info_t{osm_parking_lot_info{id, ot, get_fee_type(tags)}}});
+    if (parking_lots_.size() >= kBatchSize) {
+      flush();
+    }
   }
 
   static inline fee_type get_fee_type(osmium::TagList const& tags) {
@@ -91,10 +113,15 @@ private:
            strcmp(access, "public") == 0;
   }
 
-  std::vector<parking_lot>& parking_lots_;
+  static constexpr auto const kBatchSize = std::size_t{10'000U};
+
+  parking_lots_callback_t const& on_parking_lots_;
+  std::vector<parking_lot> parking_lots_;
+  bool nodes_done_{false};
 };
 
-std::vector<parking_lot> extract_osm_parking_lots(std::string const& osm_file) {
+void extract_osm_parking_lots(std::string const& osm_file,
+                              parking_lots_callback_t const& on_parking_lots) {
   scoped_timer const timer("Extracting OSM parking lot data");
 
   osmium::io::File const input_file{osm_file};
@@ -109,8 +136,7 @@ std::vector<parking_lot> extract_osm_parking_lots(std::string const& osm_file) {
 
   index_type index;
   location_handler_type location_handler{index};
-  std::vector<parking_lot> parking_lots;
-  parking_handler data_handler{parking_lots};
+  parking_handler data_handler{on_parking_lots};
 
   std::clog << "Extract OSM parking lots: Pass 2..." << '\n';
   osmium::io::Reader reader{input_file, osmium::io::read_meta::no};
@@ -121,10 +147,19 @@ std::vector<parking_lot> extract_osm_parking_lots(std::string const& osm_file) {
                     }));
 
   reader.close();
+  data_handler.flush();
 
-  std::clog << "Extracted " << parking_lots.size() << " parking lots from OSM"
-            << '\n';
+  std::clog << "Extracted " << data_handler.count_
+            << " parking lots from OSM" << '\n';
+}
 
+std::vector<parking_lot> extract_osm_parking_lots(std::string const& osm_file) {
+  auto parking_lots = std::vector<parking_lot>{};
+  extract_osm_parking_lots(osm_file, [&](std::vector<parking_lot>&& batch) {
+    parking_lots.insert(end(parking_lots),
+                        std::make_move_iterator(begin(batch)),
+                        std::make_move_iterator(end(batch)));
+  });
   return parking_lots;
 }
 
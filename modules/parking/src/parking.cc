@@ -3,8 +3,10 @@
 #include <cmath>
 #include <filesystem>
 #include <limits>
+#include <list>
 #include <map>
 #include <string>
+#include <thread>
 
 #include "utl/get_or_create.h"
 #include "utl/progress_tracker.h"
@@ -177,21 +179,30 @@ Offset<Route> find_matching_ppr_route(FootRoutingResponse const* ppr_resp,
 
 struct parking::impl {
   explicit impl(
-      station_lookup const& st, std::string const& db_file,
-      std::size_t db_max_size, std::vector<std::string>& parkendd_endpoints,
+      std::shared_ptr<shared_station_lookup> st, std::string const& db_file,
+      std::size_t db_max_size, std::size_t footedges_cache_size,
+      std::vector<std::string>& parkendd_endpoints,
       unsigned parkendd_update_interval,
       std::map<std::string, ::motis::ppr::profile_info> const& ppr_profiles,
       bool const ppr_exact)
-      : db_{db_file, db_max_size},
+      : db_{db_file, db_max_size, footedges_cache_size},
         parkings_{db_},
         parkendd_endpoints_{parkendd_endpoints},
         parkendd_update_interval_{parkendd_update_interval},
         db_ppr_profiles_{ppr_profiles},
-        stations_{st},
+        stations_{std::move(st)},
         ppr_exact_{ppr_exact} {}
 
-  void init(dispatcher& d) {
+  void init(dispatcher& d, bool const prewarm_footedges_cache) {
     update_ppr_profiles();
+    if (prewarm_footedges_cache) {
+      MOTIS_START_TIMING(prewarm_timing);
+      auto const n = db_.prewarm_footedges_cache();
+      MOTIS_STOP_TIMING(prewarm_timing);
+      LOG(info) << "parking: prewarmed foot edges cache with " << n
+                << " entries (" << db_.footedges_cache().size() << " bytes) in "
+                << MOTIS_TIMING_MS(prewarm_timing) << "ms";
+    }
     if (!parkendd_endpoints_.empty()) {
       d.register_timer("ParkenDD Update",
                        boost::posix_time::seconds{parkendd_update_interval_},
@@ -220,7 +231,8 @@ struct parking::impl {
         auto const new_parking_lots = utl::to_vec(
             new_lot_indices, [&](auto const idx) { return parking_lots[idx]; });
         parkings_.add_parkings(new_parking_lots);
-        auto const tasks = db_.get_foot_edge_tasks(stations_, new_parking_lots,
+        auto const st = stations_->load();  // referenced by the tasks
+        auto const tasks = db_.get_foot_edge_tasks(*st, new_parking_lots,
                                                    db_ppr_profiles_);
         compute_foot_edges_via_module(db_, tasks, db_ppr_profiles_, ppr_exact_);
       }
@@ -365,8 +377,9 @@ struct parking::impl {
     MOTIS_START_TIMING(parking_edges_timing);
     auto const walking_speed = ppr_profiles_.get_walking_speed(
         req->ppr_search_options()->profile()->str());
+    auto const st = stations_->load();  // referenced by the edges
     auto edges = get_parking_edges(
-        stations_, parkings, pos, req->filtered_stations(),
+        *st, parkings, pos, req->filtered_stations(),
         req->max_car_duration(), req->ppr_search_options(), db_, pe_stats,
         req->include_outward(), req->include_return(), walking_speed);
     MOTIS_STOP_TIMING(parking_edges_timing);
@@ -387,7 +400,7 @@ struct parking::impl {
     fbb.create_and_finish(
         MsgContent_ParkingEdgesResponse,
         CreateParkingEdgesResponse(
-            fbb, fbb.CreateVector(create_parking_edges(stations_, fbb, edges)),
+            fbb, fbb.CreateVector(create_parking_edges(*st, fbb, edges)),
             to_fbs(fbb, "parking.parking_edges",
                    {{"osrm_duration",
                      static_cast<uint64_t>(pe_stats.osrm_duration_)},
@@ -405,7 +418,13 @@ struct parking::impl {
                      static_cast<uint64_t>(nocar_parking_edges_duration)},
                     {"parking_count", parking_count},
                     {"parking_edge_count", parking_edge_count},
-                    {"nocar_parking_edge_count", nocar_parking_edge_count}}))
+                    {"nocar_parking_edge_count", nocar_parking_edge_count},
+                    {"footedges_cache_hits",
+                     db_.footedges_cache().hits_.load()},
+                    {"footedges_cache_misses",
+                     db_.footedges_cache().misses_.load()},
+                    {"footedges_cache_size",
+                     static_cast<uint64_t>(db_.footedges_cache().size())}}))
             .Union());
     return make_msg(fbb);
   }
@@ -417,7 +436,7 @@ private:
   std::vector<std::string>& parkendd_endpoints_;
   unsigned parkendd_update_interval_;
   std::map<std::string, ::motis::ppr::profile_info> const& db_ppr_profiles_;
-  station_lookup const& stations_;
+  std::shared_ptr<shared_station_lookup> stations_;
   bool ppr_exact_;
 };
 
@@ -433,6 +452,10 @@ parking::parking() : module("Parking", "parking") {
   param(ppr_exact_, "ppr_exact",
         "Calculate foot edges for both directions separately (otherwise assume "
         "routes in both directions are the same)");
+  param(footedges_cache_size_, "footedges_cache_size",
+        "in-memory foot edges cache size (bytes, 0 = disabled)");
+  param(prewarm_footedges_cache_, "prewarm_footedges_cache",
+        "fill the foot edges cache at startup");
   param(parkendd_endpoints_, "parkendd_endpoints", "ParkenDD endpoints");
   param(parkendd_update_interval_, "parkendd_update_interval",
         "ParkenDD update interval (seconds)");
@@ -456,9 +479,9 @@ void parking::import(import_dispatcher& reg) {
         using import::OSMEvent;
         using import::PPREvent;
 
-        stations_ = get_shared_data<std::shared_ptr<station_lookup>>(
-                        to_res_id(global_res_id::STATION_LOOKUP))
-                        .get();
+        stations_ = get_shared_data<std::shared_ptr<shared_station_lookup>>(
+            to_res_id(global_res_id::STATION_LOOKUP));
+        auto const st = stations_->load();
 
         auto const dir = get_data_directory() / "parking";
         auto const osm_ev = motis_content(OSMEvent, dependencies.at("OSM"));
@@ -471,7 +494,7 @@ void parking::import(import_dispatcher& reg) {
                                         ppr_ev->graph_size(),
                                         ppr_ev->profiles_hash(),
                                         max_walk_duration_,
-                                        stations_->hash(),
+                                        st->hash(),
                                         import_osm_};
 
         ::motis::ppr::read_profile_files(
@@ -487,33 +510,39 @@ void parking::import(import_dispatcher& reg) {
 
           if (import_osm_) {
             auto progress_tracker = utl::get_active_progress_tracker();
-            progress_tracker->status("Extract Parking Lots");
-
-            auto osm_parking_lots =
-                extract_osm_parking_lots(osm_ev->path()->str());
+            progress_tracker->status("Extract Parking Lots, Foot Edges");
 
-            progress_tracker->status("Store Parking Lots");
             LOG(info) << "Initializing parking DB...";
             auto db = database{db_file(), db_max_size_};
-            LOG(info) << "Writing OSM parking lots to DB...";
-            db.add_parking_lots(osm_parking_lots);
-
-            LOG(info) << "Creating foot edge tasks...";
-            progress_tracker->status("Check Foot Edges");
-            auto foot_edge_tasks = db.get_foot_edge_tasks(
-                *stations_, osm_parking_lots, ppr_profiles_);
-            LOG(info) << "Created " << foot_edge_tasks.size()
-                      << " foot edge tasks (" << osm_parking_lots.size()
-                      << " parking lots, " << ppr_profiles_.size()
-                      << " ppr profiles, " << stations_->size() << " stations)";
-
-            progress_tracker->status("Compute Foot Edges");
             auto const& ppr_data =
                 *get_shared_data<motis::ppr::ppr_data const*>(
                     to_res_id(global_res_id::PPR_DATA));
-            compute_foot_edges_direct(
-                db, foot_edge_tasks, ppr_data, ppr_profiles_,
-                std::thread::hardware_concurrency(), ppr_exact_);
+
+            // Foot edges of a batch are computed while the OSM file is still
+            // being read. The batches are stored in extraction order, so the
+            // parking lot ids do not depend on the batch size.
+            auto osm_parking_lots = std::list<std::vector<parking_lot>>{};
+            auto n_parking_lots = std::size_t{0U};
+            auto n_foot_edge_tasks = std::size_t{0U};
+            auto foot_edges = foot_edges_computation{
+                db, ppr_data, ppr_profiles_,
+                static_cast<int>(std::thread::hardware_concurrency()),
+                ppr_exact_};
+            extract_osm_parking_lots(
+                osm_ev->path()->str(), [&](std::vector<parking_lot>&& lots) {
+                  auto& batch = osm_parking_lots.emplace_back(std::move(lots));
+                  db.add_parking_lots(batch);
+                  auto tasks =
+                      db.get_foot_edge_tasks(*st, batch, ppr_profiles_);
+                  n_parking_lots += batch.size();
+                  n_foot_edge_tasks += tasks.size();
+                  foot_edges.add(std::move(tasks));
+                });
+            LOG(info) << "Created " << n_foot_edge_tasks
+                      << " foot edge tasks (" << n_parking_lots
+                      << " parking lots, " << ppr_profiles_.size()
+                      << " ppr profiles, " << st->size() << " stations)";
+            foot_edges.finish();
           } else {
             std::clog << "OSM import disabled, not importing parking lots"
                       << '\n';
@@ -541,8 +570,9 @@ void parking::import(import_dispatcher& reg) {
 void parking::init(motis::module::registry& reg) {
   try {
     impl_ = std::make_unique<impl>(
-        *stations_, db_file(), db_max_size_, parkendd_endpoints_,
-        parkendd_update_interval_, ppr_profiles_, ppr_exact_);
+        stations_, db_file(), db_max_size_, footedges_cache_size_,
+        parkendd_endpoints_, parkendd_update_interval_, ppr_profiles_,
+        ppr_exact_);
 
     reg.register_op("/parking/geo",
                     [this](auto&& m) { return impl_->geo_lookup(m); }, {});
@@ -553,7 +583,10 @@ void parking::init(motis::module::registry& reg) {
     reg.register_op("/parking/edges",
                     [this](auto&& m) { return impl_->parking_edges_req(m); },
                     {});
-    reg.subscribe("/init", [this]() { impl_->init(*shared_data_); }, {});
+    reg.subscribe(
+        "/init",
+        [this]() { impl_->init(*shared_data_, prewarm_footedges_cache_); },
+        {});
   } catch (std::exception const& e) {
     LOG(logging::warn) << "parking module not initialized (" << e.what() << ")";
   }
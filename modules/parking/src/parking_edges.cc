@@ -1,8 +1,10 @@
 #include "motis/parking/parking_edges.h"
 
 #include <algorithm>
+#include <iterator>
 #include <mutex>
 
+#include "utl/helpers/algorithm.h"
 #include "utl/to_vec.h"
 
 #include "ppr/routing/search_profile.h"
@@ -238,13 +240,20 @@ std::vector<parking_edges> get_cached_parking_edges(
 
   auto const foot_duration_limit = static_cast<duration>(
       std::ceil(ppr_search_options->duration_limit() / 60));
+  auto const dest_station_ids = utl::to_vec(
+      *dest_stations, [](Station const* ds) { return ds->id()->view(); });
   auto const filter_station = [&](FootEdge const* fe) {
     auto const sid = fe->station_id()->str();
     return fe->duration() > foot_duration_limit || !st.get(sid).valid() ||
-           std::any_of(dest_stations->begin(), dest_stations->end(),
-                       [&](auto const& ds) { return sid == ds->id()->str(); });
+           utl::find(dest_station_ids, sid) != end(dest_station_ids);
   };
 
+  // Parking lots without precomputed foot edges are routed with ppr after
+  // the loop, all of them in parallel. Edges are collected per parking lot
+  // to keep the order of the parking lots.
+  auto uncached = std::vector<std::size_t>{};
+  auto lot_edges = std::vector<std::vector<parking_edges>>(parkings.size());
+
   std::mutex mutex;
   MOTIS_START_TIMING(pe_timing);
   for (auto parking_idx = 0UL; parking_idx < parkings.size(); ++parking_idx) {
@@ -294,14 +303,27 @@ std::vector<parking_edges> get_cached_parking_edges(
         }
       }
       if (!outward_costs.empty() && !return_costs.empty()) {
-        edges.emplace_back(parking, outward_costs, return_costs);
+        lot_edges[parking_idx].emplace_back(parking, outward_costs,
+                                            return_costs);
       }
     } else {
-      add_parking_edges(edges, parking, dest_stations, ppr_search_options,
-                        osrm_outward_costs, osrm_return_costs, mutex, pe_stats,
-                        include_outward, include_return, walking_speed);
+      uncached.emplace_back(parking_idx);
     }
   }
+
+  motis_parallel_for(uncached, [&](auto const parking_idx) {
+    add_parking_edges(
+        lot_edges[parking_idx], parkings[parking_idx], dest_stations,
+        ppr_search_options,
+        include_outward ? osrm_res.outward_resp_->costs()->Get(parking_idx)
+                        : nullptr,
+        include_return ? osrm_res.return_resp_->costs()->Get(parking_idx)
+                       : nullptr,
+        mutex, pe_stats, include_outward, include_return, walking_speed);
+  });
+  for (auto& e : lot_edges) {
+    std::move(begin(e), end(e), std::back_inserter(edges));
+  }
   MOTIS_STOP_TIMING(pe_timing);
 
   pe_stats.parking_edge_duration_ = MOTIS_TIMING_MS(pe_timing);
@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <array>
+#include <utility>
 
 #include "motis/parking/parkings.h"
 
@@ -8,64 +9,68 @@
 namespace motis::parking {
 
 parkings::parkings(database& db) : db_{db} {
-  parkings_ = db_.get_parking_lots();
-  for (auto const& lot : parkings_) {
+  snapshot_.store(make_snapshot(nullptr, db_.get_parking_lots()));
+  unavailable_parking_lots_.store(
+      std::make_shared<mcd::hash_set<std::int32_t> const>());
+}
+
+std::shared_ptr<parkings::snapshot const> parkings::make_snapshot(
+    snapshot const* prev, std::vector<parking_lot> const& parking_lots) {
+  auto s = std::make_shared<snapshot>();
+  if (prev != nullptr) {
+    s->parkings_.reserve(prev->parkings_.size() + parking_lots.size());
+    s->parkings_.insert(end(s->parkings_), begin(prev->parkings_),
+                        end(prev->parkings_));
+    s->parkendd_id_to_parking_lot_id_ = prev->parkendd_id_to_parking_lot_id_;
+  }
+  for (auto const& lot : parking_lots) {
+    s->parkings_.emplace_back(lot);
     if (lot.is_from_parkendd()) {
       auto const& info = std::get<parkendd_parking_lot_info>(lot.info_);
-      parkendd_id_to_parking_lot_id_[info.id_] = lot.id_;
+      s->parkendd_id_to_parking_lot_id_[info.id_] = lot.id_;
     }
   }
-  create_rtree();
-}
-
-void parkings::create_rtree() {
-  rtree_ = geo::make_point_rtree(parkings_,
-                                 [](auto const& p) { return p.location_; });
+  s->rtree_ = geo::make_point_rtree(s->parkings_,
+                                    [](auto const& p) { return p.location_; });
+  return s;
 }
 
 std::vector<parking_lot> parkings::get_parkings(geo::latlng const& center,
                                                 double radius) {
-  std::lock_guard const lock{mutex_};
-  return utl::all(rtree_.in_radius(center, radius))  //
+  auto const s = snapshot_.load();
+  auto const unavailable = unavailable_parking_lots_.load();
+  return utl::all(s->rtree_.in_radius(center, radius))  //
          | utl::transform(
-               [this](std::size_t index) { return parkings_[index]; })  //
+               [&](std::size_t index) { return s->parkings_[index]; })  //
          | utl::remove_if([&](auto const& lot) {
-             return unavailable_parking_lots_.find(lot.id_) !=
-                    end(unavailable_parking_lots_);
+             return unavailable->find(lot.id_) != end(*unavailable);
            })  //
          | utl::vec();
 }
 
 std::optional<parking_lot> parkings::get_parking(int32_t id) {
-  std::lock_guard const lock{mutex_};
-  if (id > 0 && static_cast<std::size_t>(id) <= parkings_.size()) {
-    return parkings_[id - 1];
+  auto const s = snapshot_.load();
+  if (id > 0 && static_cast<std::size_t>(id) <= s->parkings_.size()) {
+    return s->parkings_[id - 1];
   } else {
     return {};
   }
 }
 
 void parkings::add_parkings(std::vector<parking_lot> const& parking_lots) {
-  std::lock_guard const lock{mutex_};
-  for (auto const& lot : parking_lots) {
-    parkings_.emplace_back(lot);
-    if (lot.is_from_parkendd()) {
-      auto const& info = std::get<parkendd_parking_lot_info>(lot.info_);
-      parkendd_id_to_parking_lot_id_[info.id_] = lot.id_;
-    }
-  }
-  create_rtree();
+  std::lock_guard const lock{write_mutex_};
+  snapshot_.store(make_snapshot(snapshot_.load().get(), parking_lots));
 }
 
 std::int32_t parkings::get_parkendd_lot_id(std::string_view parkendd_id) {
-  std::lock_guard const lock{mutex_};
-  return parkendd_id_to_parking_lot_id_.at(parkendd_id);
+  return snapshot_.load()->parkendd_id_to_parking_lot_id_.at(parkendd_id);
 }
 
 void parkings::set_unavailable_parking_lots(
     mcd::hash_set<std::int32_t>&& unavailable) {
-  std::lock_guard const lock{mutex_};
-  unavailable_parking_lots_ = std::move(unavailable);
+  unavailable_parking_lots_.store(
+      std::make_shared<mcd::hash_set<std::int32_t> const>(
+          std::move(unavailable)));
 }
 
 }  // namespace motis::parking
@@ -0,0 +1,375 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lmdb/lmdb.hpp"
+
+#include "motis/ppr/profile_info.h"
+
+#include "motis/parking/database.h"
+
+#include "./utils.h"
+
+using namespace motis::parking;
+
+namespace {
+
+constexpr auto const kDbSize = std::size_t{64U} * 1024U * 1024U;
+constexpr auto const kLots = std::size_t{200U};
+constexpr auto const kBatchSize = std::size_t{20U};
+constexpr auto const kWrites = 50U;
+constexpr auto const kReaders = 4U;
+
+std::string const kProfile{"default"};
+geo::latlng const kCenter{49.8728, 8.6512};
+
+std::vector<parking_lot> make_lots(std::int64_t const first_osm_id,
+                                   std::size_t const n) {
+  auto lots = std::vector<parking_lot>{};
+  for (auto i = 0U; i != n; ++i) {
+    lots.emplace_back(make_osm_lot(first_osm_id + i, kCenter));
+  }
+  return lots;
+}
+
+// Foot edges of all lots in one write transaction, duration = version.
+void write_version(database& db, std::vector<parking_lot> const& lots,
+                   std::uint16_t const version) {
+  auto entries = std::vector<foot_edges_entry>{};
+  for (auto const& lot : lots) {
+    entries.emplace_back(
+        foot_edges_entry{make_foot_edges(lot.id_, kProfile, version), {}});
+  }
+  db.put_footedges(entries);
+}
+
+// The version of the entry, -1 if the entry is inconsistent.
+int read_version(database& db, std::int32_t const parking_id) {
+  auto const fe = db.get_footedges(parking_id, kProfile);
+  if (fe == nullptr || fe->get()->parking_id() != parking_id ||
+      fe->get()->search_profile()->str() != kProfile ||
+      fe->get()->outward_edges()->size() == 0U) {
+    return -1;
+  }
+  auto const version = fe->get()->outward_edges()->Get(0)->duration();
+  for (auto const* e : *fe->get()->outward_edges()) {
+    if (e->duration() != version) {
+      return -1;
+    }
+  }
+  return version;
+}
+
+std::map<std::string, motis::ppr::profile_info> make_profiles() {
+  auto profiles = std::map<std::string, motis::ppr::profile_info>{};
+  auto& p = profiles[kProfile].profile_;
+  p.duration_limit_ = 600.0;
+  p.walking_speed_ = 1.4;  // radius: 840m
+  return profiles;
+}
+
+// Stations around kCenter (all within the profile radius).
+test_station_lookup make_stations(std::size_t const n) {
+  auto ids = std::vector<std::string>{};
+  auto pos = std::vector<geo::latlng>{};
+  for (auto i = 0U; i != n; ++i) {
+    ids.emplace_back("s" + std::to_string(i));
+    pos.emplace_back(kCenter.lat_ + 0.001 * (i % 4),
+                     kCenter.lng_ + 0.001 * (i / 4));
+  }
+  return test_station_lookup{"t_", std::move(ids), pos};
+}
+
+std::vector<foot_edges_entry> make_entries(
+    station_lookup const& st, std::vector<parking_lot> const& lots) {
+  auto entries = std::vector<foot_edges_entry>{};
+  for (auto const& lot : lots) {
+    entries.emplace_back(
+        foot_edges_entry{make_foot_edges(lot.id_, kProfile, 60U),
+                         st.in_radius(lot.location_, 840.0)});
+  }
+  return entries;
+}
+
+}  // namespace
+
+TEST(parking_database, footedges_round_trip) {
+  auto const tmp = temp_db_dir{};
+  auto const profiles = make_profiles();
+  auto const st = make_stations(8U);
+
+  // Entry of the first lot in the previous format: reachable station IDs
+  // as "<id>|<id>|..." string (key: "<parking id>:<profile>").
+  {
+    auto env = lmdb::env{};
+    env.set_maxdbs(10);
+    env.set_mapsize(kDbSize);
+    env.open(tmp.db_file().c_str(), lmdb::env_open_flags::NOSUBDIR);
+    auto txn = lmdb::txn{env};
+    auto old_format = std::string{};
+    for (auto const& [s, dist] : st.in_radius(kCenter, 840.0)) {
+      old_format += s.id() + "|";
+    }
+    auto const fe = make_foot_edges(1, kProfile, 60U);
+    txn.put(txn.dbi_open("reachable_stations", lmdb::dbi_flags::CREATE),
+            "1:default", old_format);
+    txn.put(txn.dbi_open("footedges", lmdb::dbi_flags::CREATE), "1:default",
+            fe.to_string_view());
+    txn.commit();
+  }
+
+  auto db = database{tmp.db_file(), kDbSize};
+  auto lots = make_lots(0, 10U);
+  db.add_parking_lots(lots);
+  ASSERT_EQ(1, lots.front().id_);
+
+  // Old format: recomputed once.
+  auto tasks = db.get_foot_edge_tasks(st, lots, profiles);
+  ASSERT_EQ(lots.size(), tasks.size());
+  EXPECT_EQ(lots.front().id_, tasks.front().parking_lot_->id_);
+
+  // Batch write, read back unchanged.
+  auto const entries = make_entries(st, lots);
+  db.put_footedges(entries);
+  for (auto const& e : entries) {
+    auto const fe = db.get_footedges(e.foot_edges_.get()->parking_id(),
+                                     kProfile);
+    ASSERT_NE(nullptr, fe);
+    EXPECT_EQ(e.foot_edges_.to_string_view(), fe->to_string_view());
+  }
+  EXPECT_EQ(nullptr, db.get_footedges(lots.front().id_, "other"));
+
+  // Same reachable stations: nothing to compute.
+  EXPECT_TRUE(db.get_foot_edge_tasks(st, lots, profiles).empty());
+
+  // Another station in the radius: everything is recomputed.
+  auto const more_st = make_stations(9U);
+  tasks = db.get_foot_edge_tasks(more_st, lots, profiles);
+  ASSERT_EQ(lots.size(), tasks.size());
+  EXPECT_EQ(9U, tasks.front().stations_in_radius_.size());
+
+  // Same stations, different tag (= different timetable): recomputed.
+  auto const other_tag = test_station_lookup{"u_", st.ids_, st.pos_};
+  EXPECT_EQ(lots.size(),
+            db.get_foot_edge_tasks(other_tag, lots, profiles).size());
+}
+
+TEST(parking_database, concurrent_reads_during_writes) {
+  auto const tmp = temp_db_dir{};
+  auto db = database{tmp.db_file(), kDbSize};
+  auto lots = make_lots(0, kLots);
+  db.add_parking_lots(lots);
+  write_version(db, lots, 0U);
+
+  auto done = std::atomic_bool{false};
+  auto errors = std::atomic_uint{0U};
+  auto reads = std::atomic_uint64_t{0U};
+  auto readers = std::vector<std::thread>{};
+  for (auto r = 0U; r != kReaders; ++r) {
+    readers.emplace_back([&, r]() {
+      auto last_version = std::vector<int>(kLots, 0);
+      auto last_lots = kLots;
+      for (auto i = 0U; !done; ++i) {
+        // Committed versions only, never older than a previous read.
+        auto const idx = (i * kReaders + r) % kLots;
+        auto const version = read_version(db, lots[idx].id_);
+        if (version < last_version[idx]) {
+          ++errors;
+        }
+        last_version[idx] = version;
+
+        if (i % 64U == 0U) {
+          // Lots are added in whole transactions.
+          auto const n = db.get_parking_lots().size();
+          if (n < last_lots || (n - kLots) % kBatchSize != 0U) {
+            ++errors;
+          }
+          last_lots = n;
+        }
+        ++reads;
+      }
+    });
+  }
+
+  for (auto v = 1U; v <= kWrites; ++v) {
+    write_version(db, lots, static_cast<std::uint16_t>(v));
+    auto batch = make_lots(
+        static_cast<std::int64_t>(kLots + (v - 1U) * kBatchSize), kBatchSize);
+    db.add_parking_lots(batch);
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  EXPECT_EQ(0U, errors);
+  EXPECT_LT(0U, reads);
+  EXPECT_EQ(kLots + kWrites * kBatchSize, db.get_parking_lots().size());
+  for (auto const& lot : lots) {
+    EXPECT_EQ(static_cast<int>(kWrites), read_version(db, lot.id_));
+  }
+}
+
+TEST(parking_database, footedges_cache_matches_database) {
+  auto const cached_dir = temp_db_dir{};
+  auto const plain_dir = temp_db_dir{};
+  // Room for a quarter of the entries: hits, misses and evictions.
+  auto const entry_size = make_foot_edges(1, kProfile, 0U).size();
+  auto cached = database{cached_dir.db_file(), kDbSize, entry_size * kLots / 4};
+  auto plain = database{plain_dir.db_file(), kDbSize};
+  auto lots = make_lots(0, kLots);
+  cached.add_parking_lots(lots);
+  plain.add_parking_lots(lots);
+
+  auto const all_equal = [&]() {
+    for (auto const& lot : lots) {
+      auto const a = cached.get_footedges(lot.id_, kProfile);
+      auto const b = plain.get_footedges(lot.id_, kProfile);
+      if ((a == nullptr) != (b == nullptr) ||
+          (a != nullptr && a->to_string_view() != b->to_string_view())) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  EXPECT_TRUE(all_equal());
+  for (auto v = 0U; v != 3U; ++v) {
+    write_version(cached, lots, static_cast<std::uint16_t>(v));
+    write_version(plain, lots, static_cast<std::uint16_t>(v));
+    EXPECT_TRUE(all_equal());
+    EXPECT_TRUE(all_equal());
+  }
+  EXPECT_LT(0U, cached.footedges_cache().hits_.load());
+  EXPECT_LT(0U, cached.footedges_cache().misses_.load());
+
+  // Readers fill the cache while versions are written. A fill read before a
+  // write must not land in the cache after the write's invalidation.
+  auto done = std::atomic_bool{false};
+  auto errors = std::atomic_uint{0U};
+  auto readers = std::vector<std::thread>{};
+  for (auto r = 0U; r != kReaders; ++r) {
+    readers.emplace_back([&, r]() {
+      auto last_version = std::vector<int>(kLots, 2);
+      for (auto i = 0U; !done; ++i) {
+        auto const idx = (i * kReaders + r) % (kLots / 8U);  // hot entries
+        auto const version = read_version(cached, lots[idx].id_);
+        if (version < last_version[idx]) {
+          ++errors;
+        }
+        last_version[idx] = version;
+      }
+    });
+  }
+  for (auto v = 3U; v != 3U + kWrites; ++v) {
+    write_version(cached, lots, static_cast<std::uint16_t>(v));
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+  write_version(plain, lots, static_cast<std::uint16_t>(2U + kWrites));
+
+  EXPECT_EQ(0U, errors);
+  EXPECT_TRUE(all_equal());
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(parking_database, DISABLED_read_throughput) {
+  auto const tmp = temp_db_dir{};
+  auto db = database{tmp.db_file(), kDbSize};
+  auto lots = make_lots(0, kLots);
+  db.add_parking_lots(lots);
+  write_version(db, lots, 0U);
+
+  constexpr auto const kReadsPerThread = 200'000U;
+  for (auto const threads : {1U, 2U, 4U, 8U}) {
+    for (auto const with_writer : {false, true}) {
+      auto done = std::atomic_bool{false};
+      auto writer = std::thread{[&]() {
+        for (auto v = 1U; with_writer && !done; ++v) {
+          write_version(db, lots, static_cast<std::uint16_t>(v));
+        }
+      }};
+
+      auto errors = std::atomic_uint{0U};
+      auto const start = std::chrono::steady_clock::now();
+      auto readers = std::vector<std::thread>{};
+      for (auto r = 0U; r != threads; ++r) {
+        readers.emplace_back([&, r]() {
+          for (auto i = 0U; i != kReadsPerThread; ++i) {
+            if (read_version(db, lots[(i + r) % kLots].id_) < 0) {
+              ++errors;
+            }
+          }
+        });
+      }
+      for (auto& t : readers) {
+        t.join();
+      }
+      auto const seconds = std::chrono::duration<double>{
+          std::chrono::steady_clock::now() - start}
+                               .count();
+      done = true;
+      writer.join();
+
+      EXPECT_EQ(0U, errors);
+      std::cout << "get_footedges, " << threads << " threads"
+                << (with_writer ? " + writer" : "") << ": "
+                << static_cast<std::uint64_t>(threads * kReadsPerThread /
+                                              seconds)
+                << " reads/s\n";
+    }
+  }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(parking_database, DISABLED_footedges_import_timing) {
+  constexpr auto const kImportLots = 20'000U;
+  auto const profiles = make_profiles();
+  auto const st = make_stations(16U);
+
+  auto const timed = [](auto&& fn) {
+    auto const start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+
+  for (auto const batched : {false, true}) {
+    auto const tmp = temp_db_dir{};
+    auto db = database{tmp.db_file(), std::size_t{1024U} * 1024U * 1024U};
+    auto lots = make_lots(0, kImportLots);
+    db.add_parking_lots(lots);
+
+    auto const tasks_ms = timed([&]() {
+      EXPECT_EQ(lots.size(), db.get_foot_edge_tasks(st, lots, profiles).size());
+    });
+    auto const entries = make_entries(st, lots);
+    auto const write_ms = timed([&]() {
+      if (batched) {
+        db.put_footedges(entries);
+      } else {
+        for (auto const& e : entries) {
+          db.put_footedges(e.foot_edges_, e.reachable_stations_);
+        }
+      }
+    });
+    auto const check_ms = timed([&]() {
+      EXPECT_TRUE(db.get_foot_edge_tasks(st, lots, profiles).empty());
+    });
+
+    std::cout << kImportLots << " lots, "
+              << (batched ? "one transaction" : "one transaction per lot")
+              << ": tasks " << tasks_ms << "ms, write " << write_ms
+              << "ms, up-to-date check " << check_ms << "ms\n";
+  }
+}
@@ -0,0 +1,225 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "osmium/builder/attr.hpp"
+#include "osmium/io/pbf_output.hpp"
+#include "osmium/io/writer.hpp"
+#include "osmium/memory/buffer.hpp"
+
+#include "utl/to_vec.h"
+
+#include "motis/parking/database.h"
+#include "motis/parking/osm_parking_lots.h"
+
+#include "./utils.h"
+
+using namespace motis::parking;
+
+namespace {
+
+constexpr auto const kDbSize = std::size_t{64U} * 1024U * 1024U;
+geo::latlng const kCenter{49.8728, 8.6512};
+
+struct expected_lot {
+  std::int64_t osm_id_;
+  osm_type osm_type_;
+  fee_type fee_;
+  geo::latlng pos_;
+  double max_diff_{1e-9};  // degrees
+};
+
+osmium::Location to_location(geo::latlng const& pos) {
+  return osmium::Location{pos.lng_, pos.lat_};
+}
+
+// Stored with 1e-7 precision, as the OSM reader returns it.
+geo::latlng rounded(geo::latlng const& pos) {
+  auto const l = to_location(pos);
+  return {l.lat(), l.lon()};
+}
+
+// The area center is a mean over the outer ring nodes, the closing node
+// included: it depends on the node the assembler starts the ring with.
+expected_lot area_lot(std::int64_t const osm_id, osm_type const ot,
+                      fee_type const fee, geo::latlng const& sw,
+                      double const size) {
+  return {osm_id, ot, fee,
+          geo::latlng{sw.lat_ + size / 2.0, sw.lng_ + size / 2.0}, size / 2.0};
+}
+
+std::vector<geo::latlng> square(geo::latlng const& sw, double const size) {
+  return {sw,
+          {sw.lat_, sw.lng_ + size},
+          {sw.lat_ + size, sw.lng_ + size},
+          {sw.lat_ + size, sw.lng_},
+          sw};
+}
+
+// Node parking lots with access and fee variants, a closed way parking lot
+// and a multipolygon relation parking lot. Returns the lots the
+// extraction has to produce, in extraction order: nodes in file order,
+// then areas as they are assembled.
+std::vector<expected_lot> write_osm(std::string const& path) {
+  using namespace osmium::builder::attr;  // NOLINT
+
+  auto buf = osmium::memory::Buffer{1024U * 1024U,
+                                    osmium::memory::Buffer::auto_grow::yes};
+  auto expected = std::vector<expected_lot>{};
+
+  struct node_lot {
+    char const* access_;
+    char const* fee_;
+    bool allowed_;
+    fee_type expected_fee_;
+  };
+  auto const node_lots = std::vector<node_lot>{
+      {nullptr, nullptr, true, fee_type::UNKNOWN},
+      {"yes", "yes", true, fee_type::YES},
+      {"permissive", "no", true, fee_type::NO},
+      {"public", "unknown", true, fee_type::UNKNOWN},
+      {"private", "no", false, fee_type::NO},
+      {"customers", nullptr, false, fee_type::UNKNOWN},
+      {"no", "yes", false, fee_type::YES}};
+
+  auto node_id = osmium::object_id_type{0};
+  for (auto i = 0U; i != node_lots.size(); ++i) {
+    auto const& n = node_lots[i];
+    auto tags = std::vector<std::pair<std::string, std::string>>{
+        {"amenity", "parking"}};
+    if (n.access_ != nullptr) {
+      tags.emplace_back("access", n.access_);
+    }
+    if (n.fee_ != nullptr) {
+      tags.emplace_back("fee", n.fee_);
+    }
+    auto const pos = geo::latlng{kCenter.lat_ + 0.001 * i, kCenter.lng_};
+    osmium::builder::add_node(buf, _id(++node_id), _location(to_location(pos)),
+                              _tags(tags));
+    if (n.allowed_) {
+      expected.emplace_back(expected_lot{node_id, osm_type::NODE,
+                                         n.expected_fee_, rounded(pos)});
+    }
+  }
+  // Not a parking lot.
+  osmium::builder::add_node(
+      buf, _id(++node_id),
+      _location(to_location({kCenter.lat_ - 0.001, kCenter.lng_})),
+      _tag("amenity", "bench"));
+
+  auto const add_ring = [&](std::vector<geo::latlng> const& ring) {
+    auto ids = std::vector<osmium::object_id_type>{};
+    for (auto const& p : ring) {
+      if (&p == &ring.back()) {
+        ids.emplace_back(ids.front());
+      } else {
+        osmium::builder::add_node(buf, _id(++node_id),
+                                  _location(to_location(p)));
+        ids.emplace_back(node_id);
+      }
+    }
+    return ids;
+  };
+
+  auto const way_sw = geo::latlng{kCenter.lat_, kCenter.lng_ + 0.01};
+  auto const private_sw = geo::latlng{kCenter.lat_, kCenter.lng_ + 0.02};
+  auto const outer_sw = geo::latlng{kCenter.lat_, kCenter.lng_ + 0.03};
+  auto const way_nodes = add_ring(square(way_sw, 0.001));
+  auto const private_nodes = add_ring(square(private_sw, 0.001));
+  auto const outer_nodes = add_ring(square(outer_sw, 0.002));
+
+  osmium::builder::add_way(buf, _id(100), _tag("amenity", "parking"),
+                           _tag("fee", "yes"), _nodes(way_nodes));
+  expected.emplace_back(
+      area_lot(100, osm_type::WAY, fee_type::YES, way_sw, 0.001));
+  osmium::builder::add_way(buf, _id(101), _tag("amenity", "parking"),
+                           _tag("access", "private"), _nodes(private_nodes));
+  osmium::builder::add_way(buf, _id(102), _nodes(outer_nodes));
+
+  osmium::builder::add_relation(
+      buf, _id(200), _tag("type", "multipolygon"), _tag("amenity", "parking"),
+      _tag("fee", "no"), _member(osmium::item_type::way, 102, "outer"));
+  expected.emplace_back(
+      area_lot(200, osm_type::RELATION, fee_type::NO, outer_sw, 0.002));
+
+  auto writer = osmium::io::Writer{path, osmium::io::overwrite::allow};
+  writer(std::move(buf));
+  writer.close();
+
+  return expected;
+}
+
+std::vector<std::tuple<std::int64_t, osm_type, fee_type>> summarize(
+    std::vector<parking_lot> const& lots) {
+  return utl::to_vec(lots, [](parking_lot const& lot) {
+    auto const& info = cista::get<osm_parking_lot_info>(lot.info_);
+    return std::tuple{info.osm_id_, info.osm_type_, info.fee_};
+  });
+}
+
+}  // namespace
+
+TEST(parking_osm_parking_lots, batches_match_full_extraction) {
+  auto const dir = temp_db_dir{};
+  auto const osm_file = (dir.dir_ / "parking.osm.pbf").string();
+  auto const expected = write_osm(osm_file);
+
+  auto batches = std::vector<std::vector<parking_lot>>{};
+  extract_osm_parking_lots(osm_file, [&](std::vector<parking_lot>&& lots) {
+    batches.emplace_back(std::move(lots));
+  });
+  // Node parking lots are handed out before the way pass.
+  ASSERT_EQ(2U, batches.size());
+
+  auto lots = std::vector<parking_lot>{};
+  for (auto const& b : batches) {
+    lots.insert(end(lots), begin(b), end(b));
+  }
+
+  ASSERT_EQ(expected.size(), lots.size());
+  for (auto i = 0U; i != lots.size(); ++i) {
+    auto const& e = expected[i];
+    auto const& lot = lots[i];
+    ASSERT_TRUE(lot.is_from_osm());
+    auto const& info = cista::get<osm_parking_lot_info>(lot.info_);
+    EXPECT_EQ(e.osm_id_, info.osm_id_);
+    EXPECT_EQ(e.osm_type_, info.osm_type_);
+    EXPECT_EQ(e.fee_, info.fee_);
+    EXPECT_NEAR(e.pos_.lat_, lot.location_.lat_, e.max_diff_);
+    EXPECT_NEAR(e.pos_.lng_, lot.location_.lng_, e.max_diff_);
+  }
+
+  // The vector wrapper returns the same lots.
+  auto all = extract_osm_parking_lots(osm_file);
+  EXPECT_EQ(summarize(lots), summarize(all));
+  ASSERT_EQ(lots.size(), all.size());
+  for (auto i = 0U; i != lots.size(); ++i) {
+    EXPECT_EQ(lots[i].location_.lat_, all[i].location_.lat_);
+    EXPECT_EQ(lots[i].location_.lng_, all[i].location_.lng_);
+  }
+
+  // Storing the batches one by one (import) assigns the same parking lot
+  // IDs as storing all lots at once.
+  auto const all_dir = temp_db_dir{};
+  auto all_db = database{all_dir.db_file(), kDbSize};
+  all_db.add_parking_lots(all);
+
+  auto const batch_dir = temp_db_dir{};
+  auto batch_db = database{batch_dir.db_file(), kDbSize};
+  auto batch_ids = std::vector<std::int32_t>{};
+  for (auto& b : batches) {
+    batch_db.add_parking_lots(b);
+    for (auto const& lot : b) {
+      batch_ids.emplace_back(lot.id_);
+    }
+  }
+
+  EXPECT_EQ(utl::to_vec(all, [](parking_lot const& lot) { return lot.id_; }),
+            batch_ids);
+  EXPECT_EQ(summarize(all_db.get_parking_lots()),
+            summarize(batch_db.get_parking_lots()));
+}
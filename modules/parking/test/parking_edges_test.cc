@@ -0,0 +1,234 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "geo/latlng.h"
+
+#include "utl/to_vec.h"
+
+#include "motis/core/conv/position_conv.h"
+#include "motis/module/message.h"
+#include "motis/test/motis_instance_test.h"
+
+#include "motis/parking/database.h"
+#include "motis/parking/parking_edges.h"
+
+#include "./utils.h"
+
+namespace mm = motis::module;
+using namespace motis;
+using namespace motis::parking;
+using motis::lookup::LookupGeoStationRequest;
+using motis::lookup::LookupGeoStationResponse;
+using motis::osrm::OSRMOneToManyRequest;
+using motis::ppr::FootRoutingRequest;
+
+namespace {
+
+constexpr auto const kDbSize = std::size_t{64U} * 1024U * 1024U;
+constexpr auto const kDurationLimit = 600.0;  // s
+constexpr auto const kWalkingSpeed = 1.4;  // m/s
+constexpr auto const kCarSpeed = 10.0;  // m/s
+std::string const kProfile{"default"};
+geo::latlng const kCenter{49.8728, 8.6512};
+
+std::vector<geo::latlng> station_positions() {
+  auto pos = std::vector<geo::latlng>{};
+  for (auto i = 0U; i != 6U; ++i) {
+    pos.emplace_back(kCenter.lat_ + 0.002 * (i % 3),
+                     kCenter.lng_ + 0.003 * (i / 3));
+  }
+  return pos;
+}
+
+std::vector<std::string> station_ids() {
+  return {"s0", "s1", "s2", "s3", "s4", "s5"};
+}
+
+std::uint16_t foot_duration(double const dist) {
+  return static_cast<std::uint16_t>(dist / kWalkingSpeed / 60.0);
+}
+
+// Stand-ins for /lookup/geo_station, /ppr/route and /osrm/one_to_many:
+// straight lines at constant speed.
+mm::msg_ptr geo_station(mm::msg_ptr const& msg) {
+  auto const req = motis_content(LookupGeoStationRequest, msg);
+  auto const ids = station_ids();
+  auto const pos = station_positions();
+  mm::message_creator fbb;
+  auto stations = std::vector<flatbuffers::Offset<Station>>{};
+  for (auto i = 0U; i != ids.size(); ++i) {
+    auto const dist = geo::distance(from_fbs(req->pos()), pos[i]);
+    if (dist >= req->min_radius() && dist <= req->max_radius()) {
+      auto const p = to_fbs(pos[i]);
+      stations.emplace_back(CreateStation(fbb, fbb.CreateString(ids[i]),
+                                          fbb.CreateString(ids[i]), &p));
+    }
+  }
+  fbb.create_and_finish(MsgContent_LookupGeoStationResponse,
+                        lookup::CreateLookupGeoStationResponse(
+                            fbb, fbb.CreateVector(stations))
+                            .Union());
+  return make_msg(fbb);
+}
+
+mm::msg_ptr foot_routes(mm::msg_ptr const& msg) {
+  auto const req = motis_content(FootRoutingRequest, msg);
+  mm::message_creator fbb;
+  auto const routes = utl::to_vec(*req->destinations(), [&](auto&& dest) {
+    auto const dist = geo::distance(from_fbs(req->start()), from_fbs(dest));
+    return ppr::CreateRoutes(
+        fbb, fbb.CreateVector(std::vector{
+                 ppr::CreateRoute(fbb, dist, foot_duration(dist))}));
+  });
+  fbb.create_and_finish(
+      MsgContent_FootRoutingResponse,
+      ppr::CreateFootRoutingResponse(fbb, fbb.CreateVector(routes)).Union());
+  return make_msg(fbb);
+}
+
+mm::msg_ptr car_costs(mm::msg_ptr const& msg) {
+  auto const req = motis_content(OSRMOneToManyRequest, msg);
+  auto const costs = utl::to_vec(*req->many(), [&](auto&& x) {
+    auto const dist = geo::distance(from_fbs(req->one()), from_fbs(x));
+    return osrm::Cost{dist / kCarSpeed, dist};
+  });
+  mm::message_creator fbb;
+  fbb.create_and_finish(
+      MsgContent_OSRMOneToManyResponse,
+      osrm::CreateOSRMOneToManyResponse(fbb, fbb.CreateVectorOfStructs(costs))
+          .Union());
+  return make_msg(fbb);
+}
+
+// Precomputed foot edges as the import would store them.
+void store_foot_edges(database& db, station_lookup const& st,
+                      parking_lot const& lot) {
+  flatbuffers::FlatBufferBuilder fbb;
+  auto const stations =
+      st.in_radius(lot.location_, kDurationLimit * kWalkingSpeed);
+  auto const edges = fbb.CreateVector(utl::to_vec(stations, [&](auto&& s) {
+    return CreateFootEdge(fbb, fbb.CreateString(s.first.id()), s.second,
+                          foot_duration(s.second), 0U, s.second);
+  }));
+  fbb.Finish(CreateFootEdges(fbb, lot.id_, fbb.CreateString(kProfile), edges,
+                             edges));
+  db.put_footedges(persistable_foot_edges{std::move(fbb)}, stations);
+}
+
+std::vector<std::string> summarize(std::vector<parking_edges> const& edges) {
+  // Per station, independent of the order within a parking lot.
+  auto const costs = [](std::vector<parking_edge_costs> const& c) {
+    auto v = utl::to_vec(c, [](parking_edge_costs const& x) {
+      return x.station_id_ + ":" + std::to_string(x.car_duration_) + "+" +
+             std::to_string(x.foot_duration_) + "=" +
+             std::to_string(x.total_duration_);
+    });
+    std::sort(begin(v), end(v));
+    auto s = std::string{};
+    for (auto const& x : v) {
+      s += " " + x;
+    }
+    return s;
+  };
+  return utl::to_vec(edges, [&](parking_edges const& e) {
+    return std::to_string(e.parking_.id_) + " out:" +
+           costs(e.outward_costs_) + " ret:" + costs(e.return_costs_);
+  });
+}
+
+}  // namespace
+
+struct parking_edges_test : public motis::test::motis_instance_test {
+  parking_edges_test() {
+    instance_->register_op("/lookup/geo_station", geo_station, {});
+    instance_->register_op("/ppr/route", foot_routes, {});
+    instance_->register_op("/osrm/one_to_many", car_costs, {});
+  }
+
+  // Same parking lots (same IDs) in every database.
+  static std::vector<parking_lot> make_lots(database& db) {
+    auto lots = std::vector<parking_lot>{};
+    for (auto i = 0U; i != 12U; ++i) {
+      lots.emplace_back(make_osm_lot(
+          i, {kCenter.lat_ + 0.003 * (i % 4) - 0.001,
+              kCenter.lng_ + 0.004 * (i / 4) - 0.002}));
+    }
+    db.add_parking_lots(lots);
+    return lots;
+  }
+
+  std::vector<std::string> get_edges(database& db,
+                                     std::vector<parking_lot> const& lots) {
+    mm::message_creator fbb;
+    fbb.create_and_finish(
+        MsgContent_FootRoutingRequest,
+        ppr::CreateFootRoutingRequest(
+            fbb, nullptr, 0,
+            ppr::CreateSearchOptions(fbb, fbb.CreateString(kProfile),
+                                     kDurationLimit))
+            .Union());
+    auto const req_msg = make_msg(fbb);
+    auto const req = motis_content(FootRoutingRequest, req_msg);
+
+    // Destination stations: "s5" (removed from the parking edges).
+    auto const dest = to_fbs(station_positions().back());
+    mm::message_creator dest_fbb;
+    dest_fbb.create_and_finish(
+        MsgContent_LookupGeoStationResponse,
+        lookup::CreateLookupGeoStationResponse(
+            dest_fbb, dest_fbb.CreateVector(std::vector{CreateStation(
+                          dest_fbb, dest_fbb.CreateString("s5"),
+                          dest_fbb.CreateString("s5"), &dest)}))
+            .Union());
+    auto const dest_msg = make_msg(dest_fbb);
+    auto const dest_stations =
+        motis_content(LookupGeoStationResponse, dest_msg)->stations();
+
+    auto const st =
+        test_station_lookup{"", station_ids(), station_positions()};
+    auto edges = std::vector<parking_edges>{};
+    run([&]() {
+      auto stats = parking_edge_stats{};
+      edges = get_parking_edges(st, lots, kCenter, dest_stations, 3600,
+                                req->search_options(), db, stats, true, true,
+                                kWalkingSpeed);
+    });
+    return summarize(edges);
+  }
+};
+
+TEST_F(parking_edges_test, precomputed_and_live_foot_edges) {
+  auto const st = test_station_lookup{"", station_ids(), station_positions()};
+
+  auto const live_dir = temp_db_dir{};
+  auto live_db = database{live_dir.db_file(), kDbSize};
+  auto const live_lots = make_lots(live_db);
+
+  auto const cached_dir = temp_db_dir{};
+  auto cached_db = database{cached_dir.db_file(), kDbSize};
+  auto const cached_lots = make_lots(cached_db);
+  for (auto const& lot : cached_lots) {
+    store_foot_edges(cached_db, st, lot);
+  }
+
+  auto const mixed_dir = temp_db_dir{};
+  auto mixed_db = database{mixed_dir.db_file(), kDbSize};
+  auto const mixed_lots = make_lots(mixed_db);
+  for (auto i = 0U; i < mixed_lots.size(); i += 2U) {
+    store_foot_edges(mixed_db, st, mixed_lots[i]);
+  }
+
+  auto const live = get_edges(live_db, live_lots);
+  ASSERT_FALSE(live.empty());
+  EXPECT_EQ(std::string::npos, live.front().find("s5:"));
+  EXPECT_EQ(live, get_edges(cached_db, cached_lots));
+
+  // Lots with and without precomputed foot edges: same edges, lot order.
+  for (auto i = 0U; i != 3U; ++i) {
+    EXPECT_EQ(live, get_edges(mixed_db, mixed_lots));
+  }
+}
@@ -0,0 +1,88 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "motis/parking/database.h"
+#include "motis/parking/parkings.h"
+
+#include "./utils.h"
+
+using namespace motis::parking;
+
+namespace {
+
+constexpr auto const kDbSize = std::size_t{64U} * 1024U * 1024U;
+constexpr auto const kInitialLots = std::size_t{100U};
+constexpr auto const kBatchSize = std::size_t{50U};
+constexpr auto const kBatches = std::size_t{20U};
+constexpr auto const kReaders = 4U;
+
+geo::latlng const kCenter{49.8728, 8.6512};
+
+std::vector<parking_lot> make_batch(std::int64_t const first_osm_id,
+                                    std::size_t const n) {
+  auto lots = std::vector<parking_lot>{};
+  for (auto i = 0U; i != n; ++i) {
+    lots.emplace_back(
+        make_osm_lot(first_osm_id + i, {kCenter.lat_ + (i % 10) * 0.0001,
+                                        kCenter.lng_ + (i / 10) * 0.0001}));
+  }
+  return lots;
+}
+
+}  // namespace
+
+TEST(parking_parkings, readers_during_add_parkings) {
+  auto const tmp = temp_db_dir{};
+  auto db = database{tmp.db_file(), kDbSize};
+  auto initial = make_batch(0, kInitialLots);
+  db.add_parking_lots(initial);
+  auto p = parkings{db};
+  ASSERT_EQ(kInitialLots, p.get_parkings(kCenter, 1000.0).size());
+
+  auto done = std::atomic_bool{false};
+  auto errors = std::atomic_uint{0U};
+  auto reads = std::atomic_uint64_t{0U};
+  auto readers = std::vector<std::thread>{};
+  for (auto r = 0U; r != kReaders; ++r) {
+    readers.emplace_back([&]() {
+      auto last = std::size_t{0U};
+      while (!done) {
+        auto const lots = p.get_parkings(kCenter, 1000.0);
+        // Snapshots contain whole batches and only grow.
+        if (lots.size() < last ||
+            (lots.size() - kInitialLots) % kBatchSize != 0U) {
+          ++errors;
+        }
+        last = lots.size();
+        for (auto const& lot : lots) {
+          auto const by_id = p.get_parking(lot.id_);
+          if (!lot.valid() || !by_id.has_value() || by_id->id_ != lot.id_) {
+            ++errors;
+          }
+        }
+        ++reads;
+      }
+    });
+  }
+
+  for (auto b = 0U; b != kBatches; ++b) {
+    auto batch = make_batch(
+        static_cast<std::int64_t>(kInitialLots + b * kBatchSize), kBatchSize);
+    db.add_parking_lots(batch);
+    p.add_parkings(batch);
+  }
+  done = true;
+  for (auto& t : readers) {
+    t.join();
+  }
+
+  EXPECT_EQ(0U, errors);
+  EXPECT_LT(0U, reads);
+  auto const n = kInitialLots + kBatches * kBatchSize;
+  EXPECT_EQ(n, p.get_parkings(kCenter, 1000.0).size());
+  EXPECT_TRUE(p.get_parking(static_cast<std::int32_t>(n)).has_value());
+}
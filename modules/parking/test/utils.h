@@ -0,0 +1,96 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "geo/latlng.h"
+
+#include "motis/core/schedule/station_lookup.h"
+
+#include "motis/parking/foot_edges_cache.h"
+#include "motis/parking/parking_lot.h"
+
+namespace motis::parking {
+
+// LMDB file in a fresh temporary directory, removed on destruction.
+struct temp_db_dir {
+  temp_db_dir() {
+    static auto n = std::atomic_uint{0U};
+    dir_ = std::filesystem::temp_directory_path() /
+           ("motis_parking_test_" + std::to_string(getpid()) + "_" +
+            std::to_string(n++));
+    std::filesystem::create_directories(dir_);
+  }
+
+  ~temp_db_dir() { std::filesystem::remove_all(dir_); }
+
+  temp_db_dir(temp_db_dir const&) = delete;
+  temp_db_dir& operator=(temp_db_dir const&) = delete;
+  temp_db_dir(temp_db_dir&&) = delete;
+  temp_db_dir& operator=(temp_db_dir&&) = delete;
+
+  std::string db_file() const { return (dir_ / "parking.db").string(); }
+
+  std::filesystem::path dir_;
+};
+
+// Stations "<tag><id>" at the given positions.
+struct test_station_lookup : public station_lookup {
+  test_station_lookup(std::string tag, std::vector<std::string> ids,
+                      std::vector<geo::latlng> const& pos)
+      : station_lookup{pos}, tag_{std::move(tag)}, ids_{std::move(ids)},
+        pos_{pos} {}
+
+  lookup_station get(std::size_t const idx) const override {
+    return {tag_, ids_.at(idx), ids_.at(idx), pos_.at(idx)};
+  }
+
+  lookup_station get(std::string_view const id) const override {
+    auto const it = std::find(begin(ids_), end(ids_), id);
+    return it == end(ids_)
+               ? lookup_station::invalid()
+               : get(static_cast<std::size_t>(std::distance(begin(ids_), it)));
+  }
+
+  std::string tag_;
+  std::vector<std::string> ids_;
+  std::vector<geo::latlng> pos_;
+};
+
+inline parking_lot make_osm_lot(std::int64_t const osm_id,
+                                geo::latlng const pos) {
+  auto lot = parking_lot{};
+  lot.location_ = pos;
+  lot.info_ = osm_parking_lot_info{osm_id, osm_type::NODE, fee_type::NO};
+  return lot;
+}
+
+// n_edges outward edges (stations "s0", "s1", ...) that all have the given
+// duration. Return edges share the outward edges.
+inline persistable_foot_edges make_foot_edges(std::int32_t const parking_id,
+                                              std::string const& profile,
+                                              std::uint16_t const duration,
+                                              std::size_t const n_edges = 4U) {
+  flatbuffers::FlatBufferBuilder fbb;
+  auto edges = std::vector<flatbuffers::Offset<FootEdge>>{};
+  for (auto i = 0U; i != n_edges; ++i) {
+    edges.emplace_back(CreateFootEdge(fbb,
+                                      fbb.CreateString("s" + std::to_string(i)),
+                                      100.0 * i, duration, 0U, 100.0 * i));
+  }
+  auto const fbs_edges = fbb.CreateVector(edges);
+  fbb.Finish(CreateFootEdges(fbb, parking_id, fbb.CreateString(profile),
+                             fbs_edges, fbs_edges));
+  return persistable_foot_edges{std::move(fbb)};
+}
+
+}  // namespace motis::parking
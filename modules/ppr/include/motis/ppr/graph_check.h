@@ -0,0 +1,17 @@
+#pragma once
+
+#include <filesystem>
+
+namespace motis::ppr {
+
+// A graph file that passed the full integrity check is recorded in
+// check_ini (path, size, modification time). The check is skipped only if
+// skip_unchanged is set and the file still matches that record.
+bool needs_integrity_check(std::filesystem::path const& graph,
+                           std::filesystem::path const& check_ini,
+                           bool check_integrity, bool skip_unchanged);
+
+void record_integrity_check(std::filesystem::path const& graph,
+                            std::filesystem::path const& check_ini);
+
+}  // namespace motis::ppr
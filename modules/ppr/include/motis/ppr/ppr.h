@@ -37,6 +37,7 @@ private:
   bool prefetch_rtrees_{true};
   bool verify_graph_{false};
   bool check_integrity_{true};
+  bool skip_unchanged_check_{false};
 
   bool use_dem_{false};
 
@@ -0,0 +1,40 @@
+#include "motis/ppr/graph_check.h"
+
+#include <cstdint>
+#include <string>
+
+#include "cista/reflection/comparable.h"
+
+#include "motis/module/ini_io.h"
+
+namespace fs = std::filesystem;
+namespace mm = motis::module;
+
+namespace motis::ppr {
+
+struct graph_check_state {
+  CISTA_COMPARABLE()
+  mm::named<std::string, MOTIS_NAME("path")> path_;
+  mm::named<std::size_t, MOTIS_NAME("size")> size_;
+  mm::named<std::int64_t, MOTIS_NAME("mtime")> mtime_;
+};
+
+graph_check_state get_graph_check_state(fs::path const& graph) {
+  return {graph.generic_string(), fs::file_size(graph),
+          static_cast<std::int64_t>(
+              fs::last_write_time(graph).time_since_epoch().count())};
+}
+
+bool needs_integrity_check(fs::path const& graph, fs::path const& check_ini,
+                           bool const check_integrity,
+                           bool const skip_unchanged) {
+  return check_integrity &&
+         (!skip_unchanged || mm::read_ini<graph_check_state>(check_ini) !=
+                                 get_graph_check_state(graph));
+}
+
+void record_integrity_check(fs::path const& graph, fs::path const& check_ini) {
+  mm::write_ini(check_ini, get_graph_check_state(graph));
+}
+
+}  // namespace motis::ppr
@@ -26,6 +26,7 @@
 
 #include "motis/ppr/data.h"
 #include "motis/ppr/error.h"
+#include "motis/ppr/graph_check.h"
 #include "motis/ppr/profiles.h"
 
 using namespace motis::module;
@@ -299,6 +300,9 @@ ppr::ppr() : module("Foot Routing", "ppr") {
   param(verify_graph_, "verify_graph", "Verify routing graph");
   param(check_integrity_, "check_integrity",
         "Check routing graph file integrity");
+  param(skip_unchanged_check_, "skip_unchanged_check",
+        "Skip the integrity check if the graph file did not change since the "
+        "last successful check (path, size, modification time)");
 }
 
 ppr::~ppr() = default;
@@ -347,9 +351,23 @@ void ppr::import(import_dispatcher& reg) {
         auto graph_size = std::size_t{};
 
         auto const load_graph = [&]() {
+          // The graph and its r-trees are memory mapped. Hashing the whole
+          // graph file is the only part that scales with the graph size.
+          auto const check_path = dir / "graph_check.ini";
+          auto const check_integrity =
+              needs_integrity_check(graph_file(), check_path,
+                                    check_integrity_, skip_unchanged_check_);
+          if (check_integrity_ && !check_integrity) {
+            LOG(info) << "ppr routing graph unchanged since last integrity "
+                         "check, skipping it";
+          }
+
           impl_ = std::make_unique<impl>(
               graph_file(), profiles, edge_rtree_max_size_,
-              area_rtree_max_size_, rtree_opt, verify_graph_, check_integrity_);
+              area_rtree_max_size_, rtree_opt, verify_graph_, check_integrity);
+          if (check_integrity) {
+            record_integrity_check(graph_file(), check_path);
+          }
 
           auto& mem_holder = impl_->data_.rg_.data_.mem_;
           utl::verify(
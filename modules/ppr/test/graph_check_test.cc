@@ -0,0 +1,73 @@
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "motis/ppr/graph_check.h"
+
+namespace fs = std::filesystem;
+using namespace motis::ppr;
+
+namespace {
+
+struct temp_dir {
+  temp_dir()
+      : path_{fs::temp_directory_path() /
+              ("motis_ppr_graph_check_test_" + std::to_string(getpid()))} {
+    fs::create_directories(path_);
+  }
+  ~temp_dir() { fs::remove_all(path_); }
+
+  temp_dir(temp_dir const&) = delete;
+  temp_dir& operator=(temp_dir const&) = delete;
+  temp_dir(temp_dir&&) = delete;
+  temp_dir& operator=(temp_dir&&) = delete;
+
+  fs::path path_;
+};
+
+void append(fs::path const& p, std::string const& content) {
+  auto f = std::ofstream{p, std::ios::binary | std::ios::app};
+  f << content;
+}
+
+}  // namespace
+
+TEST(ppr_graph_check, skip_is_opt_in) {
+  auto const dir = temp_dir{};
+  auto const graph = dir.path_ / "routing_graph.ppr";
+  auto const ini = dir.path_ / "graph_check.ini";
+  append(graph, "graph");
+
+  record_integrity_check(graph, ini);
+  EXPECT_TRUE(needs_integrity_check(graph, ini, true, false));
+  EXPECT_FALSE(needs_integrity_check(graph, ini, false, false));
+  EXPECT_FALSE(needs_integrity_check(graph, ini, false, true));
+}
+
+TEST(ppr_graph_check, skip_unchanged_file) {
+  auto const dir = temp_dir{};
+  auto const graph = dir.path_ / "routing_graph.ppr";
+  auto const ini = dir.path_ / "graph_check.ini";
+  append(graph, "graph");
+
+  // Never checked.
+  EXPECT_TRUE(needs_integrity_check(graph, ini, true, true));
+
+  record_integrity_check(graph, ini);
+  EXPECT_FALSE(needs_integrity_check(graph, ini, true, true));
+
+  // Changed file (size, modification time).
+  append(graph, "changed");
+  EXPECT_TRUE(needs_integrity_check(graph, ini, true, true));
+  record_integrity_check(graph, ini);
+  EXPECT_FALSE(needs_integrity_check(graph, ini, true, true));
+
+  // Other graph file.
+  auto const other = dir.path_ / "other.ppr";
+  fs::copy_file(graph, other);
+  EXPECT_TRUE(needs_integrity_check(other, ini, true, true));
+}